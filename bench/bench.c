@@ -0,0 +1,344 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: bench.c
+ * Description: Microbenchmarks of the portable modules, built against the simulated MCU
+ * with "make bench". Every benchmark runs its operation a fixed number of times and the
+ * time per operation on the host is printed, so a regression shows up as a change of the
+ * figures between two builds. An argument runs only the benchmarks whose name starts
+ * with it. "--check" runs the timing checks of timing.c instead, which fail the harness
+ * when a figure is over its budget.
+ */
+
+#include "timer.h"
+#include "synth.h"
+#include "leds.h"
+#include "sequencer.h"
+#include "patterns.h"
+#include "alarms.h"
+#include "civil.h"
+#include "fmt.h"
+#include "console.h"
+#include "command.h"
+#include "crc.h"
+#include "uart.h"
+#include "work.h"
+#include "sim.h"
+#include "timing.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// One benchmark, run() repeats the measured operation the given number of times
+struct Benchmark {
+	const char *name;
+	uint32_t iterations;
+	uint32_t bytes; // Bytes processed by one operation, 0 if not a throughput benchmark
+	void (*run)(uint32_t iterations);
+};
+
+static volatile uint32_t sink; // Keeps results alive so the work is not optimized away
+static uint32_t linesHandled = 0;
+
+/**
+ * Returns the monotonic time of the host in nanoseconds.
+ */
+static uint64_t nowNanos() {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+}
+
+/**
+ * Returns a pseudo-random number, the same sequence on every run.
+ */
+static uint32_t nextRandom() {
+	static uint32_t state = 12345;
+
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+/**
+ * Fills an alarm with a daily rule at the given time.
+ */
+static void makeAlarm(struct Alarm *alarm, uint32_t time) {
+	memset(alarm, 0, sizeof(*alarm));
+	alarm->time = time;
+	alarm->baseTime = time;
+	alarm->interval = 60;
+	alarm->repeatCount = 2;
+	alarm->melody = 1;
+	alarm->lightEffect = 1;
+	alarm->recurrence = ALARM_DAILY;
+}
+
+/**
+ * One time base tick while the longest melody and a fading light effect are played,
+ * i.e. the samples of the synthesizer, the LED and sequencer tick handlers together.
+ */
+static void benchTick(uint32_t iterations) {
+	for (uint32_t i = 0; i < iterations; i++) {
+		if (!sequencerRunning()) {
+			sequencerStart(1, 4, SEQUENCER_INTENSITY_MAX);
+		}
+		PIT0_IRQHandler();
+	}
+	sequencerStop();
+}
+
+/**
+ * Start of a melody and a light effect, which plays their first steps.
+ */
+static void benchSequencerStart(uint32_t iterations) {
+	for (uint32_t i = 0; i < iterations; i++) {
+		sequencerStart(1 + i % MELODY_COUNT, 1 + i % LIGHT_EFFECT_COUNT,
+				SEQUENCER_INTENSITY_MAX);
+	}
+	sequencerStop();
+}
+
+/**
+ * Insertion of alarms at random times, the table is emptied whenever it is full.
+ */
+static void benchAlarmInsert(uint32_t iterations) {
+	struct Alarm alarm;
+
+	AlarmsInit();
+	for (uint32_t i = 0; i < iterations; i++) {
+		if (alarmCount() == ALARM_CAPACITY) {
+			AlarmsInit();
+		}
+		makeAlarm(&alarm, 1900000000u + nextRandom() % SECONDS_PER_DAY);
+		sink += (uint32_t) alarmAdd(&alarm);
+	}
+}
+
+/**
+ * Firing of the earliest alarm of a full table, which moves it to its next day.
+ */
+static void benchAlarmFire(uint32_t iterations) {
+	struct Alarm alarm;
+
+	AlarmsInit();
+	for (int i = 0; i < ALARM_CAPACITY; i++) {
+		makeAlarm(&alarm, 1900000000u + nextRandom() % SECONDS_PER_DAY);
+		alarmAdd(&alarm);
+	}
+	for (uint32_t i = 0; i < iterations; i++) {
+		int id = alarmNext();
+		struct Alarm *next = alarmGet(id);
+		alarmReschedule(id, alarmNextOccurrence(next, next->time));
+	}
+	sink += alarmTakeChanges();
+}
+
+/**
+ * Formatting of a date and time.
+ */
+static void benchCivilFormat(uint32_t iterations) {
+	char text[CIVIL_TIME_LENGTH + 1];
+
+	for (uint32_t i = 0; i < iterations; i++) {
+		civilFormat(1900000000u + i * 7919u, text);
+		sink += (uint8_t) text[18];
+	}
+}
+
+/**
+ * Parsing of a date and time as entered by the user.
+ */
+static void benchParseDateTime(uint32_t iterations) {
+	struct CivilTime time;
+
+	for (uint32_t i = 0; i < iterations; i++) {
+		sink += (uint32_t) parseDateTime("2030-06-15 12:34:56", &time);
+		sink += civilToEpoch(&time);
+	}
+}
+
+/**
+ * Formatting of a status line with numbers in several formats.
+ */
+static void benchFormatter(uint32_t iterations) {
+	char text[80];
+	struct Formatter f;
+
+	for (uint32_t i = 0; i < iterations; i++) {
+		fmtInit(&f, text, sizeof(text));
+		fmtStr(&f, "Aktivita CPU: ");
+		fmtFixed(&f, i % 1000, 10);
+		fmtStr(&f, " %, odhad proudu: ");
+		fmtInt(&f, -(int32_t) i);
+		fmtChar(&f, '/');
+		fmtUintPad(&f, i, 8);
+		sink += f.length;
+	}
+}
+
+/**
+ * Counts the lines handed over by the console.
+ */
+static void countLine(char *line) {
+	(void) line;
+	linesHandled++;
+}
+
+/**
+ * Does not show any prompt.
+ */
+static void noPrompt() {
+}
+
+/**
+ * Reception, echo and editing of command lines by the console.
+ */
+static void benchConsole(uint32_t iterations) {
+	static const uint8_t text[] = "alarm add 2030-01-01 06:30:00 mel=2 light=3 rep=5/60 daily\r";
+
+	ConsoleInit(countLine, noPrompt);
+	for (uint32_t i = 0; i < iterations; i++) {
+		simUartReceive(text, sizeof(text) - 1);
+		while (UARTRxAvailable()) {
+			consoleTask();
+		}
+	}
+	sink += linesHandled;
+}
+
+/**
+ * Runs a command that only looks at its options.
+ */
+static void optionsCommand(struct CommandLine *line) {
+	for (int i = 1; i < line->count; i++) {
+		sink += commandValue(line->words[i], "rep") != NULL;
+	}
+	commandOk(NULL);
+}
+
+static const struct Command benchCommands[] = {
+	{ "time", optionsCommand },
+	{ "quiet", optionsCommand },
+	{ "alarm", optionsCommand }
+};
+
+/**
+ * Splitting of a command into words and the lookup in the command table.
+ */
+static void benchCommand(uint32_t iterations) {
+	static const char text[] = "alarm add 2030-01-01 06:30:00 mel=2 light=3 rep=5/60 daily";
+	char line[sizeof(text)];
+
+	for (uint32_t i = 0; i < iterations; i++) {
+		memcpy(line, text, sizeof(text));
+		sink += commandExecute(benchCommands, 3, line);
+	}
+}
+
+/**
+ * CRC of a frame of the binary protocol of the largest size.
+ */
+static void benchCrc(uint32_t iterations) {
+	uint8_t frame[48];
+
+	for (uint32_t i = 0; i < sizeof(frame); i++) {
+		frame[i] = (uint8_t) nextRandom();
+	}
+	for (uint32_t i = 0; i < iterations; i++) {
+		sink += crc16(CRC16_INIT, frame, sizeof(frame));
+	}
+}
+
+/**
+ * Deferred work that only counts its calls.
+ */
+static void countWork(uint32_t arg) {
+	sink += arg;
+}
+
+/**
+ * Posting of deferred work and running it, in batches of a few calls as the main loop
+ * finds them after an interrupt.
+ */
+static void benchWork(uint32_t iterations) {
+	for (uint32_t i = 0; i < iterations; i++) {
+		workPost(countWork, i);
+		if ((i & 3) == 3) {
+			workTask();
+		}
+	}
+	workTask();
+}
+
+/**
+ * One sample of the synthesizer with the melody and the beep voice playing together,
+ * the work of the sample interrupt.
+ */
+static void benchSynthSample(uint32_t iterations) {
+	synthPlay(SYNTH_VOICE_MELODY, 880, 60000, SYNTH_VOLUME_MAX);
+	synthPlay(SYNTH_VOICE_BEEP, 2000, 60000, SYNTH_VOLUME_MAX / 4);
+	for (uint32_t i = 0; i < iterations; i++) {
+		sink += (uint32_t) synthSample();
+	}
+	synthStop(SYNTH_VOICE_MELODY);
+	synthStop(SYNTH_VOICE_BEEP);
+	synthSample();
+	synthSample();
+}
+
+static const struct Benchmark benchmarks[] = {
+	{ "tick playing", 2000000, 0, benchTick },
+	{ "sequencer start", 1000000, 0, benchSequencerStart },
+	{ "synth sample", 5000000, 0, benchSynthSample },
+	{ "alarm insert", 2000000, 0, benchAlarmInsert },
+	{ "alarm fire", 2000000, 0, benchAlarmFire },
+	{ "civil format", 2000000, 0, benchCivilFormat },
+	{ "parse date time", 2000000, 0, benchParseDateTime },
+	{ "formatter", 2000000, 0, benchFormatter },
+	{ "console line", 200000, 59, benchConsole },
+	{ "command execute", 1000000, 0, benchCommand },
+	{ "crc16 48 B", 2000000, 48, benchCrc },
+	{ "work post and run", 5000000, 0, benchWork }
+};
+
+/**
+ * Runs the benchmarks and prints a line for each of them.
+ */
+int main(int argc, char **argv) {
+	bool check = argc > 1 && strcmp(argv[1], "--check") == 0;
+	const char *filter = argc > 1 + check ? argv[1 + check] : "";
+
+	// The firmware modules on the simulated MCU, without the clock thread the time
+	// base only moves when a benchmark runs a tick
+	simUartMute(true);
+	SynthInit();
+	LedsInit();
+	WorkInit();
+	SequencerInit(NULL);
+
+	if (check) {
+		return timingRun(filter) == 0 ? 0 : 1;
+	}
+
+	printf("%-20s %10s %12s %12s\n", "benchmark", "iterations", "ns/op", "MB/s");
+	for (unsigned i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+		const struct Benchmark *b = &benchmarks[i];
+		if (strncmp(b->name, filter, strlen(filter)) != 0) {
+			continue;
+		}
+
+		b->run(b->iterations / 10); // Warm up the caches
+		uint64_t start = nowNanos();
+		b->run(b->iterations);
+		double nanos = (double) (nowNanos() - start) / b->iterations;
+
+		printf("%-20s %10u %12.1f", b->name, (unsigned) b->iterations, nanos);
+		if (b->bytes != 0) {
+			printf(" %12.1f", b->bytes * 1000.0 / nanos);
+		}
+		printf("\n");
+	}
+	return 0;
+}
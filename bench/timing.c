@@ -0,0 +1,770 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: timing.c
+ * Description: Timing checks of the alarm scheduling and the sequencer on the simulated MCU,
+ * run by "make check". Without the clock thread the simulated RTC and time base only move
+ * when a check runs a tick, so the fire times, repeat gaps and step durations come out the
+ * same on every run and are compared with a jitter budget. The worst interrupt times and
+ * the main loop latency under a UART flood are measured on the host and compared with
+ * budgets as well. Every check that is over its budget or finds a wrong result fails, and
+ * the harness then exits with an error.
+ */
+
+#include "timer.h"
+#include "sequencer.h"
+#include "synth.h"
+#include "patterns.h"
+#include "alarms.h"
+#include "console.h"
+#include "command.h"
+#include "uart.h"
+#include "rtc.h"
+#include "clock.h"
+#include "work.h"
+#include "sim.h"
+#include "timing.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define JITTER_BUDGET_MS 1     // Largest error of a fire time, repeat gap or step
+#define START_TIME 1893997800u // 2030-01-07 06:30:00, a Monday
+#define MAX_RINGS 64           // Rings recorded by one check
+#define MAX_EDGES 256          // Changes of the tone recorded by one check
+#define ROUNDS 10              // Rounds of a host measurement, the best one counts
+#define FLOOD_BYTES_PER_MS 12  // Bytes received per ms at 115200 Bd
+#define SYNC_AHEAD_MS 400      // Host clock ahead of the RTC, within CLOCK_SLEW_MAX_MS
+#define SYNC_STEP_MS 5000      // Later jump of the host clock, stepped
+#define SYNC_EXCHANGES 6       // Exchanges of every sync
+#define SYNC_LINE_MS 3         // Shortest time a sync frame spends on the line
+
+// One check, run() returns the measured value compared with the budget
+struct TimingCheck {
+	const char *name;
+	uint32_t budget;
+	const char *unit;
+	uint32_t (*run)();
+};
+
+// Ring of an alarm as seen by the scheduler
+struct Ring {
+	int id;
+	uint32_t time;        // Second the alarm was due at
+	uint32_t millis;      // Time base when it rang
+	uint8_t repeatIndex;
+	struct Alarm alarm;   // The alarm as it rang, for snoozing
+};
+
+// Change of the tone played
+struct Edge {
+	uint32_t millis;
+	uint16_t frequency;
+};
+
+static struct Ring rings[MAX_RINGS];
+static int ringCount;
+static uint32_t worstErrorMs;   // Largest fire time error of the rings so far
+static uint32_t clockMillis;    // Time base when the RTC was last set
+static uint32_t clockSeconds;   // RTC seconds it was set to
+static int mismatches;          // Wrong results found by the current check
+static bool inputPosted = false;
+static uint64_t tickEndNanos;   // Host time when the last tick returned
+static uint64_t worstLatency;   // Longest time from a tick to the ring it posted
+static int32_t hostAheadMs;     // Host clock minus the RTC as it was set, in ms
+static volatile uint32_t sink;
+
+/**
+ * Returns the monotonic time of the host in nanoseconds.
+ */
+static uint64_t nowNanos() {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+}
+
+/**
+ * Counts a wrong result of the current check and prints what it was.
+ *
+ * @param ok The expected result was found.
+ * @param what Description of the expected result.
+ */
+static void expect(bool ok, const char *what) {
+	if (!ok) {
+		mismatches++;
+		printf("  expected %s\n", what);
+	}
+}
+
+/**
+ * Returns the difference of two times in ms as a positive number.
+ */
+static uint32_t distance(uint32_t a, uint32_t b) {
+	return a > b ? a - b : b - a;
+}
+
+/**
+ * Sets the RTC to the start of a second.
+ */
+static void setClock(uint32_t seconds) {
+	struct RtcTime time = { seconds, 0 };
+
+	rtcSetTime(&time);
+	clockSeconds = seconds;
+	clockMillis = timerMillis();
+}
+
+/**
+ * Returns the time base at which the RTC reaches a second.
+ */
+static uint32_t millisAt(uint32_t seconds) {
+	return clockMillis + (seconds - clockSeconds) * 1000u;
+}
+
+/**
+ * Programs the RTC alarm for the earliest alarm of the table, as the firmware does.
+ */
+static void programNext() {
+	int id = alarmNext();
+
+	rtcSetAlarm(id == ALARM_NONE ? 0 : alarmGet(id)->time);
+}
+
+/**
+ * Deferred work of the RTC alarm. Rings every alarm that is due the way the firmware
+ * does: records the ring, moves the alarm to its next repeat or occurrence and
+ * programs the next alarm.
+ */
+static void alarmFired(uint32_t second) {
+	uint32_t now = rtcSeconds();
+	int id;
+
+	(void) second;
+	if (tickEndNanos != 0 && nowNanos() - tickEndNanos > worstLatency) {
+		worstLatency = nowNanos() - tickEndNanos;
+	}
+	while ((id = alarmNext()) != ALARM_NONE && alarmGet(id)->time <= now) {
+		struct Alarm *alarm = alarmGet(id);
+		if (ringCount < MAX_RINGS) {
+			struct Ring *ring = &rings[ringCount++];
+			ring->id = id;
+			ring->time = alarm->time;
+			ring->millis = timerMillis();
+			ring->repeatIndex = alarm->repeatIndex;
+			ring->alarm = *alarm;
+			uint32_t error = distance(ring->millis, millisAt(alarm->time));
+			if (error > worstErrorMs) {
+				worstErrorMs = error;
+			}
+		}
+		alarmAdvance(id);
+	}
+	programNext();
+}
+
+/**
+ * Runs the simulated MCU for the given time, one tick and one pass of the main loop
+ * per millisecond.
+ */
+static void runFor(uint32_t ms) {
+	for (uint32_t i = 0; i < ms; i++) {
+		PIT0_IRQHandler();
+		tickEndNanos = nowNanos();
+		workTask();
+	}
+}
+
+/**
+ * Moves the RTC to shortly before the earliest alarm and runs until it has rung, so
+ * a check can cover days without simulating every millisecond of them.
+ */
+static void runToNextAlarm() {
+	int id = alarmNext();
+
+	if (id == ALARM_NONE) {
+		return;
+	}
+	setClock(alarmGet(id)->time - 2);
+	programNext();
+	runFor(2500);
+}
+
+/**
+ * Empties the alarm table and the recorded rings before a check.
+ */
+static void resetAlarms() {
+	AlarmsInit();
+	alarmTakeChanges();
+	rtcSetAlarm(0);
+	ringCount = 0;
+	worstErrorMs = 0;
+	setClock(START_TIME);
+}
+
+/**
+ * Fills an alarm with the rule of a check.
+ */
+static void makeAlarm(struct Alarm *alarm, uint32_t time, enum AlarmRecurrence recurrence) {
+	memset(alarm, 0, sizeof(*alarm));
+	alarm->time = time;
+	alarm->baseTime = time;
+	alarm->interval = 60;
+	alarm->melody = 1;
+	alarm->lightEffect = 1;
+	alarm->recurrence = recurrence;
+}
+
+/**
+ * A full table of single alarms within ten minutes rings each of them once, in the
+ * order of their times and at the start of their second.
+ */
+static uint32_t checkAlarmTable() {
+	struct Alarm alarm;
+	uint32_t state = 4711;
+
+	resetAlarms();
+	for (int i = 0; i < ALARM_CAPACITY; i++) {
+		state = state * 1103515245u + 12345u;
+		makeAlarm(&alarm, START_TIME + 1 + (state >> 16) % 600, ALARM_ONCE);
+		alarmAdd(&alarm);
+	}
+	programNext();
+	runFor(602000);
+
+	expect(ringCount == ALARM_CAPACITY, "every alarm to ring once");
+	expect(alarmCount() == 0, "an empty table after the rings");
+	for (int i = 1; i < ringCount; i++) {
+		if (rings[i].time < rings[i - 1].time) {
+			expect(false, "the rings in the order of their times");
+			break;
+		}
+	}
+	return worstErrorMs;
+}
+
+/**
+ * The repeats of every backoff policy come after the gaps the policy gives.
+ */
+static uint32_t checkRepeatSpacing() {
+	static const uint32_t gaps[][4] = {
+		{ 2, 2, 2, 2 },  // ALARM_BACKOFF_FIXED
+		{ 2, 4, 6, 8 },  // ALARM_BACKOFF_LINEAR
+		{ 2, 4, 8, 16 }  // ALARM_BACKOFF_EXPONENTIAL
+	};
+	struct Alarm alarm;
+	uint32_t worst = 0;
+
+	for (int backoff = ALARM_BACKOFF_FIXED; backoff <= ALARM_BACKOFF_EXPONENTIAL; backoff++) {
+		resetAlarms();
+		makeAlarm(&alarm, START_TIME + 1, ALARM_ONCE);
+		alarm.interval = 2;
+		alarm.repeatCount = 4;
+		alarm.backoff = (uint8_t) backoff;
+		alarmAdd(&alarm);
+		programNext();
+		runFor(33000);
+
+		expect(ringCount == 5, "the first ring and four repeats");
+		for (int i = 1; i < ringCount && i <= 4; i++) {
+			uint32_t gap = rings[i].millis - rings[i - 1].millis;
+			uint32_t error = distance(gap, gaps[backoff][i - 1] * 1000u);
+			if (error > worst) {
+				worst = error;
+			}
+			expect(rings[i].repeatIndex == i, "the repeats in their order");
+		}
+		if (worstErrorMs > worst) {
+			worst = worstErrorMs;
+		}
+	}
+	return worst;
+}
+
+/**
+ * Daily, weekday and periodic alarms ring at their next occurrences, computed here
+ * from the calendar instead of by the alarm table.
+ */
+static uint32_t checkRecurrence() {
+	struct Alarm alarm;
+	uint32_t worst = 0;
+
+	// Daily at 06:30 for three days
+	resetAlarms();
+	makeAlarm(&alarm, START_TIME, ALARM_DAILY);
+	alarmAdd(&alarm);
+	for (int i = 0; i < 3; i++) {
+		runToNextAlarm();
+	}
+	expect(ringCount == 3, "three daily rings");
+	for (int i = 0; i < ringCount; i++) {
+		expect(rings[i].time == START_TIME + (uint32_t) i * SECONDS_PER_DAY,
+				"a daily ring at the same time every day");
+	}
+	worst = worstErrorMs;
+
+	// Workdays at 06:30 for two weeks, Monday is day 0 of the week of START_TIME
+	resetAlarms();
+	makeAlarm(&alarm, START_TIME, ALARM_WEEKDAYS);
+	alarm.weekdays = ALARM_WORKDAYS;
+	alarmAdd(&alarm);
+	for (int i = 0; i < 10; i++) {
+		runToNextAlarm();
+	}
+	expect(ringCount == 10, "ten workday rings");
+	for (int i = 0; i < ringCount; i++) {
+		uint32_t day = (uint32_t) (i / 5 * 7 + i % 5);
+		expect(rings[i].time == START_TIME + day * SECONDS_PER_DAY,
+				"workday rings from Monday to Friday");
+	}
+	if (worstErrorMs > worst) {
+		worst = worstErrorMs;
+	}
+
+	// Every 90 minutes with a repeat after each occurrence
+	resetAlarms();
+	makeAlarm(&alarm, START_TIME, ALARM_EVERY);
+	alarm.period = 90;
+	alarm.repeatCount = 1;
+	alarm.interval = 30;
+	alarmAdd(&alarm);
+	for (int i = 0; i < 8; i++) {
+		runToNextAlarm();
+	}
+	expect(ringCount == 8, "eight periodic rings");
+	for (int i = 0; i < ringCount; i++) {
+		expect(rings[i].time == START_TIME + (uint32_t) (i / 2) * 5400u + (uint32_t) (i % 2) * 30u,
+				"periodic rings every 90 minutes with their repeats");
+	}
+	if (worstErrorMs > worst) {
+		worst = worstErrorMs;
+	}
+	return worst;
+}
+
+/**
+ * A snoozed ring comes back after ALARM_SNOOZE_SECONDS: a pending repeat moves there
+ * and the next one follows from it, the last ring comes back as a copy and a full
+ * table refuses the copy.
+ */
+static uint32_t checkSnooze() {
+	struct Alarm alarm;
+
+	resetAlarms();
+	makeAlarm(&alarm, START_TIME + 1, ALARM_ONCE);
+	alarm.repeatCount = 1;
+	alarm.interval = 60;
+	alarmAdd(&alarm);
+	programNext();
+	runFor(4000);
+	expect(ringCount == 1, "the first ring");
+
+	// Snoozed three seconds into the first ring, the repeat moves
+	uint32_t snoozed = rtcSeconds() + ALARM_SNOOZE_SECONDS;
+	expect(alarmSnooze(rings[0].id, &rings[0].alarm, snoozed) == rings[0].id,
+			"the repeat to be snoozed");
+	programNext();
+	runFor(ALARM_SNOOZE_SECONDS * 1000u + 1000);
+	expect(ringCount == 2 && rings[1].time == snoozed, "the repeat at the snoozed time");
+	expect(alarmCount() == 0, "no ring after the last repeat");
+
+	// Snoozing the last ring adds a copy
+	snoozed = rtcSeconds() + ALARM_SNOOZE_SECONDS;
+	expect(alarmSnooze(rings[1].id, &rings[1].alarm, snoozed) != ALARM_NONE,
+			"a copy of the last ring");
+	programNext();
+	runFor(ALARM_SNOOZE_SECONDS * 1000u + 1000);
+	expect(ringCount == 3 && rings[2].time == snoozed, "the copy at the snoozed time");
+	expect(alarmCount() == 0, "the copy to ring only once");
+
+	// No copy fits into a full table
+	for (int i = 0; i < ALARM_CAPACITY; i++) {
+		makeAlarm(&alarm, START_TIME + SECONDS_PER_DAY + (uint32_t) i, ALARM_ONCE);
+		alarmAdd(&alarm);
+	}
+	expect(alarmSnooze(rings[2].id, &rings[2].alarm, rtcSeconds() + ALARM_SNOOZE_SECONDS)
+			== ALARM_NONE, "no snooze in a full table");
+	rtcSetAlarm(0);
+	return worstErrorMs;
+}
+
+/**
+ * Appends a change of the tone unless the tone stays the same.
+ */
+static void addEdge(struct Edge *edges, int *count, uint32_t millis, uint16_t frequency) {
+	if (*count > 0 && edges[*count - 1].frequency == frequency) {
+		return;
+	}
+	if (*count < MAX_EDGES) {
+		edges[*count] = (struct Edge) { millis, frequency };
+		(*count)++;
+	}
+}
+
+/**
+ * Every note of every melody starts after the notes before it and is silent for
+ * NOTE_GAP_MS at its end, and the playback ends after the longer of the melody and
+ * the light effect. A beep played over the start of the melody mixes with it and does
+ * not move its notes.
+ */
+static uint32_t checkSequencerSteps() {
+	static struct Edge expected[MAX_EDGES];
+	static struct Edge played[MAX_EDGES];
+	uint32_t worst = 0;
+
+	for (int m = 1; m <= MELODY_COUNT; m++) {
+		const struct Melody *melody = &melodies[m - 1];
+		const struct LightEffect *light = &lightEffects[m - 1];
+		int expectedCount = 0;
+		int playedCount = 0;
+		uint32_t start = timerMillis();
+		uint32_t t = 0;
+
+		for (int loop = 0; loop < melody->loops; loop++) {
+			for (int i = 0; i < melody->length; i++) {
+				const struct Note *note = &melody->notes[i];
+				addEdge(expected, &expectedCount, t, note->frequency);
+				addEdge(expected, &expectedCount, t + note->duration - NOTE_GAP_MS, 0);
+				t += note->duration;
+			}
+		}
+		uint32_t lightLength = 0;
+		for (int i = 0; i < light->length; i++) {
+			lightLength += light->frames[i].duration * 10u;
+		}
+		lightLength *= light->loops;
+		uint32_t length = t > lightLength ? t : lightLength;
+
+		sequencerStart(m, m, SEQUENCER_INTENSITY_MAX);
+		synthPlay(SYNTH_VOICE_BEEP, 2000, 50, SYNTH_VOLUME_MAX / 4);
+		// Queued notes start with the samples of the next tick, which the host computes at
+		// its end, so a note is seen playing one tick after it has started
+		while (sequencerRunning() && timerMillis() - start < length + 1000) {
+			PIT0_IRQHandler();
+			addEdge(played, &playedCount, timerMillis() - start,
+					synthFrequency(SYNTH_VOICE_MELODY));
+			if (timerMillis() - start == 10) {
+				expect(synthFrequency(SYNTH_VOICE_BEEP) == 2000 && simToneSample() != 0,
+						"the beep to play over the melody");
+			}
+		}
+		expect(synthFrequency(SYNTH_VOICE_BEEP) == 0, "the beep to end by itself");
+		uint32_t end = timerMillis() - start;
+
+		expect(playedCount == expectedCount, "every note of the melody to be played");
+		for (int i = 0; i < playedCount && i < expectedCount; i++) {
+			uint32_t error = distance(played[i].millis, expected[i].millis);
+			if (error > worst) {
+				worst = error;
+			}
+			expect(played[i].frequency == expected[i].frequency, "the notes of the melody");
+		}
+		if (distance(end, length) > worst) {
+			worst = distance(end, length);
+		}
+	}
+	return worst;
+}
+
+/**
+ * Measures the longest time base interrupt while a ring plays and the RTC counts. The
+ * longest tick of each round is taken and the shortest of those is reported, so a
+ * preemption of the host does not count as a slow interrupt.
+ */
+static uint32_t checkTickTime() {
+	uint64_t best = UINT64_MAX;
+
+	for (int round = 0; round < ROUNDS; round++) {
+		uint64_t longest = 0;
+		for (int i = 0; i < 10000; i++) {
+			if (!sequencerRunning()) {
+				sequencerStart(1 + i % MELODY_COUNT, 1 + i % LIGHT_EFFECT_COUNT,
+						SEQUENCER_INTENSITY_MAX);
+			}
+			uint64_t start = nowNanos();
+			PIT0_IRQHandler();
+			uint64_t time = nowNanos() - start;
+			if (time > longest) {
+				longest = time;
+			}
+		}
+		if (longest < best) {
+			best = longest;
+		}
+	}
+	sequencerStop();
+	return (uint32_t) best;
+}
+
+/**
+ * Runs a command line received during the flood.
+ */
+static void floodCommand(struct CommandLine *line) {
+	for (int i = 1; i < line->count; i++) {
+		sink += commandValue(line->words[i], "rep") != NULL;
+	}
+	commandOk(NULL);
+}
+
+static const struct Command floodCommands[] = {
+	{ "alarm", floodCommand },
+	{ "time", floodCommand }
+};
+
+/**
+ * Executes a line received during the flood.
+ */
+static void floodLine(char *line) {
+	commandExecute(floodCommands, 2, line);
+}
+
+/**
+ * Shows no prompt.
+ */
+static void noPrompt() {
+}
+
+/**
+ * Deferred work of the received bytes, one line at a time as in the firmware.
+ */
+static void floodReceived(uint32_t arg) {
+	(void) arg;
+	inputPosted = false;
+	consoleTask();
+	if (UARTRxAvailable() && !inputPosted) {
+		inputPosted = workPost(floodReceived, 0);
+	}
+}
+
+/**
+ * Delivers the bytes received during one ms of a flood of command lines.
+ */
+static uint64_t floodMillisecond() {
+	static const uint8_t text[] = "alarm add 2030-01-01 06:30:00 mel=2 light=3 rep=5/60 daily\r";
+	static uint32_t position = 0;
+	uint8_t bytes[FLOOD_BYTES_PER_MS];
+
+	for (int i = 0; i < FLOOD_BYTES_PER_MS; i++) {
+		bytes[i] = text[position];
+		position = (position + 1) % (sizeof(text) - 1);
+	}
+	uint64_t start = nowNanos();
+	simUartReceive(bytes, sizeof(bytes));
+	uint64_t time = nowNanos() - start;
+	if (!inputPosted) {
+		inputPosted = workPost(floodReceived, 0);
+	}
+	return time;
+}
+
+/**
+ * Measures the longest receive interrupt during a flood of command lines at the full
+ * line rate, reported like the time base interrupt.
+ */
+static uint32_t checkRxTime() {
+	uint64_t best = UINT64_MAX;
+	uint32_t dropped = UARTDroppedCount();
+
+	ConsoleInit(floodLine, noPrompt);
+	consoleSetEcho(false);
+	for (int round = 0; round < ROUNDS; round++) {
+		uint64_t longest = 0;
+		for (int i = 0; i < 10000; i++) {
+			uint64_t time = floodMillisecond();
+			if (time > longest) {
+				longest = time;
+			}
+			PIT0_IRQHandler();
+			workTask();
+		}
+		if (longest < best) {
+			best = longest;
+		}
+	}
+	expect(UARTDroppedCount() == dropped, "no bytes dropped at the full line rate");
+	return (uint32_t) best;
+}
+
+/**
+ * Measures the longest time from the tick that fires an alarm to its ring, while the
+ * main loop also handles a flood of command lines, reported like the interrupts.
+ */
+static uint32_t checkLatency() {
+	struct Alarm alarm;
+	uint64_t best = UINT64_MAX;
+
+	ConsoleInit(floodLine, noPrompt);
+	consoleSetEcho(false);
+	for (int round = 0; round < ROUNDS; round++) {
+		resetAlarms();
+		for (int i = 0; i < ALARM_CAPACITY; i++) {
+			makeAlarm(&alarm, START_TIME + 1 + (uint32_t) i, ALARM_ONCE);
+			alarmAdd(&alarm);
+		}
+		programNext();
+		worstLatency = 0;
+		for (uint32_t ms = 0; ms < (ALARM_CAPACITY + 2) * 1000u; ms++) {
+			floodMillisecond();
+			PIT0_IRQHandler();
+			tickEndNanos = nowNanos();
+			workTask();
+		}
+		expect(ringCount == ALARM_CAPACITY, "every alarm to ring during the flood");
+		if (worstLatency < best) {
+			best = worstLatency;
+		}
+	}
+	tickEndNanos = 0;
+	return (uint32_t) best;
+}
+
+/**
+ * Returns the time of the simulated host clock in ms since 1970.
+ */
+static uint64_t hostMillis() {
+	return (uint64_t) clockSeconds * 1000u + (uint64_t) (timerMillis() - clockMillis)
+			+ (uint64_t) (int64_t) hostAheadMs;
+}
+
+/**
+ * Returns the RTC time in ms since 1970.
+ */
+static uint64_t rtcMillis() {
+	struct RtcTime time;
+
+	rtcRead(&time);
+	return (uint64_t) time.seconds * 1000u + rtcMillisFromTicks(time.ticks);
+}
+
+/**
+ * Converts a host time in ms to the layout of the sync timestamps.
+ */
+static struct RtcTime hostTime(uint64_t ms) {
+	return (struct RtcTime) { (uint32_t) (ms / 1000u), rtcTicksFromMillis(ms % 1000u) };
+}
+
+/**
+ * Seconds handler of the sync check, steps the slew like clockTicked() does.
+ */
+static void slewSecond(uint32_t second) {
+	(void) second;
+	clockSecond();
+}
+
+/**
+ * Runs the exchanges of a time sync over a line that delays the requests by a few ms
+ * more or less, the first exchange has the shortest and symmetric round trip.
+ */
+static enum ClockSync syncClock(struct ClockSample *applied) {
+	struct ClockExchange exchange;
+
+	for (int i = 0; i < SYNC_EXCHANGES; i++) {
+		exchange.sent = hostTime(hostMillis());
+		runFor(SYNC_LINE_MS + (uint32_t) (i % 3) * 4u);
+		rtcRead(&exchange.received);
+		runFor(1);
+		rtcRead(&exchange.replied);
+		runFor(SYNC_LINE_MS + (uint32_t) (i % 2) * 2u);
+		exchange.returned = hostTime(hostMillis());
+		expect(clockSyncSample(&exchange), "every exchange to be taken");
+	}
+	return clockSyncApply(applied);
+}
+
+/**
+ * A time sync with a host clock ahead by less than CLOCK_SLEW_MAX_MS slews the RTC to
+ * it through the compensation, a later jump of the host clock is stepped, and an alarm
+ * keeps its time across both and rings at the host time it was set for. Returns the
+ * largest difference of the RTC and the host clock after the corrections.
+ */
+static uint32_t checkClockSync() {
+	struct ClockSample applied;
+	struct Alarm alarm;
+	uint32_t worst = 0;
+
+	resetAlarms();
+	rtcSetCompensation(0);
+	rtcSetSecondsHandler(slewSecond);
+	hostAheadMs = SYNC_AHEAD_MS;
+
+	makeAlarm(&alarm, START_TIME + 300, ALARM_ONCE);
+	alarmAdd(&alarm);
+	programNext();
+
+	expect(syncClock(&applied) == CLOCK_SYNC_SLEWED, "a small offset to be slewed");
+	expect(distance((uint32_t) (-applied.offset * 1000 / RTC_PRESCALER_HZ), SYNC_AHEAD_MS)
+			<= JITTER_BUDGET_MS, "the offset of the shortest exchange");
+	uint32_t slewStart = timerMillis();
+	while (clockSlewing() && timerMillis() - slewStart < 300000u) {
+		runFor(1000);
+	}
+	expect(!clockSlewing(), "the slew to end");
+	expect(rtcGetCompensation() == 0, "the compensation to be restored");
+	expect(timerMillis() - slewStart < (uint32_t) SYNC_AHEAD_MS * RTC_PRESCALER_HZ / 120u,
+			"the slew to make close to RTC_TCR_MAX ticks a second");
+	worst = distance((uint32_t) rtcMillis(), (uint32_t) hostMillis());
+
+	hostAheadMs += SYNC_STEP_MS;
+	expect(syncClock(&applied) == CLOCK_SYNC_STEPPED, "a large offset to be stepped");
+	uint32_t error = distance((uint32_t) rtcMillis(), (uint32_t) hostMillis());
+	if (error > worst) {
+		worst = error;
+	}
+
+	// The alarm is not moved, it rings when the host clock reaches its time
+	programNext();
+	while (ringCount == 0 && rtcSeconds() < START_TIME + 400) {
+		runFor(1);
+	}
+	expect(ringCount == 1 && rings[0].time == START_TIME + 300, "the alarm at its time");
+	error = distance((uint32_t) hostMillis(), (uint32_t) ((uint64_t) (START_TIME + 300) * 1000u));
+	if (ringCount == 1 && error > worst) {
+		worst = error;
+	}
+
+	rtcSetSecondsHandler(NULL);
+	rtcSetAlarm(0);
+	hostAheadMs = 0;
+	return worst;
+}
+
+static const struct TimingCheck checks[] = {
+	{ "alarm table", JITTER_BUDGET_MS, "ms", checkAlarmTable },
+	{ "repeat spacing", JITTER_BUDGET_MS, "ms", checkRepeatSpacing },
+	{ "recurrence", JITTER_BUDGET_MS, "ms", checkRecurrence },
+	{ "snooze", JITTER_BUDGET_MS, "ms", checkSnooze },
+	{ "sequencer steps", JITTER_BUDGET_MS, "ms", checkSequencerSteps },
+	{ "clock sync", JITTER_BUDGET_MS, "ms", checkClockSync },
+	{ "tick isr worst", 5000, "ns", checkTickTime },
+	{ "uart rx isr worst", 10000, "ns", checkRxTime },
+	{ "latency under flood", 50000, "ns", checkLatency }
+};
+
+/**
+ * Runs the timing checks and prints a line for each of them.
+ *
+ * @param filter Only the checks whose name starts with it are run.
+ * @return Number of checks that failed.
+ */
+int timingRun(const char *filter) {
+	int failed = 0;
+
+	RTCInit(alarmFired);
+	printf("%-20s %10s %10s\n", "check", "measured", "budget");
+	for (unsigned i = 0; i < sizeof(checks) / sizeof(checks[0]); i++) {
+		const struct TimingCheck *c = &checks[i];
+		if (strncmp(c->name, filter, strlen(filter)) != 0) {
+			continue;
+		}
+
+		mismatches = 0;
+		uint32_t measured = c->run();
+		bool ok = mismatches == 0 && measured <= c->budget;
+		printf("%-20s %10u %10u %-2s %s\n", c->name, (unsigned) measured,
+				(unsigned) c->budget, c->unit, ok ? "ok" : "FAIL");
+		if (!ok) {
+			failed++;
+		}
+	}
+	return failed;
+}
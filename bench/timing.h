@@ -0,0 +1,12 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: timing.h
+ * Description: Timing checks of the alarm scheduling and the sequencer with their budgets.
+ */
+
+#ifndef TIMING_H
+#define TIMING_H
+
+int timingRun(const char *filter);
+
+#endif /* TIMING_H */
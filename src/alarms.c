@@ -0,0 +1,372 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: alarms.c
+ * Description: Fixed-capacity alarm table. The alarms are kept in a binary min-heap ordered
+ * by their next fire time, so the earliest alarm is found in O(1) and adding, removing or
+ * rescheduling an alarm costs O(log n). The heap array is a permutation of all alarm IDs,
+ * the IDs after the last heap element are the free ones. Recurring alarms compute their
+ * next occurrence from the current one with plain arithmetic on RTC seconds, and the repeat
+ * policy of an alarm gives the gap before each repeat and the intensity of each ring.
+ */
+
+#include <stddef.h>
+#include "alarms.h"
+
+static struct Alarm alarms[ALARM_CAPACITY];
+static uint8_t heap[ALARM_CAPACITY];     // Alarm IDs, the first heapSize form the heap
+static uint8_t heapIndex[ALARM_CAPACITY]; // Position of every alarm ID in heap
+static int heapSize = 0;
+static uint32_t changedAlarms = 0;        // Bit per alarm ID changed since alarmTakeChanges()
+
+/**
+ * Exchanges two heap positions.
+ */
+static void heapSwap(int a, int b) {
+	uint8_t id = heap[a];
+	heap[a] = heap[b];
+	heap[b] = id;
+	heapIndex[heap[a]] = a;
+	heapIndex[heap[b]] = b;
+}
+
+/**
+ * Moves a heap element up while it fires earlier than its parent.
+ */
+static void heapSiftUp(int pos) {
+	while (pos > 0) {
+		int parent = (pos - 1) / 2;
+		if (alarms[heap[parent]].time <= alarms[heap[pos]].time) {
+			break;
+		}
+		heapSwap(pos, parent);
+		pos = parent;
+	}
+}
+
+/**
+ * Moves a heap element down while one of its children fires earlier.
+ */
+static void heapSiftDown(int pos) {
+	for (;;) {
+		int smallest = pos;
+		int left = 2 * pos + 1;
+		int right = left + 1;
+
+		if (left < heapSize && alarms[heap[left]].time < alarms[heap[smallest]].time) {
+			smallest = left;
+		}
+		if (right < heapSize && alarms[heap[right]].time < alarms[heap[smallest]].time) {
+			smallest = right;
+		}
+		if (smallest == pos) {
+			break;
+		}
+		heapSwap(pos, smallest);
+		pos = smallest;
+	}
+}
+
+/**
+ * Checks whether an ID belongs to an alarm in the table.
+ */
+static bool alarmValid(int id) {
+	return id >= 0 && id < ALARM_CAPACITY && heapIndex[id] < heapSize;
+}
+
+/**
+ * Empties the alarm table.
+ */
+void AlarmsInit() {
+	for (int i = 0; i < ALARM_CAPACITY; i++) {
+		heap[i] = i;
+		heapIndex[i] = i;
+	}
+	heapSize = 0;
+}
+
+/**
+ * Adds an alarm to the table.
+ *
+ * @param alarm The alarm to be copied into the table.
+ * @return ID of the new alarm, ALARM_NONE if the table is full.
+ */
+int alarmAdd(const struct Alarm *alarm) {
+	if (heapSize >= ALARM_CAPACITY) {
+		return ALARM_NONE;
+	}
+
+	int id = heap[heapSize];
+	alarms[id] = *alarm;
+	heapSize++;
+	heapSiftUp(heapSize - 1);
+	changedAlarms |= 1u << id;
+	return id;
+}
+
+/**
+ * Removes an alarm from the table.
+ *
+ * @param id ID of the alarm.
+ * @return True if the alarm was removed, false if there is no such alarm.
+ */
+bool alarmRemove(int id) {
+	if (!alarmValid(id)) {
+		return false;
+	}
+
+	int pos = heapIndex[id];
+	heapSize--;
+	heapSwap(pos, heapSize); // The removed ID becomes the first free one
+	if (pos < heapSize) {
+		heapSiftDown(pos);
+		heapSiftUp(pos);
+	}
+	changedAlarms |= 1u << id;
+	return true;
+}
+
+/**
+ * Changes the next fire time of an alarm.
+ *
+ * @param id ID of the alarm.
+ * @param time New fire time in RTC seconds.
+ * @return True if the alarm was rescheduled, false if there is no such alarm.
+ */
+bool alarmReschedule(int id, uint32_t time) {
+	if (!alarmValid(id)) {
+		return false;
+	}
+
+	int pos = heapIndex[id];
+	alarms[id].time = time;
+	heapSiftUp(pos);
+	heapSiftDown(heapIndex[id]);
+	changedAlarms |= 1u << id;
+	return true;
+}
+
+/**
+ * Puts an alarm into the table under a given ID, replacing the alarm with that ID if
+ * there is one. Used to restore a saved table, the alarm is not reported as changed.
+ *
+ * @param id ID of the alarm.
+ * @param alarm The alarm to be copied into the table.
+ * @return True if the alarm was stored, false if the ID is out of range.
+ */
+bool alarmRestore(int id, const struct Alarm *alarm) {
+	if (id < 0 || id >= ALARM_CAPACITY) {
+		return false;
+	}
+
+	if (!alarmValid(id)) {
+		// Move the free ID to the start of the free part and take it
+		heapSwap(heapIndex[id], heapSize);
+		heapSize++;
+	}
+	alarms[id] = *alarm;
+	heapSiftUp(heapIndex[id]);
+	heapSiftDown(heapIndex[id]);
+	return true;
+}
+
+/**
+ * Returns the alarms that have been added, removed or rescheduled since the last call
+ * and forgets them, so that the changes can be saved.
+ *
+ * @return Bit per alarm ID.
+ */
+uint32_t alarmTakeChanges() {
+	uint32_t changes = changedAlarms;
+	changedAlarms = 0;
+	return changes;
+}
+
+/**
+ * Returns the alarm that fires first.
+ *
+ * @return ID of the alarm, ALARM_NONE if the table is empty.
+ */
+int alarmNext() {
+	return heapSize > 0 ? heap[0] : ALARM_NONE;
+}
+
+/**
+ * Returns an alarm of the table.
+ *
+ * @param id ID of the alarm.
+ * @return Pointer to the alarm, NULL if there is no such alarm.
+ */
+struct Alarm *alarmGet(int id) {
+	return alarmValid(id) ? &alarms[id] : NULL;
+}
+
+/**
+ * Returns the number of alarms in the table.
+ */
+int alarmCount() {
+	return heapSize;
+}
+
+/**
+ * Returns the ID of the n-th alarm of the table, in no particular order. Used to
+ * iterate over all alarms together with alarmCount().
+ *
+ * @param index Index from 0 to alarmCount() - 1.
+ * @return ID of the alarm.
+ */
+int alarmAt(int index) {
+	return index >= 0 && index < heapSize ? heap[index] : ALARM_NONE;
+}
+
+/**
+ * Returns the day of the week of a time.
+ *
+ * @param time Time in RTC seconds.
+ * @return 0 for Monday up to 6 for Sunday.
+ */
+int weekdayOf(uint32_t time) {
+	return (int) ((time / SECONDS_PER_DAY + 3) % 7); // 1970-01-01 was a Thursday
+}
+
+/**
+ * Computes the first occurrence of a recurring alarm later than the given time. The
+ * time of day and the step are taken from the current occurrence (baseTime), so no
+ * calendar conversion is needed.
+ *
+ * @param alarm The alarm.
+ * @param after The occurrence must be later than this time, in RTC seconds.
+ * @return Time of the occurrence, 0 if the alarm does not recur.
+ */
+uint32_t alarmNextOccurrence(const struct Alarm *alarm, uint32_t after) {
+	uint32_t step;
+
+	switch (alarm->recurrence) {
+	case ALARM_DAILY:
+		step = SECONDS_PER_DAY;
+		break;
+	case ALARM_EVERY:
+		if (alarm->period == 0) {
+			return 0;
+		}
+		step = alarm->period * 60u;
+		break;
+	case ALARM_WEEKDAYS: {
+		if ((alarm->weekdays & 0x7F) == 0) {
+			return 0;
+		}
+
+		// Same time of day as the current occurrence, on the first selected day
+		uint32_t time = after - after % SECONDS_PER_DAY
+				+ alarm->baseTime % SECONDS_PER_DAY;
+		if (time <= after) {
+			time += SECONDS_PER_DAY;
+		}
+		while (!(alarm->weekdays & (1 << weekdayOf(time)))) {
+			time += SECONDS_PER_DAY; // At most six times
+		}
+		return time;
+	}
+	default:
+		return 0;
+	}
+
+	if (alarm->baseTime > after) {
+		return alarm->baseTime;
+	}
+	return alarm->baseTime + ((after - alarm->baseTime) / step + 1) * step;
+}
+
+/**
+ * Computes the gap between a ring of an alarm and its next repeat. The gap is measured
+ * from the ring before, so a snoozed repeat moves the ones after it as well.
+ *
+ * @param alarm The alarm.
+ * @param repeat Index of the repeat, 1 to repeatCount.
+ * @return Seconds from the previous ring to the repeat.
+ */
+uint32_t alarmRepeatGap(const struct Alarm *alarm, int repeat) {
+	uint32_t interval = alarm->interval;
+
+	switch (alarm->backoff) {
+	case ALARM_BACKOFF_LINEAR:
+		return interval * (uint32_t) repeat;
+	case ALARM_BACKOFF_EXPONENTIAL:
+		if (repeat > ALARM_BACKOFF_MAX_DOUBLINGS) {
+			repeat = ALARM_BACKOFF_MAX_DOUBLINGS + 1;
+		}
+		return interval << (repeat - 1);
+	default:
+		return interval;
+	}
+}
+
+/**
+ * Computes the volume and brightness of the next ring of an alarm. An escalating alarm
+ * starts at ALARM_INTENSITY_START and reaches ALARM_INTENSITY_MAX with its last repeat.
+ *
+ * @param alarm The alarm.
+ * @return Intensity of the ring, up to ALARM_INTENSITY_MAX.
+ */
+uint8_t alarmIntensity(const struct Alarm *alarm) {
+	if (!alarm->escalate || alarm->repeatCount == 0) {
+		return ALARM_INTENSITY_MAX;
+	}
+	uint32_t step = (uint32_t) (ALARM_INTENSITY_MAX - ALARM_INTENSITY_START)
+			* alarm->repeatIndex / alarm->repeatCount;
+	return (uint8_t) (ALARM_INTENSITY_START + step);
+}
+
+/**
+ * Moves an alarm that has just fired to its next repeat, after the gap given by its
+ * repeat policy. After the last repeat a recurring alarm moves to its next occurrence,
+ * other alarms are removed from the table.
+ *
+ * @param id ID of the alarm.
+ */
+void alarmAdvance(int id) {
+	struct Alarm *alarm = alarmGet(id);
+
+	if (alarm->repeatIndex < alarm->repeatCount) {
+		alarm->repeatIndex++;
+		alarmReschedule(id, alarm->time + alarmRepeatGap(alarm, alarm->repeatIndex));
+		return;
+	}
+
+	uint32_t next = alarmNextOccurrence(alarm, alarm->time);
+	if (next != 0) {
+		alarm->baseTime = next;
+		alarm->repeatIndex = 0;
+		alarmReschedule(id, next);
+	} else {
+		alarmRemove(id);
+	}
+}
+
+/**
+ * Rings an alarm again later. An alarm with repeats left moves its next repeat there
+ * and the later repeats follow from it, after the last repeat the alarm rings once more
+ * as a copy.
+ *
+ * @param id ID the alarm had when it rang.
+ * @param rung The alarm as it was when it rang, before alarmAdvance().
+ * @param time Time of the snoozed ring in RTC seconds.
+ * @return ID of the alarm that rings at the time, ALARM_NONE if the table is full.
+ */
+int alarmSnooze(int id, const struct Alarm *rung, uint32_t time) {
+	struct Alarm *alarm = alarmGet(id);
+
+	// The same occurrence of the alarm with its next repeat still pending
+	if (alarm != NULL && alarm->baseTime == rung->baseTime
+			&& alarm->repeatIndex > rung->repeatIndex) {
+		alarmReschedule(id, time);
+		return id;
+	}
+
+	struct Alarm snooze = *rung;
+	snooze.time = time;
+	snooze.baseTime = time;
+	snooze.repeatCount = 0;
+	snooze.repeatIndex = 0;
+	snooze.recurrence = ALARM_ONCE;
+	return alarmAdd(&snooze);
+}
@@ -0,0 +1,83 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: alarms.h
+ * Description: Fixed-capacity alarm table ordered by the next fire time.
+ */
+
+#ifndef ALARMS_H
+#define ALARMS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ALARM_CAPACITY 32 // Maximum number of alarms, at most 32 for alarmTakeChanges()
+#define ALARM_NONE (-1)   // Returned instead of an alarm ID
+
+#define SECONDS_PER_DAY 86400u
+
+// How an alarm recurs after its last repeat
+enum AlarmRecurrence {
+	ALARM_ONCE,     // Removed after the last repeat
+	ALARM_DAILY,    // Every day at the same time
+	ALARM_WEEKDAYS, // At the same time on the days selected by weekdays
+	ALARM_EVERY     // Every period minutes
+};
+
+// How the gaps between the repeats of an alarm grow
+enum AlarmBackoff {
+	ALARM_BACKOFF_FIXED,      // Every gap is interval
+	ALARM_BACKOFF_LINEAR,     // Gaps of interval, 2 * interval, 3 * interval...
+	ALARM_BACKOFF_EXPONENTIAL // Gaps of interval, 2 * interval, 4 * interval...
+};
+
+#define ALARM_BACKOFF_MAX_DOUBLINGS 8 // Exponential gaps stop growing at 256 * interval
+
+#define ALARM_SNOOZE_SECONDS 300 // Delay of the ring added by the snooze button
+
+#define ALARM_INTENSITY_MAX   255 // Volume and brightness of a ring as the patterns are
+#define ALARM_INTENSITY_START 64  // First ring of an escalating alarm
+
+// Bits of Alarm.weekdays
+#define ALARM_MONDAY    0x01
+#define ALARM_TUESDAY   0x02
+#define ALARM_WEDNESDAY 0x04
+#define ALARM_THURSDAY  0x08
+#define ALARM_FRIDAY    0x10
+#define ALARM_SATURDAY  0x20
+#define ALARM_SUNDAY    0x40
+#define ALARM_WORKDAYS  0x1F
+
+// One alarm and the state of its repeats
+struct Alarm {
+	uint32_t time;        // Next fire time in RTC seconds, change only by alarmReschedule()
+	uint32_t baseTime;    // Time of the first ring of the current occurrence
+	uint16_t interval;    // Seconds between repeats
+	uint8_t repeatCount;  // Number of repeats after the first ring
+	uint8_t repeatIndex;  // Number of repeats already done
+	uint8_t melody;       // Melody ID, 1 to MELODY_COUNT
+	uint8_t lightEffect;  // Light effect ID, 1 to LIGHT_EFFECT_COUNT
+	uint8_t recurrence;   // enum AlarmRecurrence
+	uint8_t weekdays;     // ALARM_MONDAY..ALARM_SUNDAY bits for ALARM_WEEKDAYS
+	uint16_t period;      // Minutes between occurrences for ALARM_EVERY
+	uint8_t backoff;      // enum AlarmBackoff of the repeats
+	uint8_t escalate;     // Non-zero if the rings get louder and brighter with every repeat
+};
+
+void AlarmsInit();
+int alarmAdd(const struct Alarm *alarm);
+bool alarmRemove(int id);
+bool alarmReschedule(int id, uint32_t time);
+bool alarmRestore(int id, const struct Alarm *alarm);
+uint32_t alarmTakeChanges();
+int alarmNext();
+struct Alarm *alarmGet(int id);
+int alarmCount();
+int alarmAt(int index);
+uint32_t alarmNextOccurrence(const struct Alarm *alarm, uint32_t after);
+uint32_t alarmRepeatGap(const struct Alarm *alarm, int repeat);
+uint8_t alarmIntensity(const struct Alarm *alarm);
+void alarmAdvance(int id);
+int alarmSnooze(int id, const struct Alarm *rung, uint32_t time);
+int weekdayOf(uint32_t time);
+
+#endif /* ALARMS_H */
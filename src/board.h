@@ -0,0 +1,33 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: board.h
+ * Description: Hardware connections and clock settings of the FITkit 3 board shared by all modules.
+ */
+
+#ifndef BOARD_H
+#define BOARD_H
+
+// Define constants for LED, buttons, and speaker hardware connections
+#define LED_D9  0x20      // Port B, bit 5
+#define LED_D10 0x10      // Port B, bit 4
+#define LED_D11 0x8       // Port B, bit 3
+#define LED_D12 0x4       // Port B, bit 2
+#define LED_ALL 0x3C      // All four LEDs, active low
+
+#define BTN_SW2 0x400     // Port E, bit 10
+#define BTN_SW3 0x1000    // Port E, bit 12
+#define BTN_SW4 0x8000000 // Port E, bit 27
+#define BTN_SW5 0x4000000 // Port E, bit 26
+#define BTN_SW6 0x800     // Port E, bit 11
+
+#define SPK 0x10          // Speaker is on PTA4
+
+// MCUInit() runs the FLL from the 32.768 kHz reference with DMX32 and DRS = 1,
+// which gives 32768 * 1464 Hz. Core and bus clocks are not divided.
+#define CORE_CLOCK_HZ 47972352u
+#define BUS_CLOCK_HZ  CORE_CLOCK_HZ
+
+void MCUInit();
+void PortsInit();
+
+#endif /* BOARD_H */
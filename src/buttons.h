@@ -0,0 +1,25 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: buttons.h
+ * Description: Debounced interrupt-driven input from the buttons SW2-SW6. Every press is
+ * posted as deferred work with the button as the argument.
+ */
+
+#ifndef BUTTONS_H
+#define BUTTONS_H
+
+#include "work.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BUTTON_DEBOUNCE_MS 30 // Contacts are ignored this long after every edge
+
+enum Button {
+	BUTTON_SW2, BUTTON_SW3, BUTTON_SW4, BUTTON_SW5, BUTTON_SW6, BUTTON_COUNT
+};
+
+void ButtonsInit(WorkHandler pressed);
+bool buttonsNeedClocks();
+void PORTE_IRQHandler();
+
+#endif /* BUTTONS_H */
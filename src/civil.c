@@ -0,0 +1,150 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: civil.c
+ * Description: Conversion between RTC seconds and calendar time without the C library. The
+ * day count uses the era-based algorithms by Howard Hinnant, which need only integer
+ * arithmetic, touch no global state and can therefore be called from an interrupt handler.
+ */
+
+#include "civil.h"
+
+#define SECONDS_PER_DAY 86400u
+
+/**
+ * Converts a date of the proleptic Gregorian calendar to days since 1970-01-01.
+ *
+ * @param year Year.
+ * @param month Month, 1-12.
+ * @param day Day of the month, 1-31.
+ * @return Number of days, negative before 1970.
+ */
+int32_t daysFromCivil(int32_t year, int month, int day) {
+	year -= month <= 2;
+	int32_t era = (year >= 0 ? year : year - 399) / 400;
+	int32_t yearOfEra = year - era * 400;                                    // 0-399
+	int32_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1; // 0-365
+	int32_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+
+	return era * 146097 + dayOfEra - 719468;
+}
+
+/**
+ * Converts days since 1970-01-01 to a date of the proleptic Gregorian calendar.
+ *
+ * @param days Number of days.
+ * @param year Pointer to store year.
+ * @param month Pointer to store month.
+ * @param day Pointer to store day.
+ */
+void civilFromDays(int32_t days, int32_t *year, int *month, int *day) {
+	days += 719468;
+	int32_t era = (days >= 0 ? days : days - 146096) / 146097;
+	int32_t dayOfEra = days - era * 146097;                                  // 0-146096
+	int32_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524
+			- dayOfEra / 146096) / 365;                                      // 0-399
+	int32_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+	int32_t monthIndex = (5 * dayOfYear + 2) / 153;                          // 0-11, from March
+
+	*day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+	*month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+	*year = yearOfEra + era * 400 + (*month <= 2);
+}
+
+/**
+ * Returns the number of days of a month.
+ *
+ * @param year Year.
+ * @param month Month, 1-12.
+ * @return Number of days, 0 for an invalid month.
+ */
+int civilDaysInMonth(int year, int month) {
+	static const uint8_t days[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+	if (month < 1 || month > 12) {
+		return 0;
+	}
+	if (month == 2 && (year % 4 == 0 && (year % 100 != 0 || year % 400 == 0))) {
+		return 29;
+	}
+	return days[month - 1];
+}
+
+/**
+ * Checks whether a calendar time exists and fits the 32-bit RTC seconds counter.
+ *
+ * @param time The calendar time.
+ * @return True if the time is valid.
+ */
+bool civilValid(const struct CivilTime *time) {
+	return time->year >= 1970 && time->year <= 2105
+			&& time->day >= 1 && time->day <= civilDaysInMonth(time->year, time->month)
+			&& time->hour < 24 && time->minute < 60 && time->second < 60;
+}
+
+/**
+ * Converts a calendar time to RTC seconds.
+ *
+ * @param time The calendar time, see civilValid().
+ * @return Seconds since 1970-01-01 00:00:00.
+ */
+uint32_t civilToEpoch(const struct CivilTime *time) {
+	uint32_t days = (uint32_t) daysFromCivil(time->year, time->month, time->day);
+
+	return days * SECONDS_PER_DAY + time->hour * 3600u + time->minute * 60u
+			+ time->second;
+}
+
+/**
+ * Converts RTC seconds to a calendar time.
+ *
+ * @param epoch Seconds since 1970-01-01 00:00:00.
+ * @param time Where the calendar time is stored.
+ */
+void civilFromEpoch(uint32_t epoch, struct CivilTime *time) {
+	int32_t year;
+	int month, day;
+	uint32_t seconds = epoch % SECONDS_PER_DAY;
+
+	civilFromDays((int32_t) (epoch / SECONDS_PER_DAY), &year, &month, &day);
+	time->year = year;
+	time->month = month;
+	time->day = day;
+	time->hour = seconds / 3600;
+	time->minute = seconds / 60 % 60;
+	time->second = seconds % 60;
+}
+
+/**
+ * Writes two decimal digits.
+ */
+static char *putTwoDigits(char *p, unsigned value) {
+	p[0] = '0' + value / 10;
+	p[1] = '0' + value % 10;
+	return p + 2;
+}
+
+/**
+ * Formats RTC seconds as YYYY-MM-DD HH:MM:SS.
+ *
+ * @param epoch Seconds since 1970-01-01 00:00:00.
+ * @param buffer Where the text is stored, at least CIVIL_TIME_LENGTH + 1 bytes.
+ */
+void civilFormat(uint32_t epoch, char *buffer) {
+	struct CivilTime time;
+	char *p = buffer;
+
+	civilFromEpoch(epoch, &time);
+	p = putTwoDigits(p, time.year / 100);
+	p = putTwoDigits(p, time.year % 100);
+	*p++ = '-';
+	p = putTwoDigits(p, time.month);
+	*p++ = '-';
+	p = putTwoDigits(p, time.day);
+	*p++ = ' ';
+	p = putTwoDigits(p, time.hour);
+	*p++ = ':';
+	p = putTwoDigits(p, time.minute);
+	*p++ = ':';
+	p = putTwoDigits(p, time.second);
+	*p = '\0';
+}
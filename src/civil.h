@@ -0,0 +1,33 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: civil.h
+ * Description: Allocation-free, reentrant conversion between RTC seconds and calendar time.
+ */
+
+#ifndef CIVIL_H
+#define CIVIL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CIVIL_TIME_LENGTH 19 // Length of "YYYY-MM-DD HH:MM:SS"
+
+// Calendar date and time, the RTC counts seconds since 1970-01-01 00:00:00
+struct CivilTime {
+	uint16_t year;   // 1970-2105
+	uint8_t month;   // 1-12
+	uint8_t day;     // 1-31
+	uint8_t hour;    // 0-23
+	uint8_t minute;  // 0-59
+	uint8_t second;  // 0-59
+};
+
+int32_t daysFromCivil(int32_t year, int month, int day);
+void civilFromDays(int32_t days, int32_t *year, int *month, int *day);
+int civilDaysInMonth(int year, int month);
+bool civilValid(const struct CivilTime *time);
+uint32_t civilToEpoch(const struct CivilTime *time);
+void civilFromEpoch(uint32_t epoch, struct CivilTime *time);
+void civilFormat(uint32_t epoch, char *buffer);
+
+#endif /* CIVIL_H */
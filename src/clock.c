@@ -0,0 +1,310 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: clock.c
+ * Description: Setting of the RTC and compensation of its crystal drift. The drift is
+ * measured between two settings of the clock to a reference time, the first one starts the
+ * measurement and the second one programs the compensation that cancels the drift.
+ *
+ * The host synchronizes the clock with NTP-style exchanges: it sends its time T1, the
+ * clock answers with the times T2 and T3 the request came in and the reply went out, and
+ * the host sends back the time T4 the reply came in. Half of the round trip is taken as
+ * the time the request spent on the line, which gives the offset of the clock. Of a batch
+ * of exchanges the one with the shortest round trip is applied, it was delayed the least
+ * by the host and the line. A small offset is slewed: the compensation adds or removes up
+ * to RTC_TCR_MAX ticks every second until the offset is gone, so the clock never jumps
+ * and no second is lost or repeated. A large one is stepped without losing the phase.
+ */
+
+#include "clock.h"
+#include <stdbool.h>
+
+#define PPB 1000000000LL
+#define RTC_TCR_MAX 127 // Largest adjustment per interval, -128 is not used to keep it symmetric
+#define RTC_INTERVAL_MAX 256 // Longest compensation interval in seconds
+
+static bool measuring = false; // Set when the clock was set to a reference since reset
+static int64_t anchorTicks; // Time the clock was last set to, in prescaler ticks
+
+static struct ClockSample samples[CLOCK_SYNC_SAMPLES]; // Exchanges since clockSyncApply()
+static int sampleCount = 0;
+static bool slewing = false;
+static int64_t slewLeft;     // Correction still to be slewed, in billionths of a tick
+static int64_t slewTotal;    // Correction the slew started with, in billionths of a tick
+static int64_t slewBaseRate; // Billionths of a tick the compensation adds every second
+static uint16_t slewBase;    // Compensation restored when the slew ends
+
+/**
+ * Returns the time in prescaler ticks.
+ */
+static int64_t toTicks(const struct RtcTime *time) {
+	return (int64_t) time->seconds * RTC_PRESCALER_HZ + time->ticks;
+}
+
+/**
+ * Divides billionths by PPB, rounding to the nearest whole number.
+ */
+static int64_t nearest(int64_t billionths) {
+	return (billionths + (billionths < 0 ? -PPB / 2 : PPB / 2)) / PPB;
+}
+
+/**
+ * Ends a slew and restores the compensation. The part of the correction made so far is
+ * moved into the reference of the calibration, so it is not taken for drift.
+ */
+static void slewEnd() {
+	if (!slewing) {
+		return;
+	}
+	slewing = false;
+	rtcSetCompensation(slewBase);
+	anchorTicks += nearest(slewTotal - slewLeft);
+}
+
+/**
+ * Programs the adjustment of the next second of a slew, or ends the slew when less than
+ * half a tick is left. The compensation runs with an interval of one second, its usual
+ * rate is added so it does not pause for the slew.
+ */
+static void slewProgram() {
+	if (nearest(slewLeft) == 0) {
+		slewEnd();
+		return;
+	}
+
+	int64_t adjustment = nearest(slewLeft + slewBaseRate);
+	if (adjustment > RTC_TCR_MAX) {
+		adjustment = RTC_TCR_MAX;
+	} else if (adjustment < -RTC_TCR_MAX) {
+		adjustment = -RTC_TCR_MAX;
+	}
+	rtcSetCompensation((uint8_t) (int8_t) adjustment);
+}
+
+/**
+ * Sets the RTC. The time set is taken as the reference for the next calibration, a slew
+ * in progress and the exchanges of an unfinished sync are dropped.
+ *
+ * @param time The new time.
+ */
+void clockSet(const struct RtcTime *time) {
+	slewEnd();
+	sampleCount = 0;
+	rtcSetTime(time);
+	anchorTicks = toTicks(time);
+	measuring = true;
+}
+
+/**
+ * Converts a compensation to the rate it adds to the clock. A positive TCR shortens the
+ * seconds, so the clock runs faster.
+ *
+ * @param compensation Value in the format of rtcSetCompensation().
+ * @return Rate in parts per billion.
+ */
+int32_t clockCompensationPpb(uint16_t compensation) {
+	int32_t adjustment = (int8_t) (compensation & 0xFF);
+	int32_t interval = (compensation >> 8) + 1;
+
+	return (int32_t) (adjustment * PPB / ((int64_t) RTC_PRESCALER_HZ * interval));
+}
+
+/**
+ * Finds the compensation closest to a rate. The longest interval that keeps TCR in range
+ * gives the finest resolution, 0.12 ppm at 256 seconds.
+ *
+ * @param ppb Rate in parts per billion, at most RTC_TCR_MAX ticks per second.
+ * @return Value in the format of rtcSetCompensation().
+ */
+static uint16_t compensationFor(int64_t ppb) {
+	int64_t magnitude = ppb < 0 ? -ppb : ppb;
+	int64_t interval = RTC_INTERVAL_MAX;
+
+	if (magnitude * RTC_PRESCALER_HZ * RTC_INTERVAL_MAX > RTC_TCR_MAX * PPB) {
+		interval = RTC_TCR_MAX * PPB / (magnitude * RTC_PRESCALER_HZ);
+		if (interval < 1) {
+			interval = 1;
+		}
+	}
+
+	// Rounded to the nearest tick
+	int64_t adjustment = nearest(ppb * RTC_PRESCALER_HZ * interval);
+	if (adjustment > RTC_TCR_MAX) {
+		adjustment = RTC_TCR_MAX;
+	} else if (adjustment < -RTC_TCR_MAX) {
+		adjustment = -RTC_TCR_MAX;
+	} else if (adjustment == 0) {
+		return 0;
+	}
+
+	return (uint16_t) (((interval - 1) << 8) | ((uint8_t) (int8_t) adjustment));
+}
+
+/**
+ * Measures the drift of the RTC against a reference time and programs the compensation
+ * that cancels it. The drift is the difference of the time counted by the RTC and the
+ * reference since the clock was last set, the compensation programmed meanwhile is
+ * already part of it. The clock is set to the reference afterwards, which starts the next
+ * measurement.
+ *
+ * @param reference The reference time, as exact as the host can tell it.
+ * @param driftPpb Pointer to store the drift measured in parts per billion, a positive
+ * drift means the RTC was fast.
+ * @return Result of the calibration.
+ */
+enum ClockCalibration clockCalibrate(const struct RtcTime *reference, int32_t *driftPpb) {
+	struct RtcTime now;
+
+	*driftPpb = 0;
+	slewEnd(); // The compensation of a slew is not the one to correct
+	if (!measuring) {
+		clockSet(reference);
+		return CLOCK_CAL_STARTED;
+	}
+
+	rtcRead(&now);
+	int64_t counted = toTicks(&now) - anchorTicks;
+	int64_t elapsed = toTicks(reference) - anchorTicks;
+	if (elapsed < (int64_t) CLOCK_CALIBRATION_MIN_SECONDS * RTC_PRESCALER_HZ) {
+		return CLOCK_CAL_TOO_SHORT;
+	}
+
+	int64_t drift = (counted - elapsed) * PPB / elapsed;
+	int64_t target = clockCompensationPpb(rtcGetCompensation()) - drift;
+	clockSet(reference);
+
+	if (drift > INT32_MAX || drift < INT32_MIN) {
+		*driftPpb = drift > 0 ? INT32_MAX : INT32_MIN;
+		return CLOCK_CAL_RANGE;
+	}
+	*driftPpb = (int32_t) drift;
+	if ((target < 0 ? -target : target) * RTC_PRESCALER_HZ > RTC_TCR_MAX * PPB) {
+		return CLOCK_CAL_RANGE;
+	}
+
+	rtcSetCompensation(compensationFor(target));
+	return CLOCK_CAL_DONE;
+}
+
+/**
+ * Takes the timestamps of an exchange with the host into the batch of the next
+ * clockSyncApply(). A full batch keeps the exchanges with the shortest round trips.
+ *
+ * @param exchange The timestamps, host times T1 and T4 and RTC times T2 and T3.
+ * @return False if the timestamps cannot be of one exchange, the exchange is ignored.
+ */
+bool clockSyncSample(const struct ClockExchange *exchange) {
+	int64_t sent = toTicks(&exchange->sent);
+	int64_t received = toTicks(&exchange->received);
+	int64_t replied = toTicks(&exchange->replied);
+	int64_t returned = toTicks(&exchange->returned);
+	struct ClockSample sample = {
+		((received - sent) + (replied - returned)) / 2,
+		(returned - sent) - (replied - received)
+	};
+
+	if (sample.delay < 0 || replied < received) {
+		return false;
+	}
+	if (slewing) {
+		sample.offset += nearest(slewLeft); // The part still to be slewed is not an error
+	}
+
+	if (sampleCount < CLOCK_SYNC_SAMPLES) {
+		samples[sampleCount++] = sample;
+		return true;
+	}
+	int worst = 0;
+	for (int i = 1; i < sampleCount; i++) {
+		if (samples[i].delay > samples[worst].delay) {
+			worst = i;
+		}
+	}
+	if (sample.delay < samples[worst].delay) {
+		samples[worst] = sample;
+	}
+	return true;
+}
+
+/**
+ * Returns the number of exchanges taken since the last clockSyncApply().
+ */
+int clockSyncSamples() {
+	return sampleCount;
+}
+
+/**
+ * Corrects the clock by the offset of the exchange with the shortest round trip and
+ * starts a new batch. An offset up to CLOCK_SLEW_MAX_MS is slewed, replacing a slew in
+ * progress, clockSecond() then has to be called every second until clockSlewing() is
+ * false. A larger offset, or one the compensation has no room to slew, is stepped. Alarm
+ * times are not changed, the caller only has to program the next alarm again.
+ *
+ * @param applied Pointer to store the exchange applied, its offset as it was corrected.
+ * @return How the clock was corrected.
+ */
+enum ClockSync clockSyncApply(struct ClockSample *applied) {
+	if (sampleCount == 0) {
+		*applied = (struct ClockSample) { 0, 0 };
+		return CLOCK_SYNC_NONE;
+	}
+
+	int best = 0;
+	for (int i = 1; i < sampleCount; i++) {
+		if (samples[i].delay < samples[best].delay) {
+			best = i;
+		}
+	}
+	*applied = samples[best];
+	sampleCount = 0;
+
+	if (slewing) {
+		applied->offset -= nearest(slewLeft);
+	}
+	int64_t correction = -applied->offset;
+	int64_t magnitude = correction < 0 ? -correction : correction;
+	slewEnd();
+
+	int64_t basePpb = clockCompensationPpb(rtcGetCompensation());
+	if (magnitude <= (int64_t) CLOCK_SLEW_MAX_MS * RTC_PRESCALER_HZ / 1000
+			&& (basePpb < 0 ? -basePpb : basePpb) * RTC_PRESCALER_HZ * 2 <= RTC_TCR_MAX * PPB) {
+		slewing = true;
+		slewBase = rtcGetCompensation();
+		slewBaseRate = basePpb * RTC_PRESCALER_HZ;
+		slewLeft = correction * PPB;
+		slewTotal = slewLeft;
+		slewProgram();
+		return CLOCK_SYNC_SLEWED;
+	}
+
+	rtcStep(correction);
+	anchorTicks += correction;
+	return CLOCK_SYNC_STEPPED;
+}
+
+/**
+ * Tells whether the clock is being slewed.
+ */
+bool clockSlewing() {
+	return slewing;
+}
+
+/**
+ * Returns the correction still to be slewed in prescaler ticks, 0 if there is no slew.
+ */
+int64_t clockSlewLeft() {
+	return slewing ? nearest(slewLeft) : 0;
+}
+
+/**
+ * Counts the adjustment of the second that has just started into the slew and programs
+ * the next one. Has to be called once every second while clockSlewing(), a second left
+ * out loses its adjustment of at most RTC_TCR_MAX ticks. The adjustment is read back from
+ * the RTC, so a compensation interval still running when the slew started is no error.
+ */
+void clockSecond() {
+	if (!slewing) {
+		return;
+	}
+	slewLeft -= (int64_t) rtcCompensationApplied() * PPB - slewBaseRate;
+	slewProgram();
+}
@@ -0,0 +1,60 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: clock.h
+ * Description: Setting of the RTC and compensation of its crystal drift, measured against
+ * a reference time supplied by the host, and synchronization of the RTC to the host time.
+ */
+
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "rtc.h"
+
+#define CLOCK_CALIBRATION_MIN_SECONDS 600 // Shortest measurement accepted by clockCalibrate()
+#define CLOCK_SYNC_SAMPLES 8   // Exchanges kept by clockSyncSample() until clockSyncApply()
+#define CLOCK_SLEW_MAX_MS 1000 // Largest offset slewed by clockSyncApply(), larger ones are
+                               // stepped, 1 s takes about 4.3 minutes to slew
+
+// Result of clockCalibrate()
+enum ClockCalibration {
+	CLOCK_CAL_DONE,      // Compensation programmed, the clock set to the reference
+	CLOCK_CAL_STARTED,   // No measurement was running, the clock set and a measurement started
+	CLOCK_CAL_TOO_SHORT, // Not enough time since the measurement started, nothing changed
+	CLOCK_CAL_RANGE      // Drift out of the range of RTC_TCR, the clock set to the reference
+};
+
+// Result of clockSyncApply()
+enum ClockSync {
+	CLOCK_SYNC_NONE,    // No sample was taken, nothing changed
+	CLOCK_SYNC_SLEWED,  // The clock is slewed through the compensation to the host time
+	CLOCK_SYNC_STEPPED  // The clock was moved to the host time at once
+};
+
+// Timestamps of one NTP-style exchange with the host
+struct ClockExchange {
+	struct RtcTime sent;     // T1, host time the request was sent
+	struct RtcTime received; // T2, RTC time the request was received
+	struct RtcTime replied;  // T3, RTC time the reply was sent
+	struct RtcTime returned; // T4, host time the reply was received
+};
+
+// Offset of the clock found by an exchange
+struct ClockSample {
+	int64_t offset; // RTC minus host time in prescaler ticks, as it is once a slew in
+	                // progress has ended
+	int64_t delay;  // Round trip of the exchange without the time spent in the clock
+};
+
+void clockSet(const struct RtcTime *time);
+int32_t clockCompensationPpb(uint16_t compensation);
+enum ClockCalibration clockCalibrate(const struct RtcTime *reference, int32_t *driftPpb);
+bool clockSyncSample(const struct ClockExchange *exchange);
+int clockSyncSamples();
+enum ClockSync clockSyncApply(struct ClockSample *applied);
+bool clockSlewing();
+int64_t clockSlewLeft();
+void clockSecond();
+
+#endif /* CLOCK_H */
@@ -0,0 +1,136 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: command.c
+ * Description: Splitting and dispatching of one-line commands. A line is split in place in a
+ * single pass and looked up in a command table supplied by the caller. Replies are plain
+ * text lines starting with "OK" or "ERR" so that host scripts can send commands in batches
+ * and check every reply without parsing the interactive menu.
+ */
+
+#include "uart.h"
+#include "command.h"
+#include "text.h"
+#include <stddef.h>
+
+/**
+ * Checks whether a word of a command is the given name.
+ *
+ * @param word The word.
+ * @param name The expected name.
+ * @return True if the strings are equal.
+ */
+bool commandIs(const char *word, const char *name) {
+	while (*word != '\0' && *word == *name) {
+		word++;
+		name++;
+	}
+	return *word == *name;
+}
+
+/**
+ * Checks whether a line is a command rather than a menu choice. Commands start
+ * with a lowercase letter.
+ *
+ * @param text The line entered by the user.
+ * @return True if the line should be passed to commandExecute().
+ */
+bool commandIsCommand(const char *text) {
+	return text[0] >= 'a' && text[0] <= 'z';
+}
+
+/**
+ * Splits a line into words separated by spaces, the line is modified.
+ *
+ * @param text The line.
+ * @param line Where the words are stored.
+ * @return True if the line has at most COMMAND_MAX_WORDS words.
+ */
+static bool commandSplit(char *text, struct CommandLine *line) {
+	line->count = 0;
+
+	while (*text != '\0') {
+		if (*text == ' ') {
+			*text++ = '\0';
+			continue;
+		}
+		if (line->count == COMMAND_MAX_WORDS) {
+			return false;
+		}
+		line->words[line->count++] = text;
+		while (*text != '\0' && *text != ' ') {
+			text++;
+		}
+	}
+	return true;
+}
+
+/**
+ * Runs a command line. Unknown commands and lines with too many words are answered
+ * with an error.
+ *
+ * @param table Known commands.
+ * @param tableLength Number of entries in table.
+ * @param text The line, it is modified.
+ * @return True if a command was found and run.
+ */
+bool commandExecute(const struct Command *table, int tableLength, char *text) {
+	struct CommandLine line;
+
+	if (!commandSplit(text, &line)) {
+		commandError(TXT_TOO_MANY_WORDS);
+		return false;
+	}
+	if (line.count == 0) {
+		return false;
+	}
+
+	for (int i = 0; i < tableLength; i++) {
+		if (commandIs(line.words[0], table[i].name)) {
+			table[i].run(&line);
+			return true;
+		}
+	}
+	commandError(TXT_UNKNOWN_COMMAND);
+	return false;
+}
+
+/**
+ * Gets the value of a key=value parameter.
+ *
+ * @param word The parameter.
+ * @param key The expected key.
+ * @return The text after '=', or NULL if the word is not a value of this key.
+ */
+const char *commandValue(const char *word, const char *key) {
+	while (*key != '\0' && *key == *word) {
+		key++;
+		word++;
+	}
+	return (*key == '\0' && *word == '=') ? word + 1 : NULL;
+}
+
+/**
+ * Replies to a command that has succeeded.
+ *
+ * @param text Result of the command, NULL if there is none.
+ */
+void commandOk(const char *text) {
+	if (text != NULL) {
+		UARTSendStr("OK ");
+		UARTSendStr(text);
+		UARTSendStr("\n");
+	} else {
+		UARTSendStr("OK\n");
+	}
+}
+
+/**
+ * Replies to a command that has failed.
+ *
+ * @param text Reason of the failure.
+ */
+void commandError(const char *text) {
+	UARTSendStr("ERR ");
+	UARTSendStr(text);
+	UARTSendStr("\n");
+}
@@ -0,0 +1,32 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: command.h
+ * Description: One-line text commands of the console, e.g. "alarm add 2026-10-15 06:30:00 mel=2".
+ */
+
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include <stdbool.h>
+
+#define COMMAND_MAX_WORDS 12 // Words of one command including its name
+
+// Command split into words, the words point into the original line
+struct CommandLine {
+	char *words[COMMAND_MAX_WORDS];
+	int count;
+};
+
+struct Command {
+	const char *name;
+	void (*run)(struct CommandLine *line); // Replies with commandOk() or commandError()
+};
+
+bool commandIsCommand(const char *text);
+bool commandIs(const char *word, const char *name);
+bool commandExecute(const struct Command *table, int tableLength, char *text);
+const char *commandValue(const char *word, const char *key);
+void commandOk(const char *text);
+void commandError(const char *text);
+
+#endif /* COMMAND_H */
@@ -0,0 +1,139 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: console.c
+ * Description: Line editor of the UART console. Received characters are echoed and edited
+ * here, a finished line is handed to the continuation registered by the last prompt or to
+ * the default handler when no dialog is in progress. A dialog with several questions is a
+ * chain of continuations, so nothing ever waits for the user and the main loop keeps running.
+ * Binary frames of the host protocol are taken out of the stream before the editor sees them.
+ */
+
+#include "uart.h"
+#include "proto.h"
+#include "console.h"
+#include <stddef.h>
+
+static char line[CONSOLE_LINE_LENGTH]; // Line being edited
+static int lineLength = 0;
+static bool lastWasCR = false;         // Swallows the LF of a CR LF line end
+static bool echo = true;               // Characters are sent back as they are typed
+
+static LineHandler defaultHandler;     // Handles lines outside of dialogs
+static PromptHandler defaultPrompt;    // Invites input for defaultHandler
+static LineHandler continuation = NULL; // Handles the answer to the current prompt
+static const char *promptText = NULL;  // Current prompt, kept for consoleRedraw()
+
+/**
+ * Initializes the console.
+ *
+ * @param handler Called with lines entered outside of dialogs.
+ * @param prompt Called whenever a dialog ends to invite the next line for handler.
+ */
+void ConsoleInit(LineHandler handler, PromptHandler prompt) {
+	defaultHandler = handler;
+	defaultPrompt = prompt;
+	continuation = NULL;
+	promptText = NULL;
+	lineLength = 0;
+}
+
+/**
+ * Asks the user a question. Meant to be called from a line handler, the next line
+ * goes to the given continuation instead of the default handler.
+ *
+ * @param prompt Text of the question, must stay valid until it is answered.
+ * @param handler Called with the answer.
+ */
+void consolePrompt(const char *prompt, LineHandler handler) {
+	promptText = prompt;
+	continuation = handler;
+	UARTSendStr(prompt);
+}
+
+/**
+ * Shows the current prompt again together with what has been typed so far, used
+ * after other output has interrupted the user.
+ */
+void consoleRedraw() {
+	if (continuation != NULL) {
+		UARTSendStr("\n");
+		UARTSendStr(promptText);
+	} else {
+		defaultPrompt();
+	}
+
+	if (echo && lineLength > 0) {
+		line[lineLength] = '\0';
+		UARTSendStr(line);
+	}
+}
+
+/**
+ * Switches echoing of the typed characters on or off.
+ *
+ * @param enable True to echo.
+ */
+void consoleSetEcho(bool enable) {
+	echo = enable;
+}
+
+/**
+ * Hands a finished line over to its handler. A handler that does not ask another
+ * question ends the dialog and the default prompt is shown.
+ */
+static void consoleDispatch() {
+	LineHandler handler = continuation != NULL ? continuation : defaultHandler;
+
+	line[lineLength] = '\0';
+	lineLength = 0;
+	continuation = NULL;
+	promptText = NULL;
+
+	handler(line);
+
+	if (continuation == NULL) {
+		defaultPrompt();
+	}
+}
+
+/**
+ * Processes the received characters. Returns after at most one line has been handled
+ * so the other tasks of the main loop get their turn between lines.
+ */
+void consoleTask() {
+	char c;
+
+	while (UARTReadCh(&c)) {
+		if (protoFeed((uint8_t) c)) {
+			continue; // Byte of a binary frame
+		}
+
+		bool crlf = lastWasCR && c == '\n';
+		lastWasCR = c == '\r';
+		if (crlf) {
+			continue;
+		}
+
+		if (c == '\r' || c == '\n') {
+			if (echo) {
+				UARTSendStr("\n");
+			}
+			consoleDispatch();
+			return;
+		}
+
+		if (c == '\b' || c == '\177') {
+			if (lineLength > 0) {
+				lineLength--;
+				if (echo) {
+					UARTSendConst("\b \b");
+				}
+			}
+		} else if ((unsigned char) c >= ' ' && lineLength < CONSOLE_LINE_LENGTH - 1) {
+			line[lineLength++] = c;
+			if (echo) {
+				SendCh(c);
+			}
+		}
+	}
+}
@@ -0,0 +1,23 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: console.h
+ * Description: Non-blocking line editor of the UART console with per-prompt continuations.
+ */
+
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <stdbool.h>
+
+#define CONSOLE_LINE_LENGTH 100 // Longest line including the terminating null
+
+typedef void (*LineHandler)(char *line); // Called with every line the user enters
+typedef void (*PromptHandler)();          // Shows the prompt of the default handler
+
+void ConsoleInit(LineHandler handler, PromptHandler prompt);
+void consolePrompt(const char *prompt, LineHandler handler);
+void consoleRedraw();
+void consoleSetEcho(bool enable);
+void consoleTask();
+
+#endif /* CONSOLE_H */
@@ -0,0 +1,25 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: crc.c
+ * Description: CRC-16/CCITT (polynomial 0x1021), computed bit by bit to keep the code small.
+ */
+
+#include "crc.h"
+
+/**
+ * Updates a CRC-16/CCITT with a block of data.
+ *
+ * @param crc CRC of the preceding data, CRC16_INIT at the start.
+ * @param data The data.
+ * @param length Number of bytes.
+ * @return CRC including the data.
+ */
+uint16_t crc16(uint16_t crc, const uint8_t *data, uint16_t length) {
+	while (length-- > 0) {
+		crc ^= (uint16_t) (*data++ << 8);
+		for (int i = 0; i < 8; i++) {
+			crc = (crc & 0x8000) ? (uint16_t) (crc << 1 ^ 0x1021) : (uint16_t) (crc << 1);
+		}
+	}
+	return crc;
+}
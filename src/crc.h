@@ -0,0 +1,16 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: crc.h
+ * Description: CRC-16/CCITT used by the host protocol and the flash log.
+ */
+
+#ifndef CRC_H
+#define CRC_H
+
+#include <stdint.h>
+
+#define CRC16_INIT 0xFFFF // Initial value of crc16()
+
+uint16_t crc16(uint16_t crc, const uint8_t *data, uint16_t length);
+
+#endif /* CRC_H */
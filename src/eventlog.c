@@ -0,0 +1,78 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: eventlog.c
+ * Description: Ring of the last EVENT_LOG_SIZE events. Every event gets a sequence number
+ * counted from boot, so a host reading the log in pieces can tell where it stopped and how
+ * much has been overwritten in between. Logging an event is one store into the ring.
+ */
+
+#include "rtc.h"
+#include "eventlog.h"
+
+static struct Event events[EVENT_LOG_SIZE];
+static uint32_t nextSequence = 0; // Sequence number of the next event
+
+/**
+ * Empties the log.
+ */
+void EventLogInit() {
+	nextSequence = 0;
+}
+
+/**
+ * Adds an event with the current time.
+ *
+ * @param type What happened.
+ * @param alarm ID of the alarm it happened to, ALARM_NONE or EVENT_NO_ALARM if none.
+ * @param repeat Repeat index of the alarm.
+ * @param detail Depends on the type.
+ */
+void eventLog(enum EventType type, int alarm, int repeat, uint8_t detail) {
+	struct Event *event = &events[nextSequence & (EVENT_LOG_SIZE - 1)];
+
+	event->time = rtcSeconds();
+	event->type = (uint8_t) type;
+	event->alarm = alarm >= 0 && alarm < EVENT_NO_ALARM ? (uint8_t) alarm : EVENT_NO_ALARM;
+	event->repeat = (uint8_t) repeat;
+	event->detail = detail;
+	nextSequence++;
+}
+
+/**
+ * Adds an event read back from the flash log at boot.
+ */
+void eventLogRestore(const struct Event *event) {
+	events[nextSequence & (EVENT_LOG_SIZE - 1)] = *event;
+	nextSequence++;
+}
+
+/**
+ * Returns the sequence number the next event will get, i.e. the number of events
+ * logged since boot.
+ */
+uint32_t eventLogNext() {
+	return nextSequence;
+}
+
+/**
+ * Returns the sequence number of the oldest event still in the log.
+ */
+uint32_t eventLogOldest() {
+	return nextSequence > EVENT_LOG_SIZE ? nextSequence - EVENT_LOG_SIZE : 0;
+}
+
+/**
+ * Reads an event of the log.
+ *
+ * @param sequence Sequence number of the event.
+ * @param event Set to the event.
+ * @return True if the event is in the log, false if it has been overwritten or has not
+ * been logged yet.
+ */
+bool eventLogGet(uint32_t sequence, struct Event *event) {
+	if (sequence < eventLogOldest() || sequence >= nextSequence) {
+		return false;
+	}
+	*event = events[sequence & (EVENT_LOG_SIZE - 1)];
+	return true;
+}
@@ -0,0 +1,51 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: eventlog.h
+ * Description: Fixed-size log of the alarm rings and the user actions, kept in RAM and
+ * optionally mirrored to the flash log. Written from the main loop only.
+ */
+
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define EVENT_LOG_SIZE 64   // Records kept, older ones are overwritten, power of two
+#define EVENT_NO_ALARM 0xFF // Event.alarm of events that do not belong to an alarm
+
+// What happened
+enum EventType {
+	EVENT_BOOT,             // Firmware started, detail is the enum RtcStart
+	EVENT_ALARM_RANG,       // Alarm started ringing
+	EVENT_ALARM_SNOOZED,    // Ringing alarm snoozed by SW2
+	EVENT_ALARM_DISMISSED,  // Ringing alarm dismissed by SW3
+	EVENT_RING_ENDED,       // Ring played to its end without anyone reacting
+	EVENT_ALARM_SKIPPED,    // Occurrences of the alarm in the past were skipped
+	EVENT_ALARM_ADDED,
+	EVENT_ALARM_DELETED,
+	EVENT_ALARMS_ON,
+	EVENT_ALARMS_OFF,
+	EVENT_TIME_SET,         // Clock set or moved by the buttons
+	EVENT_CALIBRATED,       // Drift compensation changed by a calibration
+	EVENT_TIME_SYNCED,      // Clock corrected by a time sync, detail is the enum ClockSync
+	EVENT_TYPE_COUNT
+};
+
+// One record of the log, 8 bytes as it is sent to the host and kept in flash
+struct Event {
+	uint32_t time;  // RTC seconds
+	uint8_t type;   // enum EventType
+	uint8_t alarm;  // Alarm ID, EVENT_NO_ALARM if none
+	uint8_t repeat; // Repeat index of the alarm, 0 for the first ring
+	uint8_t detail; // Depends on the type, 0 if unused
+};
+
+void EventLogInit();
+void eventLog(enum EventType type, int alarm, int repeat, uint8_t detail);
+void eventLogRestore(const struct Event *event);
+uint32_t eventLogNext();
+uint32_t eventLogOldest();
+bool eventLogGet(uint32_t sequence, struct Event *event);
+
+#endif /* EVENTLOG_H */
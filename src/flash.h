@@ -0,0 +1,18 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: flash.h
+ * Description: Erasing and programming of the program flash used by the record log.
+ */
+
+#ifndef FLASH_H
+#define FLASH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+void FlashInit();
+const uint8_t *flashPointer(uint32_t address);
+bool flashErase(uint32_t address);
+bool flashProgram(uint32_t address, uint32_t value);
+
+#endif /* FLASH_H */
@@ -0,0 +1,217 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: fmt.c
+ * Description: Zero-allocation text formatter and strict parser. The formatter appends
+ * strings and integers to a caller buffer, the parsers accept exactly the menu number and
+ * YYYY-MM-DD HH:MM:SS formats and report the position of the first character they reject.
+ * Nothing here uses stdio, so printf and scanf are not linked at all.
+ */
+
+#include "fmt.h"
+
+/**
+ * Starts building a text in a buffer.
+ *
+ * @param f The formatter.
+ * @param buffer Where the text is stored.
+ * @param size The size of the buffer, at least 1.
+ */
+void fmtInit(struct Formatter *f, char *buffer, uint16_t size) {
+	f->buffer = buffer;
+	f->size = size;
+	f->length = 0;
+	buffer[0] = '\0';
+}
+
+/**
+ * Appends a character, it is dropped when the buffer is full.
+ */
+void fmtChar(struct Formatter *f, char ch) {
+	if (f->length + 1 < f->size) {
+		f->buffer[f->length++] = ch;
+		f->buffer[f->length] = '\0';
+	}
+}
+
+/**
+ * Appends a string.
+ */
+void fmtStr(struct Formatter *f, const char *s) {
+	while (*s != '\0' && f->length + 1 < f->size) {
+		f->buffer[f->length++] = *s++;
+	}
+	f->buffer[f->length] = '\0';
+}
+
+/**
+ * Appends an unsigned decimal number padded with zeros to the given width.
+ *
+ * @param f The formatter.
+ * @param value The number.
+ * @param width Minimal number of digits, up to 10.
+ */
+void fmtUintPad(struct Formatter *f, uint32_t value, int width) {
+	char digits[10];
+	int n = 0;
+
+	do {
+		digits[n++] = '0' + value % 10;
+		value /= 10;
+	} while (value != 0);
+	while (n < width && n < (int) sizeof(digits)) {
+		digits[n++] = '0';
+	}
+	while (n > 0) {
+		fmtChar(f, digits[--n]);
+	}
+}
+
+/**
+ * Appends an unsigned decimal number.
+ */
+void fmtUint(struct Formatter *f, uint32_t value) {
+	fmtUintPad(f, value, 1);
+}
+
+/**
+ * Appends a signed decimal number.
+ */
+void fmtInt(struct Formatter *f, int32_t value) {
+	if (value < 0) {
+		fmtChar(f, '-');
+		fmtUint(f, 0u - (uint32_t) value);
+	} else {
+		fmtUint(f, (uint32_t) value);
+	}
+}
+
+/**
+ * Appends a fixed-point number, e.g. value 1234 with scale 100 gives "12.34".
+ *
+ * @param f The formatter.
+ * @param value The number multiplied by scale.
+ * @param scale 10, 100 or 1000 for one, two or three decimals.
+ */
+void fmtFixed(struct Formatter *f, uint32_t value, uint32_t scale) {
+	int decimals = scale >= 1000 ? 3 : scale >= 100 ? 2 : 1;
+
+	fmtUint(f, value / scale);
+	fmtChar(f, '.');
+	fmtUintPad(f, value % scale, decimals);
+}
+
+/**
+ * Appends a hexadecimal number padded with zeros to the given width.
+ */
+void fmtHex(struct Formatter *f, uint32_t value, int width) {
+	for (int shift = (width - 1) * 4; shift >= 0; shift -= 4) {
+		fmtChar(f, "0123456789ABCDEF"[(value >> shift) & 0xF]);
+	}
+}
+
+/**
+ * Appends a time as YYYY-MM-DD HH:MM:SS.
+ *
+ * @param f The formatter.
+ * @param epoch Time in RTC seconds.
+ */
+void fmtTime(struct Formatter *f, uint32_t epoch) {
+	char text[CIVIL_TIME_LENGTH + 1];
+
+	civilFormat(epoch, text);
+	fmtStr(f, text);
+}
+
+/**
+ * Parses an unsigned decimal number that makes up the whole string.
+ *
+ * @param s The string.
+ * @param max Largest accepted value.
+ * @param value Where the number is stored.
+ * @return PARSE_OK, or the position of the first rejected character.
+ */
+int parseUint(const char *s, uint32_t max, uint32_t *value) {
+	uint32_t result = 0;
+	int i = 0;
+
+	if (s[0] < '0' || s[0] > '9') {
+		return 0;
+	}
+	for (; s[i] >= '0' && s[i] <= '9'; i++) {
+		uint32_t digit = s[i] - '0';
+		if (digit > max || result > (max - digit) / 10) {
+			return i; // The number would exceed max
+		}
+		result = result * 10 + digit;
+	}
+	if (s[i] != '\0') {
+		return i;
+	}
+
+	*value = result;
+	return PARSE_OK;
+}
+
+/**
+ * Parses a fixed-width decimal field.
+ *
+ * @return PARSE_OK, or the position of the first rejected character.
+ */
+static int parseField(const char *s, int pos, int width, uint32_t min, uint32_t max,
+		uint32_t *value) {
+	uint32_t result = 0;
+
+	for (int i = 0; i < width; i++) {
+		if (s[pos + i] < '0' || s[pos + i] > '9') {
+			return pos + i;
+		}
+		result = result * 10 + (s[pos + i] - '0');
+	}
+	if (result < min || result > max) {
+		return pos;
+	}
+
+	*value = result;
+	return PARSE_OK;
+}
+
+/**
+ * Parses a date and time in the exact format YYYY-MM-DD HH:MM:SS and checks that it
+ * exists and fits the RTC.
+ *
+ * @param s The string.
+ * @param time Where the date and time are stored.
+ * @return PARSE_OK, or the position of the first rejected character.
+ */
+int parseDateTime(const char *s, struct CivilTime *time) {
+	static const char separators[] = "-- ::"; // Character after each field
+	static const uint8_t positions[] = { 0, 5, 8, 11, 14, 17 };
+	static const uint8_t widths[] = { 4, 2, 2, 2, 2, 2 };
+	static const uint16_t minimums[] = { 1970, 1, 1, 0, 0, 0 };
+	static const uint16_t maximums[] = { 2105, 12, 31, 23, 59, 59 };
+	uint32_t fields[6];
+
+	for (int i = 0; i < 6; i++) {
+		int error = parseField(s, positions[i], widths[i], minimums[i], maximums[i],
+				&fields[i]);
+		if (error != PARSE_OK) {
+			return error;
+		}
+
+		int end = positions[i] + widths[i];
+		if (i < 5 ? s[end] != separators[i] : s[end] != '\0') {
+			return end;
+		}
+	}
+
+	time->year = fields[0];
+	time->month = fields[1];
+	time->day = fields[2];
+	time->hour = fields[3];
+	time->minute = fields[4];
+	time->second = fields[5];
+	if (!civilValid(time)) {
+		return positions[2]; // Day out of range for the month
+	}
+	return PARSE_OK;
+}
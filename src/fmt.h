@@ -0,0 +1,36 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: fmt.h
+ * Description: Small zero-allocation text formatter and strict parser used instead of stdio.
+ */
+
+#ifndef FMT_H
+#define FMT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "civil.h"
+
+#define PARSE_OK (-1) // Returned by the parsers when the whole input was accepted
+
+// Text being built in a caller buffer, always null-terminated and silently truncated
+struct Formatter {
+	char *buffer;
+	uint16_t size;
+	uint16_t length;
+};
+
+void fmtInit(struct Formatter *f, char *buffer, uint16_t size);
+void fmtStr(struct Formatter *f, const char *s);
+void fmtChar(struct Formatter *f, char ch);
+void fmtUint(struct Formatter *f, uint32_t value);
+void fmtInt(struct Formatter *f, int32_t value);
+void fmtUintPad(struct Formatter *f, uint32_t value, int width);
+void fmtFixed(struct Formatter *f, uint32_t value, uint32_t scale);
+void fmtHex(struct Formatter *f, uint32_t value, int width);
+void fmtTime(struct Formatter *f, uint32_t epoch);
+
+int parseUint(const char *s, uint32_t max, uint32_t *value);
+int parseDateTime(const char *s, struct CivilTime *time);
+
+#endif /* FMT_H */
@@ -0,0 +1,19 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: board.c
+ * Description: Clocks and pins of the simulated board, there is nothing to set up.
+ */
+
+#include "board.h"
+
+/**
+ * Nothing to set up.
+ */
+void MCUInit() {
+}
+
+/**
+ * Nothing to set up.
+ */
+void PortsInit() {
+}
@@ -0,0 +1,43 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: buttons.c
+ * Description: Buttons of the simulated MCU, pressed by simPressButton(). The presses are
+ * clean, so there is nothing to debounce.
+ */
+
+#include "work.h"
+#include "buttons.h"
+#include <stddef.h>
+#include "sim.h"
+
+static WorkHandler pressedHandler = NULL;
+static enum Button pressedButton; // Delivered by the next button interrupt
+
+/**
+ * Stores the handler of the presses.
+ */
+void ButtonsInit(WorkHandler pressed) {
+	pressedHandler = pressed;
+}
+
+/**
+ * Button interrupt, posts the press.
+ */
+static void buttonInterrupt() {
+	workPost(pressedHandler, (uint32_t) pressedButton); // A full queue drops the press
+}
+
+/**
+ * Presses a button.
+ */
+void simPressButton(enum Button button) {
+	pressedButton = button;
+	simInterrupt(buttonInterrupt);
+}
+
+/**
+ * No button is ever being debounced.
+ */
+bool buttonsNeedClocks() {
+	return false;
+}
@@ -0,0 +1,94 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: flash.c
+ * Description: Program flash of the simulated MCU. Only the area of the record log exists,
+ * it is kept in the file named by CHRONPROC_FLASH (chronproc-flash.bin by default), so the
+ * settings and alarms survive a restart of the simulation. Programming can only clear
+ * bits, like on the real flash.
+ */
+
+#include "storage.h"
+#include "flash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FLASH_SIZE (STORAGE_SECTOR_SIZE * STORAGE_SECTOR_COUNT)
+
+static uint8_t memory[FLASH_SIZE];
+static const char *path = NULL; // File with the content, NULL when it cannot be used
+
+/**
+ * Loads the flash from its file, a missing file is erased flash.
+ */
+void FlashInit() {
+	path = getenv("CHRONPROC_FLASH");
+	if (path == NULL) {
+		path = "chronproc-flash.bin";
+	}
+
+	memset(memory, 0xFF, sizeof(memory));
+	FILE *file = fopen(path, "rb");
+	if (file != NULL) {
+		if (fread(memory, 1, sizeof(memory), file) != sizeof(memory)) {
+			memset(memory, 0xFF, sizeof(memory));
+		}
+		fclose(file);
+	}
+}
+
+/**
+ * Writes the flash back to its file.
+ */
+static void flashSave() {
+	FILE *file = path != NULL ? fopen(path, "wb") : NULL;
+
+	if (file != NULL) {
+		fwrite(memory, 1, sizeof(memory), file);
+		fclose(file);
+	}
+}
+
+/**
+ * Checks whether an access lies in the simulated flash.
+ */
+static bool flashValid(uint32_t address, uint32_t size) {
+	return address >= STORAGE_BASE && address - STORAGE_BASE + size <= FLASH_SIZE;
+}
+
+/**
+ * Returns a pointer to read the flash at an address of the log area.
+ */
+const uint8_t *flashPointer(uint32_t address) {
+	return flashValid(address, 4) ? &memory[address - STORAGE_BASE] : NULL;
+}
+
+/**
+ * Erases a sector of the flash.
+ */
+bool flashErase(uint32_t address) {
+	if (!flashValid(address, STORAGE_SECTOR_SIZE) || address % STORAGE_SECTOR_SIZE != 0) {
+		return false;
+	}
+	memset(&memory[address - STORAGE_BASE], 0xFF, STORAGE_SECTOR_SIZE);
+	flashSave();
+	return true;
+}
+
+/**
+ * Programs a longword of erased flash.
+ *
+ * @return True if the longword reads back as the value.
+ */
+bool flashProgram(uint32_t address, uint32_t value) {
+	uint32_t word;
+
+	if (!flashValid(address, 4) || address % 4 != 0) {
+		return false;
+	}
+	memcpy(&word, &memory[address - STORAGE_BASE], 4);
+	word &= value;
+	memcpy(&memory[address - STORAGE_BASE], &word, 4);
+	flashSave();
+	return word == value;
+}
@@ -0,0 +1,35 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: irq.h
+ * Description: Interrupt masking and waiting of the simulated MCU for the portable modules.
+ */
+
+#ifndef IRQ_H
+#define IRQ_H
+
+#include "sim.h"
+
+/**
+ * Masks all interrupts.
+ *
+ * @return State to be passed to irqRestore().
+ */
+static inline uint32_t irqSave() {
+	return simIrqSave();
+}
+
+/**
+ * Unmasks the interrupts again unless they were already masked before irqSave().
+ */
+static inline void irqRestore(uint32_t state) {
+	simIrqRestore(state);
+}
+
+/**
+ * Waits for the next interrupt, see simWaitForInterrupt().
+ */
+static inline void waitForInterrupt() {
+	simWaitForInterrupt();
+}
+
+#endif /* IRQ_H */
@@ -0,0 +1,66 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: power.c
+ * Description: Idle modes of the simulated MCU. Both modes wait for the next interrupt, the
+ * time base keeps running in either of them.
+ */
+
+#include "timer.h"
+#include "irq.h"
+#include "power.h"
+
+static uint64_t waitUs = 0; // Total time spent waiting with the clocks running
+static uint64_t deepUs = 0; // Total time spent in what would be VLPS
+
+/**
+ * Nothing to set up.
+ */
+void PowerInit() {
+}
+
+/**
+ * Waits for the next interrupt and counts the time for the statistics.
+ *
+ * @param deep True if the chip would enter VLPS.
+ */
+void powerSleep(bool deep) {
+	uint32_t start = timerMicros();
+
+	waitForInterrupt();
+	if (deep) {
+		deepUs += timerMicros() - start;
+	} else {
+		waitUs += timerMicros() - start;
+	}
+}
+
+/**
+ * Returns the share of time the core was running since the start.
+ *
+ * @return Active time in tenths of a percent.
+ */
+uint32_t powerActivePermille() {
+	uint64_t totalUs = (uint64_t) timerMillis() * 1000u;
+
+	if (totalUs == 0 || waitUs + deepUs >= totalUs) {
+		return totalUs == 0 ? 1000 : 0;
+	}
+	return (uint32_t) (((totalUs - waitUs - deepUs) * 1000u) / totalUs);
+}
+
+/**
+ * Estimates the average supply current the board would draw, see the K60 version.
+ *
+ * @return Average current in microamperes.
+ */
+uint32_t powerAverageCurrentUa() {
+	uint64_t totalUs = (uint64_t) timerMillis() * 1000u;
+
+	if (totalUs == 0 || waitUs + deepUs >= totalUs) {
+		return POWER_RUN_CURRENT_UA;
+	}
+	uint64_t runUs = totalUs - waitUs - deepUs;
+	uint64_t charge = runUs * POWER_RUN_CURRENT_UA + waitUs * POWER_WAIT_CURRENT_UA
+			+ deepUs * POWER_VLPS_CURRENT_UA;
+	return (uint32_t) (charge / totalUs);
+}
@@ -0,0 +1,47 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: pwm.c
+ * Description: LED outputs of the simulated MCU, the bit planes shown can be read by
+ * simLedPlanes().
+ */
+
+#include "pwm.h"
+#include "sim.h"
+
+static uint8_t planes[PWM_BITS]; // LED bits that are on in each slot
+static bool running = false;     // Some LED is dimmed
+
+/**
+ * Nothing to set up.
+ */
+void PwmInit() {
+}
+
+/**
+ * Shows new bit planes.
+ *
+ * @param newPlanes PWM_BITS masks of the LED bits that are on in each slot.
+ * @param on Mask of the LEDs that are fully on.
+ * @param modulate True if some LED is dimmed.
+ */
+void pwmShow(const uint8_t *newPlanes, uint8_t on, bool modulate) {
+	(void) on;
+	for (int k = 0; k < PWM_BITS; k++) {
+		planes[k] = newPlanes[k];
+	}
+	running = modulate;
+}
+
+/**
+ * Checks whether some LED is dimmed.
+ */
+bool pwmRunning() {
+	return running;
+}
+
+/**
+ * Returns the bit planes shown.
+ */
+const uint8_t *simLedPlanes() {
+	return planes;
+}
@@ -0,0 +1,164 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: rtc.c
+ * Description: RTC of the simulated MCU, counted by the time base. It starts from the time
+ * of the host, like an RTC that kept running from VBAT. The simulated crystal does not
+ * drift, the compensation is applied at the end of every second the way RTC_TCR does.
+ */
+
+#include "timer.h"
+#include "irq.h"
+#include "work.h"
+#include "rtc.h"
+#include <stddef.h>
+#include <time.h>
+
+static WorkHandler alarmHandler = NULL;
+static volatile uint64_t elapsedMs = 0; // Time base ticks since RTCInit()
+static int64_t baseTicks = 0;           // RTC time at RTCInit() in prescaler ticks
+static volatile uint32_t alarmSeconds = 0;
+static WorkHandler secondsHandler = NULL;
+static uint32_t lastSecond = 0;         // Second seen by the previous tick
+static uint16_t compensation = 0;
+static uint8_t intervalCount = 0;       // Seconds left of the compensation interval, CIC
+static int8_t applied = 0;              // Adjustment of the present second, TCV
+
+static void rtcTick();
+
+/**
+ * Returns the RTC time in prescaler ticks.
+ */
+static int64_t nowTicks() {
+	uint32_t state = irqSave();
+	int64_t ticks = baseTicks + (int64_t) (elapsedMs * RTC_PRESCALER_HZ / 1000u);
+	irqRestore(state);
+	return ticks;
+}
+
+/**
+ * Starts the RTC at the time of the host.
+ *
+ * @param alarm Posted as deferred work with the alarm second when the alarm fires.
+ * @return RTC_WARM_START.
+ */
+enum RtcStart RTCInit(WorkHandler alarm) {
+	alarmHandler = alarm;
+	baseTicks = (int64_t) time(NULL) * RTC_PRESCALER_HZ;
+	timerAddTickHandler(rtcTick);
+	return RTC_WARM_START;
+}
+
+/**
+ * Time base handler, counts the time, fires the alarm and posts the seconds handler.
+ */
+static void rtcTick() {
+	elapsedMs++;
+
+	uint32_t second = rtcSeconds();
+	if (second != lastSecond) {
+		lastSecond = second;
+
+		// The last second of an interval is shortened by TCR, the others are not moved
+		if (intervalCount == 0) {
+			intervalCount = (uint8_t) (compensation >> 8);
+			applied = (int8_t) (compensation & 0xFF);
+		} else {
+			intervalCount--;
+			applied = 0;
+		}
+		baseTicks += applied;
+
+		if (secondsHandler != NULL) {
+			workPost(secondsHandler, second);
+		}
+	}
+
+	if (alarmSeconds != 0 && second >= alarmSeconds) {
+		workPost(alarmHandler, alarmSeconds);
+		alarmSeconds = 0;
+	}
+}
+
+/**
+ * Returns the whole seconds of the time.
+ */
+uint32_t rtcSeconds() {
+	return (uint32_t) (nowTicks() / RTC_PRESCALER_HZ);
+}
+
+/**
+ * Reads the RTC.
+ */
+void rtcRead(struct RtcTime *time) {
+	int64_t ticks = nowTicks();
+
+	time->seconds = (uint32_t) (ticks / RTC_PRESCALER_HZ);
+	time->ticks = (uint16_t) (ticks % RTC_PRESCALER_HZ);
+}
+
+/**
+ * Reads the RTC as microseconds.
+ */
+uint64_t rtcMicros() {
+	return (uint64_t) nowTicks() * 1000000u / RTC_PRESCALER_HZ;
+}
+
+/**
+ * Sets the RTC.
+ */
+void rtcSetTime(const struct RtcTime *time) {
+	uint32_t state = irqSave();
+	baseTicks = (int64_t) time->seconds * RTC_PRESCALER_HZ + time->ticks
+			- (int64_t) (elapsedMs * RTC_PRESCALER_HZ / 1000u);
+	irqRestore(state);
+}
+
+/**
+ * Moves the RTC by a number of ticks.
+ *
+ * @param ticks Prescaler ticks to add, negative to move the clock back.
+ */
+void rtcStep(int64_t ticks) {
+	uint32_t state = irqSave();
+	baseTicks += ticks;
+	irqRestore(state);
+}
+
+/**
+ * Programs the alarm, it fires once the time reaches the given second.
+ *
+ * @param seconds Time of the alarm, 0 for no alarm.
+ */
+void rtcSetAlarm(uint32_t seconds) {
+	alarmSeconds = seconds;
+}
+
+/**
+ * Sets the handler posted every time the second changes.
+ *
+ * @param handler Posted as deferred work with the new second, NULL to stop.
+ */
+void rtcSetSecondsHandler(WorkHandler handler) {
+	secondsHandler = handler;
+}
+
+/**
+ * Stores the drift compensation.
+ */
+void rtcSetCompensation(uint16_t value) {
+	compensation = value;
+}
+
+/**
+ * Returns the drift compensation.
+ */
+uint16_t rtcGetCompensation() {
+	return compensation;
+}
+
+/**
+ * Returns the adjustment of the present second.
+ */
+int8_t rtcCompensationApplied() {
+	return applied;
+}
@@ -0,0 +1,110 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: sim.c
+ * Description: Interrupts and sleeping of the simulated MCU. A clock thread runs the time
+ * base interrupt once per millisecond of the host. Without it, e.g. in the bench harness,
+ * waiting for an interrupt runs the next tick right away, so simulated time only passes
+ * when the firmware waits.
+ */
+
+#include "timer.h"
+#include "sim.h"
+#include <pthread.h>
+#include <time.h>
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER; // Held while interrupts are masked
+static pthread_cond_t interrupted = PTHREAD_COND_INITIALIZER; // Signalled after interrupts
+static _Thread_local int depth = 0;  // Nesting of simIrqSave() in the calling thread
+static uint64_t interruptCount = 0;  // Interrupts run so far
+static bool clockRunning = false;    // The clock thread has been started
+
+/**
+ * Body of the clock thread, runs the time base interrupt every millisecond.
+ */
+static void *clockThread(void *argument) {
+	struct timespec next;
+
+	(void) argument;
+	clock_gettime(CLOCK_MONOTONIC, &next);
+	while (1) {
+		next.tv_nsec += 1000000L;
+		if (next.tv_nsec >= 1000000000L) {
+			next.tv_nsec -= 1000000000L;
+			next.tv_sec++;
+		}
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+		simInterrupt(PIT0_IRQHandler);
+	}
+	return NULL;
+}
+
+/**
+ * Starts the clock thread.
+ */
+void simStart() {
+	pthread_t thread;
+
+	if (!clockRunning) {
+		clockRunning = true;
+		pthread_create(&thread, NULL, clockThread, NULL);
+	}
+}
+
+/**
+ * Runs a handler as an interrupt: it waits while the firmware has the interrupts masked
+ * and wakes the firmware up afterwards.
+ *
+ * @param handler Code of the interrupt.
+ */
+void simInterrupt(SimHandler handler) {
+	uint32_t state = simIrqSave();
+	handler();
+	interruptCount++;
+	pthread_cond_broadcast(&interrupted);
+	simIrqRestore(state);
+}
+
+/**
+ * Masks the interrupts, calls can be nested.
+ *
+ * @return State to be passed to simIrqRestore().
+ */
+uint32_t simIrqSave() {
+	if (depth++ == 0) {
+		pthread_mutex_lock(&lock);
+	}
+	return (uint32_t) (depth - 1);
+}
+
+/**
+ * Unmasks the interrupts when the outermost simIrqSave() is undone.
+ */
+void simIrqRestore(uint32_t state) {
+	(void) state;
+	if (--depth == 0) {
+		pthread_mutex_unlock(&lock);
+	}
+}
+
+/**
+ * Waits for the next interrupt. The lock is given up while waiting, so the interrupt runs
+ * even if the caller has masked the interrupts. For the firmware that is the same as WFI,
+ * which wakes up the core and runs the interrupt as soon as the caller unmasks them.
+ */
+void simWaitForInterrupt() {
+	if (!clockRunning) {
+		simInterrupt(PIT0_IRQHandler);
+		return;
+	}
+
+	uint32_t state = simIrqSave();
+	int saved = depth;
+	uint64_t seen = interruptCount;
+
+	depth = 0; // The lock is released while waiting
+	while (interruptCount == seen) {
+		pthread_cond_wait(&interrupted, &lock);
+	}
+	depth = saved;
+	simIrqRestore(state);
+}
@@ -0,0 +1,32 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: sim.h
+ * Description: Simulated MCU of the host build. Interrupts are handlers run by host threads
+ * under one lock, which the firmware takes to mask them, and the time base advances with
+ * every simulated tick instead of the wall clock of the host.
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "buttons.h"
+
+typedef void (*SimHandler)(); // Code run as an interrupt
+
+void simStart();
+void simInterrupt(SimHandler handler);
+uint32_t simIrqSave();
+void simIrqRestore(uint32_t state);
+void simWaitForInterrupt();
+
+// Inputs and outputs of the simulated peripherals, for the bench harness and scripts
+void simUartReceive(const uint8_t *data, uint32_t length);
+void simUartMute(bool mute);
+uint32_t simUartSent();
+void simPressButton(enum Button button);
+int32_t simToneSample();
+const uint8_t *simLedPlanes();
+
+#endif /* SIM_H */
@@ -0,0 +1,100 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: timer.c
+ * Description: Millisecond time base of the simulated MCU. The tick is run by the clock
+ * thread of sim.c, or by simWaitForInterrupt() when there is none.
+ */
+
+#include "timer.h"
+#include "irq.h"
+
+static volatile uint32_t msTicks = 0; // Milliseconds since PITInit()
+static TickHandler tickHandlers[TIMER_MAX_TICK_HANDLERS]; // Called on every tick
+static volatile int tickHandlerCount = 0;
+
+/**
+ * Starts the time base.
+ */
+void PITInit() {
+	simStart();
+}
+
+/**
+ * Registers a function to be called from the time base interrupt every millisecond.
+ *
+ * @param handler Function to be called.
+ * @return True if the handler was registered, false if the table is full.
+ */
+bool timerAddTickHandler(TickHandler handler) {
+	if (tickHandlerCount >= TIMER_MAX_TICK_HANDLERS) {
+		return false;
+	}
+	tickHandlers[tickHandlerCount] = handler;
+	tickHandlerCount++;
+	return true;
+}
+
+/**
+ * Time base interrupt, advances the millisecond counter and runs the tick handlers.
+ */
+void PIT0_IRQHandler() {
+	msTicks++;
+
+	for (int i = 0; i < tickHandlerCount; i++) {
+		tickHandlers[i]();
+	}
+}
+
+/**
+ * Returns the number of milliseconds since PITInit().
+ */
+uint32_t timerMillis() {
+	return msTicks;
+}
+
+/**
+ * Returns the number of microseconds since PITInit(), the simulated time only moves in
+ * whole milliseconds.
+ */
+uint32_t timerMicros() {
+	return msTicks * 1000u;
+}
+
+/**
+ * Moves the time base forward, see the K60 version.
+ */
+void timerAdvance(uint32_t ms) {
+	msTicks += ms;
+}
+
+/**
+ * Computes a deadline the given number of milliseconds from now.
+ */
+deadline_t deadlineIn(uint32_t ms) {
+	return msTicks + ms;
+}
+
+/**
+ * Checks whether a deadline has passed.
+ */
+bool deadlineExpired(deadline_t deadline) {
+	return (int32_t) (msTicks - deadline) >= 0;
+}
+
+/**
+ * Sleeps for the given number of milliseconds.
+ */
+void sleepMs(uint32_t ms) {
+	deadline_t deadline = deadlineIn(ms + 1);
+
+	while (!deadlineExpired(deadline)) {
+		waitForInterrupt();
+	}
+}
+
+/**
+ * Sleeps for the given number of microseconds, rounded up to whole ticks.
+ */
+void sleepUs(uint32_t us) {
+	sleepMs((us + 999) / 1000);
+}
@@ -0,0 +1,67 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: tone.c
+ * Description: Speaker of the simulated MCU. The samples of the synthesizer are taken by
+ * the time base, SYNTH_SAMPLE_RATE_HZ / 1000 of them every tick. The last one can be read by
+ * simToneSample().
+ */
+
+#include "timer.h"
+#include "irq.h"
+#include "synth.h"
+#include "tone.h"
+#include "sim.h"
+
+#define SAMPLES_PER_TICK (SYNTH_SAMPLE_RATE_HZ / 1000)
+
+static volatile bool running = false; // Samples are being taken
+static volatile int32_t lastSample = 0;
+
+static void toneTick();
+
+/**
+ * Hooks the samples to the time base.
+ */
+void ToneInit() {
+	timerAddTickHandler(toneTick);
+}
+
+/**
+ * Starts taking samples. Runs under the lock, so a tick that has just seen the
+ * synthesizer silent cannot stop the samples after this.
+ */
+void toneStart() {
+	uint32_t state = irqSave();
+	running = true;
+	irqRestore(state);
+}
+
+/**
+ * Checks whether samples are being taken.
+ */
+bool toneRunning() {
+	return running;
+}
+
+/**
+ * Returns the last sample taken, 0 when silent.
+ */
+int32_t simToneSample() {
+	return running ? lastSample : 0;
+}
+
+/**
+ * Time base handler, takes the samples of one millisecond and stops once the
+ * synthesizer is silent.
+ */
+static void toneTick() {
+	if (!running) {
+		return;
+	}
+	for (int i = 0; i < SAMPLES_PER_TICK; i++) {
+		lastSample = synthSample();
+	}
+	if (!synthIsPlaying()) {
+		running = false;
+	}
+}
@@ -0,0 +1,284 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: uart.c
+ * Description: Console of the simulated MCU on the standard input and output of the host.
+ * A reader thread delivers the input as receive interrupts, which post the handler given to
+ * UARTInit() as deferred work once until it has started. Output is written right away,
+ * so the transmitter is always idle. A terminal is switched to raw input, the console
+ * echoes the characters itself. When standard input is not a terminal and ends, the
+ * simulation exits once the input has been processed, so scripts can be piped in.
+ */
+
+#include "ringbuf.h"
+#include "work.h"
+#include "uart.h"
+#include "rtc.h"
+#include "irq.h"
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#define EXIT_DELAY_MS 100 // Time left to the firmware to answer the last input
+
+static uint8_t rxStorage[UART_RX_BUFFER_SIZE];
+static struct RingBuffer rxBuffer = RING_BUFFER_INIT(rxStorage);
+static volatile uint32_t droppedCount = 0; // Bytes lost because rxBuffer was full
+static struct RtcTime rxTimes[UART_RX_BUFFER_SIZE]; // Receive time of the bytes of rxBuffer
+static struct RtcTime readTime; // Receive time of the byte last read by UARTReadCh()
+
+static WorkHandler receivedHandler = NULL;
+static volatile bool rxPosted = false; // rxReceived() is queued and has not started yet
+
+static const uint8_t *rxData;  // Bytes delivered by the next receive interrupt
+static uint32_t rxLength;
+static bool muted = false;     // Output is counted instead of written
+static uint32_t sentCount = 0; // Bytes written or counted
+
+static struct termios savedTerminal;
+static bool rawTerminal = false;
+
+/**
+ * Puts the terminal back to the mode it had before UARTInit().
+ */
+static void restoreTerminal() {
+	if (rawTerminal) {
+		tcsetattr(STDIN_FILENO, TCSANOW, &savedTerminal);
+	}
+}
+
+/**
+ * Restores the terminal before the simulation is interrupted by Ctrl+C.
+ */
+static void onSignal(int signal) {
+	restoreTerminal();
+	_exit(128 + signal);
+}
+
+/**
+ * Deferred handler of received bytes, runs the handler given to UARTInit(). The flag is
+ * cleared under the lock, so the interrupt sees it cleared before the bytes are read.
+ */
+static void rxReceived(uint32_t arg) {
+	uint32_t state = irqSave();
+	rxPosted = false;
+	irqRestore(state);
+	receivedHandler(arg);
+}
+
+/**
+ * Receive interrupt, stores the delivered bytes.
+ */
+static void rxInterrupt() {
+	struct RtcTime now;
+
+	rtcRead(&now); // The bytes of one delivery arrive together
+	for (uint32_t i = 0; i < rxLength; i++) {
+		// In a full ring the slot at head still belongs to the oldest unread byte
+		if (ringFree(&rxBuffer) > 0) {
+			rxTimes[rxBuffer.head & (UART_RX_BUFFER_SIZE - 1)] = now;
+			(void) ringPut(&rxBuffer, rxData[i]);
+		} else {
+			droppedCount++;
+		}
+	}
+	if (!rxPosted && receivedHandler != NULL) {
+		rxPosted = workPost(rxReceived, 0);
+	}
+}
+
+/**
+ * Body of the reader thread.
+ */
+static void *readerThread(void *argument) {
+	uint8_t buffer[64];
+	ssize_t length;
+	struct timespec delay = { 0, EXIT_DELAY_MS * 1000000L };
+	struct timespec poll = { 0, 1000000L };
+
+	(void) argument;
+	while ((length = read(STDIN_FILENO, buffer, sizeof(buffer))) > 0) {
+		// Piped input arrives faster than any serial line, so it waits for space
+		while (ringFree(&rxBuffer) < length) {
+			nanosleep(&poll, NULL);
+		}
+		simUartReceive(buffer, (uint32_t) length);
+	}
+
+	// End of the input, exit once the firmware has taken all of it
+	while (UARTRxAvailable()) {
+		nanosleep(&delay, NULL);
+	}
+	nanosleep(&delay, NULL);
+	exit(0);
+	return NULL;
+}
+
+/**
+ * Switches a terminal to raw input and starts the reader thread.
+ *
+ * @param received Posted as deferred work when bytes have been received.
+ */
+void UARTInit(WorkHandler received) {
+	pthread_t thread;
+
+	receivedHandler = received;
+
+	if (isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &savedTerminal) == 0) {
+		struct termios raw = savedTerminal;
+		raw.c_lflag &= ~(ICANON | ECHO);
+		raw.c_iflag &= ~ICRNL; // Enter gives '\r' as on a serial terminal
+		raw.c_cc[VMIN] = 1;
+		raw.c_cc[VTIME] = 0;
+		tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+		rawTerminal = true;
+
+		struct sigaction action = { 0 };
+		action.sa_handler = onSignal;
+		sigaction(SIGINT, &action, NULL);
+		sigaction(SIGTERM, &action, NULL);
+		atexit(restoreTerminal);
+	}
+
+	pthread_create(&thread, NULL, readerThread, NULL);
+}
+
+/**
+ * Delivers received bytes to the firmware as a receive interrupt.
+ *
+ * @param data Bytes received.
+ * @param length Number of bytes.
+ */
+void simUartReceive(const uint8_t *data, uint32_t length) {
+	rxData = data;
+	rxLength = length;
+	simInterrupt(rxInterrupt);
+}
+
+/**
+ * Stops writing the output, it is only counted by simUartSent().
+ */
+void simUartMute(bool mute) {
+	muted = mute;
+}
+
+/**
+ * Returns the number of bytes sent since the start.
+ */
+uint32_t simUartSent() {
+	return sentCount;
+}
+
+/**
+ * Writes bytes to the standard output.
+ */
+static void txWrite(const uint8_t *data, uint32_t length) {
+	sentCount += length;
+	while (!muted && length > 0) {
+		ssize_t written = write(STDOUT_FILENO, data, length);
+		if (written <= 0) {
+			return;
+		}
+		data += written;
+		length -= (uint32_t) written;
+	}
+}
+
+/**
+ * Sends a character.
+ */
+void SendCh(char ch) {
+	txWrite((const uint8_t *) &ch, 1);
+}
+
+/**
+ * Sends a string, every '\n' is followed by '\r'.
+ */
+void UARTSendStr(const char *s) {
+	uint8_t buffer[128];
+	uint32_t length = 0;
+
+	for (int i = 0; s[i] != 0; i++) {
+		buffer[length++] = (uint8_t) s[i];
+		if (s[i] == '\n') {
+			buffer[length++] = '\r';
+		}
+		if (length >= sizeof(buffer) - 1) {
+			txWrite(buffer, length);
+			length = 0;
+		}
+	}
+	txWrite(buffer, length);
+}
+
+/**
+ * Sends binary data as it is.
+ */
+void UARTSendBytes(const uint8_t *data, uint16_t length) {
+	txWrite(data, length);
+}
+
+/**
+ * Sends a buffer with the line endings already expanded.
+ */
+void UARTSendBuf(const char *data, uint16_t length) {
+	txWrite((const uint8_t *) data, length);
+}
+
+/**
+ * The output is written synchronously, so the transmitter is always idle.
+ */
+bool UARTTxIdle() {
+	return true;
+}
+
+/**
+ * The simulated MCU needs no wake-up edge, every input is an interrupt.
+ */
+void UARTSetWakeOnRx(bool enable) {
+	(void) enable;
+}
+
+/**
+ * Reads one received character if there is any.
+ */
+bool UARTReadCh(char *ch) {
+	uint8_t byte;
+
+	readTime = rxTimes[rxBuffer.tail & (UART_RX_BUFFER_SIZE - 1)];
+	if (!ringGet(&rxBuffer, &byte)) {
+		return false;
+	}
+	*ch = (char) byte;
+	return true;
+}
+
+/**
+ * Returns the RTC time the character last read by UARTReadCh() was received.
+ */
+void UARTRxTime(struct RtcTime *time) {
+	*time = readTime;
+}
+
+/**
+ * Checks whether there is a received character waiting to be read.
+ */
+bool UARTRxAvailable() {
+	return ringCount(&rxBuffer) != 0;
+}
+
+/**
+ * The simulated receiver never overruns.
+ */
+uint32_t UARTOverrunCount() {
+	return 0;
+}
+
+/**
+ * Returns the number of received bytes dropped because the receive buffer was full.
+ */
+uint32_t UARTDroppedCount() {
+	return droppedCount;
+}
@@ -0,0 +1,55 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: board.c
+ * Description: Clocks and pin multiplexing of the FITkit 3 board.
+ */
+
+#include "MK60D10.h"
+#include "board.h"
+
+/**
+ * Initializes the Microcontroller Unit (MCU) settings.
+ */
+void MCUInit() {
+	MCG_C4 |= ( MCG_C4_DMX32_MASK | MCG_C4_DRST_DRS(0x01));
+	SIM_CLKDIV1 |= SIM_CLKDIV1_OUTDIV1(0x00);
+	WDOG_STCTRLH &= ~WDOG_STCTRLH_WDOGEN_MASK;
+}
+
+/**
+ * Initializes the ports used by LEDs, buttons, and the speaker.
+ */
+void PortsInit() {
+	// Initialize all port clocks
+	SIM->SCGC5 = SIM_SCGC5_PORTB_MASK | SIM_SCGC5_PORTE_MASK
+			| SIM_SCGC5_PORTA_MASK;
+	SIM->SCGC1 = SIM_SCGC1_UART5_MASK;
+	SIM->SCGC6 = SIM_SCGC6_RTC_MASK;
+
+	// Configure LED pins as GPIO outputs
+	PORTB->PCR[5] = PORT_PCR_MUX(0x01); // For LED D9
+	PORTB->PCR[4] = PORT_PCR_MUX(0x01); // For LED D10
+	PORTB->PCR[3] = PORT_PCR_MUX(0x01); // For LED D11
+	PORTB->PCR[2] = PORT_PCR_MUX(0x01); // For LED D12
+
+	// Configure button pins as GPIO inputs
+	PORTE->PCR[10] = PORT_PCR_MUX(0x01); // For button SW2
+	PORTE->PCR[12] = PORT_PCR_MUX(0x01); // For button SW3
+	PORTE->PCR[27] = PORT_PCR_MUX(0x01); // For button SW4
+	PORTE->PCR[26] = PORT_PCR_MUX(0x01); // For button SW5
+	PORTE->PCR[11] = PORT_PCR_MUX(0x01); // For button SW6
+
+	// Configure speaker pin
+	PORTA->PCR[4] = PORT_PCR_MUX(0x01);
+
+	// Set LED pins to output and turn them off
+	PTB->PDDR |= GPIO_PDDR_PDD(0x3C);
+	PTB->PDOR |= GPIO_PDOR_PDO(0x3C);
+
+	PORTE->PCR[8] = PORT_PCR_MUX(0x03); // For UART transmitter
+	PORTE->PCR[9] = PORT_PCR_MUX(0x03); // For UART receiver
+
+	// Set speaker pin to output
+	PTA->PDDR |= GPIO_PDDR_PDD(SPK);
+	PTA->PDOR &= ~SPK;
+}
@@ -0,0 +1,126 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: buttons.c
+ * Description: Buttons SW2-SW6 on PTE10/11/12/26/27. A press is reported straight from the
+ * pin interrupt on the first falling edge, then the interrupt of that pin stays off for
+ * BUTTON_DEBOUNCE_MS while the contacts bounce and the time base rearms it, for the rising
+ * edge if the button is still held so that the bounces of the release are swallowed too.
+ * Nothing is polled and a press also wakes the chip from VLPS.
+ */
+
+#include "MK60D10.h"
+#include "board.h"
+#include "timer.h"
+#include "work.h"
+#include "profile.h"
+#include "buttons.h"
+#include <stddef.h>
+
+#define IRQC_DISABLED     0x0
+#define IRQC_RISING_EDGE  0x9
+#define IRQC_FALLING_EDGE 0xA
+
+// Pins in the order of enum Button
+static const uint8_t buttonPins[BUTTON_COUNT] = { 10, 12, 27, 26, 11 };
+
+static WorkHandler pressedHandler = NULL;
+
+static volatile uint8_t lockedButtons = 0;           // Buttons ignored while they bounce
+static volatile deadline_t unlockTime[BUTTON_COUNT]; // End of the bounce of each button
+
+static void buttonsTick();
+
+/**
+ * Sets the edge the pin of a button interrupts on.
+ *
+ * @param button Button to configure.
+ * @param irqc PORT_PCR_IRQC value.
+ */
+static void buttonArm(int button, uint32_t irqc) {
+	uint8_t pin = buttonPins[button];
+
+	// Writing ISF clears a flag left over from the bounces
+	PORTE->PCR[pin] = (PORTE->PCR[pin] & ~(PORT_PCR_IRQC_MASK | PORT_PCR_ISF_MASK))
+			| PORT_PCR_IRQC(irqc) | PORT_PCR_ISF_MASK;
+}
+
+/**
+ * Checks the current level of a button, the buttons pull the pins low.
+ *
+ * @param button Button to read.
+ * @return True if the button is pressed.
+ */
+static bool buttonDown(int button) {
+	return !(PTE->PDIR & (1u << buttonPins[button]));
+}
+
+/**
+ * Enables the pin interrupts of the buttons. The pins are already GPIO inputs
+ * configured by PortsInit(), PITInit() has to be called before.
+ *
+ * @param pressed Posted as deferred work with the enum Button of every press.
+ */
+void ButtonsInit(WorkHandler pressed) {
+	pressedHandler = pressed;
+	for (int i = 0; i < BUTTON_COUNT; i++) {
+		PORTE->PCR[buttonPins[i]] |= PORT_PCR_PFE_MASK; // Passive filter against spikes
+		buttonArm(i, buttonDown(i) ? IRQC_RISING_EDGE : IRQC_FALLING_EDGE);
+	}
+
+	NVIC_ClearPendingIRQ(PORTE_IRQn);
+	NVIC_EnableIRQ(PORTE_IRQn);
+
+	timerAddTickHandler(buttonsTick);
+}
+
+/**
+ * Checks whether a button is being debounced, during which the time base has to run.
+ *
+ * @return True if the chip must not enter a stop mode.
+ */
+bool buttonsNeedClocks() {
+	return lockedButtons != 0;
+}
+
+/**
+ * PORTE interrupt handler. Reports falling edges as presses and locks every button
+ * that changed for the debounce time.
+ */
+void PORTE_IRQHandler() {
+	PROFILE_STACK_BEGIN();
+
+	for (int i = 0; i < BUTTON_COUNT; i++) {
+		uint32_t mask = 1u << buttonPins[i];
+		if (!(PORTE->ISFR & mask)) {
+			continue;
+		}
+
+		bool pressed = (PORTE->PCR[buttonPins[i]] & PORT_PCR_IRQC_MASK)
+				== PORT_PCR_IRQC(IRQC_FALLING_EDGE);
+		buttonArm(i, IRQC_DISABLED);
+		unlockTime[i] = deadlineIn(BUTTON_DEBOUNCE_MS);
+		lockedButtons |= 1u << i;
+
+		if (pressed) {
+			workPost(pressedHandler, (uint32_t) i); // A full queue drops the press
+		}
+	}
+
+	PROFILE_STACK_END(PROFILE_STACK_BUTTONS);
+}
+
+/**
+ * Time base handler, rearms the buttons whose debounce time is over.
+ */
+static void buttonsTick() {
+	if (lockedButtons == 0) {
+		return;
+	}
+
+	for (int i = 0; i < BUTTON_COUNT; i++) {
+		if ((lockedButtons & (1u << i)) && deadlineExpired(unlockTime[i])) {
+			lockedButtons &= ~(1u << i);
+			buttonArm(i, buttonDown(i) ? IRQC_RISING_EDGE : IRQC_FALLING_EDGE);
+		}
+	}
+}
@@ -0,0 +1,86 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: flash.c
+ * Description: FTFL commands of the K60 program flash. Flash block 1 is programmed while
+ * the code runs from block 0, so the core keeps fetching instructions and serving
+ * interrupts during an operation.
+ */
+
+#include "MK60D10.h"
+#include "flash.h"
+
+#define FTFL_CMD_PROGRAM_LONGWORD 0x06
+#define FTFL_CMD_ERASE_SECTOR     0x09
+
+/**
+ * Enables the clock of the flash controller.
+ */
+void FlashInit() {
+	SIM->SCGC6 |= SIM_SCGC6_FTFL_MASK;
+}
+
+/**
+ * Returns a pointer to read the flash at an address, the flash is memory mapped.
+ */
+const uint8_t *flashPointer(uint32_t address) {
+	return (const uint8_t *) address;
+}
+
+/**
+ * Launches the command prepared in FCCOB and waits for it to complete.
+ *
+ * @return True if the command succeeded.
+ */
+static bool flashRun() {
+	while (!(FTFL->FSTAT & FTFL_FSTAT_CCIF_MASK)) {
+		// A previous command is still running
+	}
+	FTFL->FSTAT = FTFL_FSTAT_ACCERR_MASK | FTFL_FSTAT_FPVIOL_MASK; // Clear old errors
+	FTFL->FSTAT = FTFL_FSTAT_CCIF_MASK;                             // Launch
+	while (!(FTFL->FSTAT & FTFL_FSTAT_CCIF_MASK)) {
+		// Erasing a sector takes tens of ms, programming a longword tens of us
+	}
+
+	// The flash controller may hold stale copies of the changed flash
+	FMC->PFB0CR |= FMC_PFB0CR_CINV_WAY_MASK;
+
+	return !(FTFL->FSTAT & (FTFL_FSTAT_ACCERR_MASK | FTFL_FSTAT_FPVIOL_MASK
+			| FTFL_FSTAT_MGSTAT0_MASK));
+}
+
+/**
+ * Puts a command with an address into FCCOB.
+ */
+static void flashCommand(uint8_t command, uint32_t address) {
+	FTFL->FCCOB0 = command;
+	FTFL->FCCOB1 = (uint8_t) (address >> 16);
+	FTFL->FCCOB2 = (uint8_t) (address >> 8);
+	FTFL->FCCOB3 = (uint8_t) address;
+}
+
+/**
+ * Erases a sector of the flash.
+ *
+ * @param address Address of the sector.
+ * @return True if the sector was erased.
+ */
+bool flashErase(uint32_t address) {
+	flashCommand(FTFL_CMD_ERASE_SECTOR, address);
+	return flashRun();
+}
+
+/**
+ * Programs a longword of erased flash.
+ *
+ * @param address Address of the longword, a multiple of 4.
+ * @param value Value in the byte order of the core.
+ * @return True if the longword was programmed.
+ */
+bool flashProgram(uint32_t address, uint32_t value) {
+	flashCommand(FTFL_CMD_PROGRAM_LONGWORD, address);
+	FTFL->FCCOB4 = (uint8_t) (value >> 24);
+	FTFL->FCCOB5 = (uint8_t) (value >> 16);
+	FTFL->FCCOB6 = (uint8_t) (value >> 8);
+	FTFL->FCCOB7 = (uint8_t) value;
+	return flashRun();
+}
@@ -0,0 +1,38 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: irq.h
+ * Description: Interrupt masking and waiting of the K60 for the portable modules.
+ */
+
+#ifndef IRQ_H
+#define IRQ_H
+
+#include "MK60D10.h"
+
+/**
+ * Masks all interrupts.
+ *
+ * @return State to be passed to irqRestore().
+ */
+static inline uint32_t irqSave() {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	return primask;
+}
+
+/**
+ * Unmasks the interrupts again unless they were already masked before irqSave().
+ */
+static inline void irqRestore(uint32_t state) {
+	__set_PRIMASK(state);
+}
+
+/**
+ * Waits in WAIT mode for the next interrupt. With the interrupts masked the core still
+ * wakes up and the interrupt runs once they are unmasked.
+ */
+static inline void waitForInterrupt() {
+	__WFI();
+}
+
+#endif /* IRQ_H */
@@ -0,0 +1,93 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: power.c
+ * Description: Low-power idle modes of the main loop. With something running on the time
+ * base the core waits in WAIT mode and the 1 ms tick keeps going. Otherwise the whole chip
+ * goes to VLPS, the tick stops and the time spent asleep is measured by the RTC and added
+ * to the time base afterwards (tickless idle). VLPS is left on any enabled interrupt: the
+ * RTC alarm, the UART receive edge or a port pin. LLWU is not needed since VLPS is not a
+ * leakage mode.
+ */
+
+#include "MK60D10.h"
+#include "timer.h"
+#include "uart.h"
+#include "rtc.h"
+#include "power.h"
+
+static uint64_t waitUs = 0;  // Total time spent in WAIT mode
+static uint64_t deepUs = 0;  // Total time spent in VLPS
+static uint32_t carryUs = 0; // Time slept in VLPS not yet added to the time base
+
+/**
+ * Allows the very low power stop mode. PMPROT can be written only once after reset.
+ */
+void PowerInit() {
+	SMC->PMPROT = SMC_PMPROT_AVLP_MASK;
+}
+
+/**
+ * Puts the core to sleep until the next interrupt. Must be called with interrupts
+ * disabled after checking that there is no work left, an interrupt pending since the
+ * check still wakes the core up and runs as soon as the caller re-enables interrupts.
+ *
+ * @param deep True to enter VLPS with the time base stopped, false for WAIT mode.
+ */
+void powerSleep(bool deep) {
+	if (!deep) {
+		uint32_t start = timerMicros();
+		__WFI();
+		waitUs += timerMicros() - start;
+		return;
+	}
+
+	uint64_t start = rtcMicros();
+
+	UARTSetWakeOnRx(true);
+	SMC->PMCTRL = (SMC->PMCTRL & ~SMC_PMCTRL_STOPM_MASK) | SMC_PMCTRL_STOPM(0x02);
+	(void) SMC->PMCTRL; // Make sure the write has completed before WFI
+	SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+	__DSB();
+	__WFI();
+	SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+	UARTSetWakeOnRx(false);
+
+	// The time base moves by whole ms, the rest is carried into the next sleep
+	uint64_t slept = rtcMicros() - start;
+	uint64_t pending = slept + carryUs;
+	timerAdvance((uint32_t) (pending / 1000u));
+	carryUs = (uint32_t) (pending % 1000u);
+	deepUs += slept;
+}
+
+/**
+ * Returns the share of time the core was running since reset.
+ *
+ * @return Active time in tenths of a percent.
+ */
+uint32_t powerActivePermille() {
+	uint64_t totalUs = (uint64_t) timerMillis() * 1000u;
+
+	if (totalUs == 0 || waitUs + deepUs >= totalUs) {
+		return totalUs == 0 ? 1000 : 0;
+	}
+	return (uint32_t) (((totalUs - waitUs - deepUs) * 1000u) / totalUs);
+}
+
+/**
+ * Estimates the average supply current since reset from the time spent in each mode
+ * and the typical currents POWER_*_CURRENT_UA.
+ *
+ * @return Average current in microamperes.
+ */
+uint32_t powerAverageCurrentUa() {
+	uint64_t totalUs = (uint64_t) timerMillis() * 1000u;
+
+	if (totalUs == 0 || waitUs + deepUs >= totalUs) {
+		return POWER_RUN_CURRENT_UA;
+	}
+	uint64_t runUs = totalUs - waitUs - deepUs;
+	uint64_t charge = runUs * POWER_RUN_CURRENT_UA + waitUs * POWER_WAIT_CURRENT_UA
+			+ deepUs * POWER_VLPS_CURRENT_UA;
+	return (uint32_t) (charge / totalUs);
+}
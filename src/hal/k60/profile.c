@@ -0,0 +1,260 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: profile.c
+ * Description: Cycle statistics of the points in profile.h and the stack high-water mark.
+ * The stack below the one in use at ProfileInit() is filled with a pattern and the deepest
+ * word overwritten is searched for when the mark is read. CYCCNT stops while the core
+ * sleeps, so only code that runs without sleeping in between is measured with it.
+ * A measured handler paints STACK_WINDOW words below the stack pointer when it starts and
+ * looks for the deepest word overwritten when it ends. An interrupt nested in it counts
+ * towards its depth, which is what the stack has to hold in the worst case.
+ */
+
+#ifdef PROFILE
+
+#include "MK60D10.h"
+#include "board.h"
+#include "rtc.h"
+#include "profile.h"
+#include <stdbool.h>
+
+#define STACK_PATTERN 0xA5A5A5A5u
+#define STACK_MARGIN 64  // Words left untouched below the stack pointer of ProfileInit()
+#define STACK_WINDOW 256 // Words painted below a measured handler, its deepest measurable use
+#define CYCLES_PER_RTC_TICK (CORE_CLOCK_HZ / RTC_PRESCALER_HZ)
+
+// Bounds of the main stack from the linker script
+extern uint32_t __StackLimit[];
+extern uint32_t __StackTop[];
+
+static const char *const names[PROFILE_POINT_COUNT] = {
+	"RTC_IRQHandler",
+	"handleAlarmRepeats",
+	"UARTSendStr",
+	"displayMenu",
+	"melody step",
+	"light step",
+	"alarm latency",
+	"synth sample"
+};
+
+static const char *const stackNames[PROFILE_STACK_COUNT] = {
+	"PIT0_IRQHandler",
+	"PIT1_IRQHandler",
+	"PIT2_IRQHandler",
+	"RTC_IRQHandler",
+	"RTC_Seconds_IRQHandler",
+	"PORTE_IRQHandler",
+	"UART5_RX_TX_IRQHandler",
+	"DMA0_IRQHandler",
+	"deferred work"
+};
+
+static struct ProfileStats stats[PROFILE_POINT_COUNT];
+static uint32_t stackDepth[PROFILE_STACK_COUNT]; // Deepest use below each handler in bytes
+static const uint32_t *stackDeepest;             // Lowest word found overwritten in a window
+static uint32_t overhead = 0; // Cycles of an empty PROFILE_BEGIN()/PROFILE_END() pair
+static uint32_t alarmStart;   // Cycle count at the start of the alarm second
+static bool alarmWaiting = false; // Set between profileAlarmFired() and profileAlarmRung()
+
+/**
+ * Starts the cycle counter, fills the free stack with the pattern and measures the cost
+ * of the measurement itself, which is then left out of the statistics.
+ */
+void ProfileInit() {
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	uint32_t *sp = (uint32_t *) __get_MSP() - STACK_MARGIN;
+	for (uint32_t *p = __StackLimit; p < sp; p++) {
+		*p = STACK_PATTERN;
+	}
+	stackDeepest = __StackTop;
+
+	uint32_t start = profileCycles();
+	overhead = profileCycles() - start;
+	profileReset();
+}
+
+/**
+ * Adds one measurement to the statistics of a point. Called from interrupts as well.
+ *
+ * @param point The point measured.
+ * @param cycles Cycles the point took, including the measurement.
+ */
+void profileRecord(enum ProfilePoint point, uint32_t cycles) {
+	struct ProfileStats *s = &stats[point];
+	cycles = cycles > overhead ? cycles - overhead : 0;
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if (cycles < s->min) {
+		s->min = cycles;
+	}
+	if (cycles > s->max) {
+		s->max = cycles;
+	}
+	s->total += cycles;
+	s->count++;
+	__set_PRIMASK(primask);
+}
+
+/**
+ * Notes an alarm interrupt. The alarm became due when the second started, the prescaler
+ * tells how long ago that was even if the core had to wake up from VLPS first.
+ */
+void profileAlarmFired() {
+	alarmStart = profileCycles() - (RTC_TPR & (RTC_PRESCALER_HZ - 1)) * CYCLES_PER_RTC_TICK;
+	alarmWaiting = true;
+}
+
+/**
+ * Records the alarm latency once the first note of the alarm has been started.
+ */
+void profileAlarmRung() {
+	if (alarmWaiting) {
+		alarmWaiting = false;
+		profileRecord(PROFILE_ALARM_LATENCY, profileCycles() - alarmStart + overhead);
+	}
+}
+
+/**
+ * Clears the statistics of all points.
+ */
+void profileReset() {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	for (int i = 0; i < PROFILE_POINT_COUNT; i++) {
+		stats[i] = (struct ProfileStats) { 0, UINT32_MAX, 0, 0 };
+	}
+	__set_PRIMASK(primask);
+}
+
+/**
+ * Returns the name of a point for printing.
+ */
+const char *profileName(enum ProfilePoint point) {
+	return names[point];
+}
+
+/**
+ * Returns a consistent copy of the statistics of a point.
+ */
+struct ProfileStats profileGet(enum ProfilePoint point) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	struct ProfileStats s = stats[point];
+	__set_PRIMASK(primask);
+	return s;
+}
+
+/**
+ * Returns the deepest use of the stack since reset.
+ *
+ * @return Bytes of the stack that have been used.
+ */
+uint32_t profileStackUsed() {
+	const uint32_t *p = __StackLimit;
+
+	while (p < __StackTop && *p == STACK_PATTERN) {
+		p++;
+	}
+	if (stackDeepest < p) {
+		p = stackDeepest; // Overwritten once, then painted again by a handler
+	}
+	return (uint32_t) (__StackTop - p) * sizeof(uint32_t);
+}
+
+/**
+ * Returns the lowest word of the window below a stack pointer.
+ */
+static uint32_t *stackWindow(const uint32_t *sp) {
+	return sp - __StackLimit > STACK_WINDOW ? (uint32_t *) sp - STACK_WINDOW : __StackLimit;
+}
+
+/**
+ * Finds the lowest word of a window that is not the pattern.
+ *
+ * @param bottom Lowest word of the window.
+ * @param top Word above the window.
+ * @return The overwritten word, top if there is none.
+ */
+static const uint32_t *stackScan(const uint32_t *bottom, const uint32_t *top) {
+	while (bottom < top && *bottom == STACK_PATTERN) {
+		bottom++;
+	}
+	return bottom;
+}
+
+/**
+ * Paints the window below the stack pointer of a measured handler, used by
+ * PROFILE_STACK_BEGIN(). The window ends below the frame of this function, a handler that
+ * only gets as deep as that frame is reported with its size.
+ *
+ * @param sp Stack pointer of the handler.
+ */
+void profileStackPaint(const uint32_t *sp) {
+	uint32_t *bottom = stackWindow(sp);
+	uint32_t *top = (uint32_t *) __get_MSP();
+
+	// Keep the high-water mark of whatever has used the window before
+	const uint32_t *used = stackScan(bottom, top);
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if (used < top && used < stackDeepest) {
+		stackDeepest = used;
+	}
+	__set_PRIMASK(primask);
+
+	for (uint32_t *p = bottom; p < top; p++) {
+		*p = STACK_PATTERN;
+	}
+}
+
+/**
+ * Records how deep a handler has used the stack, used by PROFILE_STACK_END().
+ *
+ * @param handler The handler measured.
+ * @param sp Stack pointer of the handler at PROFILE_STACK_BEGIN().
+ */
+void profileStackRecord(enum ProfileStack handler, const uint32_t *sp) {
+	const uint32_t *used = stackScan(stackWindow(sp), sp);
+	uint32_t depth = (uint32_t) (sp - used) * sizeof(uint32_t);
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if (depth > stackDepth[handler]) {
+		stackDepth[handler] = depth;
+	}
+	if (used < stackDeepest) {
+		stackDeepest = used;
+	}
+	__set_PRIMASK(primask);
+}
+
+/**
+ * Returns the deepest use of the stack below a handler since reset. A depth of
+ * STACK_WINDOW words means the handler may go even deeper.
+ *
+ * @return Bytes used below the stack pointer of the handler.
+ */
+uint32_t profileStackDepth(enum ProfileStack handler) {
+	return stackDepth[handler];
+}
+
+/**
+ * Returns the name of a measured handler for printing.
+ */
+const char *profileStackName(enum ProfileStack handler) {
+	return stackNames[handler];
+}
+
+/**
+ * Returns the size of the stack in bytes.
+ */
+uint32_t profileStackSize() {
+	return (uint32_t) (__StackTop - __StackLimit) * sizeof(uint32_t);
+}
+
+#endif /* PROFILE */
@@ -0,0 +1,96 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: pwm.c
+ * Description: Software PWM of the LEDs D9-D12. PTB2-PTB5 have no FTM channel, so PIT
+ * channel 1 runs the bit angle modulation. That is 8 interrupts per period whatever the
+ * brightness, each only writing two precomputed masks to PSOR/PCOR, so the other PTB pins
+ * are never touched. PIT1 only runs while some LED is dimmed.
+ */
+
+#include "MK60D10.h"
+#include "board.h"
+#include "leds.h"
+#include "pwm.h"
+#include "profile.h"
+
+#define PWM_FREQUENCY_HZ 200                                              // Well above flicker
+#define PWM_UNIT_TICKS   (BUS_CLOCK_HZ / (PWM_FREQUENCY_HZ * LED_LEVEL_MAX)) // Shortest slot
+
+static volatile uint8_t planes[PWM_BITS]; // LED bits that are on in each slot
+static volatile uint8_t plane = 0;        // Slot started by the next PIT1 interrupt
+static volatile bool running = false;     // PIT1 is generating the slots
+
+/**
+ * Initializes PIT channel 1 for the PWM slots, it stays stopped until an LED is dimmed.
+ * PITInit() has to be called before.
+ */
+void PwmInit() {
+	PIT->CHANNEL[1].TCTRL = 0;
+	PIT->CHANNEL[1].TFLG = PIT_TFLG_TIF_MASK;
+
+	NVIC_ClearPendingIRQ(PIT1_IRQn);
+	NVIC_EnableIRQ(PIT1_IRQn);
+}
+
+/**
+ * Shows new bit planes. PIT1 is started or stopped as needed, LEDs that are fully on or
+ * off are written directly.
+ *
+ * @param newPlanes PWM_BITS masks of the LED bits that are on in each slot.
+ * @param on Mask of the LEDs that are fully on.
+ * @param modulate True if some LED is dimmed.
+ */
+void pwmShow(const uint8_t *newPlanes, uint8_t on, bool modulate) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	for (int k = 0; k < PWM_BITS; k++) {
+		planes[k] = newPlanes[k];
+	}
+
+	if (!modulate) {
+		// Nothing to modulate, stop PIT1 and leave the pins static
+		PIT->CHANNEL[1].TCTRL = 0;
+		PIT->CHANNEL[1].TFLG = PIT_TFLG_TIF_MASK;
+		running = false;
+		PTB->PSOR = LED_ALL & ~on; // Active low
+		PTB->PCOR = on;
+	} else if (!running) {
+		// Show slot 0 now, the timer loads the slot 1 length when slot 0 expires
+		PTB->PSOR = LED_ALL & ~planes[0];
+		PTB->PCOR = planes[0];
+		PIT->CHANNEL[1].LDVAL = PWM_UNIT_TICKS - 1;
+		PIT->CHANNEL[1].TFLG = PIT_TFLG_TIF_MASK;
+		PIT->CHANNEL[1].TCTRL = PIT_TCTRL_TIE_MASK | PIT_TCTRL_TEN_MASK;
+		PIT->CHANNEL[1].LDVAL = (PWM_UNIT_TICKS << 1) - 1;
+		plane = 1;
+		running = true;
+	}
+
+	__set_PRIMASK(primask);
+}
+
+/**
+ * Checks whether PIT1 is generating the slots, which needs the bus clock.
+ */
+bool pwmRunning() {
+	return running;
+}
+
+/**
+ * PIT channel 1 interrupt handler. The slot that has just started was loaded by the
+ * timer itself, so only its LEDs are shown and the length of the following slot is
+ * queued in LDVAL.
+ */
+void PIT1_IRQHandler() {
+	PROFILE_STACK_BEGIN();
+	PIT->CHANNEL[1].TFLG = PIT_TFLG_TIF_MASK;
+
+	uint8_t mask = planes[plane];
+	PTB->PSOR = LED_ALL & ~mask;
+	PTB->PCOR = mask;
+
+	plane = (plane + 1) & (PWM_BITS - 1);
+	PIT->CHANNEL[1].LDVAL = (PWM_UNIT_TICKS << plane) - 1;
+	PROFILE_STACK_END(PROFILE_STACK_PWM);
+}
@@ -0,0 +1,231 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: rtc.c
+ * Description: RTC of the K60. The prescaler RTC_TPR counts 32768 ticks per second and
+ * moves TSR when it wraps, RTC_TCR adds or removes up to 128 ticks once every 1 to 256
+ * seconds. The RTC runs from VBAT, so it may still be counting after a reset.
+ */
+
+#include "MK60D10.h"
+#include "irq.h"
+#include "timer.h"
+#include "work.h"
+#include "profile.h"
+#include "rtc.h"
+#include <stddef.h>
+
+static WorkHandler alarmHandler = NULL;
+static WorkHandler secondsHandler = NULL;
+
+/**
+ * Initializes the RTC. After a reset with the RTC still counting from VBAT the time is
+ * kept and nothing has to be waited for. Otherwise the RTC is reset, the oscillator is
+ * enabled and its start is detected by the prescaler beginning to count, with a
+ * deadline instead of a fixed delay. PITInit() has to be called before.
+ *
+ * @param alarm Posted as deferred work with the alarm second when the alarm fires.
+ * @return How the RTC was found.
+ */
+enum RtcStart RTCInit(WorkHandler alarm) {
+	enum RtcStart start = RTC_WARM_START;
+
+	alarmHandler = alarm;
+
+	if (!(RTC_CR & RTC_CR_OSCE_MASK) || !(RTC_SR & RTC_SR_TCE_MASK)
+			|| (RTC_SR & RTC_SR_TIF_MASK)) {
+		start = RTC_COLD_START;
+
+		// Reset RTC registers
+		RTC_CR |= RTC_CR_SWR_MASK;
+		RTC_CR &= ~RTC_CR_SWR_MASK;
+
+		// Reset CIR and TCR
+		RTC_TCR = 0;
+
+		// Enable 32.768 kHz crystal oscillator
+		RTC_CR |= RTC_CR_OSCE_MASK;
+
+		// Set the time counter to a known value, which also clears TIF
+		RTC_TSR = 0x00000000;
+
+		// Set the alarm time
+		RTC_TAR = 0xFFFFFFFF;
+
+		// Start counting, the prescaler moves as soon as the oscillator runs
+		RTC_SR |= RTC_SR_TCE_MASK;
+		uint32_t prescaler = RTC_TPR;
+		deadline_t deadline = deadlineIn(RTC_OSC_TIMEOUT_MS);
+		while (RTC_TPR == prescaler) {
+			if (deadlineExpired(deadline)) {
+				start = RTC_NO_OSCILLATOR;
+				break;
+			}
+			__WFI(); // Woken by the time base every millisecond
+		}
+	}
+
+	// Time Alarm Interrupt Enable
+	RTC_IER |= RTC_IER_TAIE_MASK;
+
+	// Clear any pending RTC interrupts and enable the RTC interrupt
+	NVIC_ClearPendingIRQ(RTC_IRQn);
+	NVIC_EnableIRQ(RTC_IRQn);
+
+	return start;
+}
+
+/**
+ * RTC interrupt handler. Only acknowledges the alarm and posts the handler given to
+ * RTCInit() for the main loop.
+ */
+void RTC_IRQHandler() {
+	PROFILE_STACK_BEGIN();
+	PROFILE_BEGIN();
+
+	// Check if the alarm interrupt flag is set
+	if (RTC_SR & RTC_SR_TAF_MASK) {
+		PROFILE_ALARM_FIRED();
+		RTC_TAR = 0; // Writing TAR clears the alarm flag
+		workPost(alarmHandler, RTC_TSR);
+	}
+
+	PROFILE_END(PROFILE_RTC_IRQ);
+	PROFILE_STACK_END(PROFILE_STACK_RTC);
+}
+
+/**
+ * RTC seconds interrupt handler, posts the handler given to rtcSetSecondsHandler() with
+ * the new second. The interrupt has no flag to acknowledge.
+ */
+void RTC_Seconds_IRQHandler() {
+	PROFILE_STACK_BEGIN();
+	if (secondsHandler != NULL) {
+		workPost(secondsHandler, RTC_TSR);
+	}
+	PROFILE_STACK_END(PROFILE_STACK_SECONDS);
+}
+
+/**
+ * Returns the whole seconds of the time.
+ */
+uint32_t rtcSeconds() {
+	return RTC_TSR;
+}
+
+/**
+ * Reads the RTC. The seconds counter is read before and after the prescaler, and the
+ * prescaler twice, so a read that crosses a tick or the wrap of the prescaler into the
+ * seconds is repeated.
+ *
+ * @param time Pointer to store the time.
+ */
+void rtcRead(struct RtcTime *time) {
+	uint32_t seconds, prescaler;
+
+	do {
+		seconds = RTC_TSR;
+		prescaler = RTC_TPR & RTC_TPR_TPR_MASK;
+	} while (prescaler != (RTC_TPR & RTC_TPR_TPR_MASK) || seconds != RTC_TSR);
+
+	time->seconds = seconds;
+	time->ticks = (uint16_t) (prescaler & (RTC_PRESCALER_HZ - 1));
+}
+
+/**
+ * Reads the RTC as microseconds.
+ */
+uint64_t rtcMicros() {
+	struct RtcTime time;
+
+	rtcRead(&time);
+	return (uint64_t) time.seconds * 1000000u
+			+ (uint64_t) time.ticks * 1000000u / RTC_PRESCALER_HZ;
+}
+
+/**
+ * Sets the RTC. The counter is stopped while the prescaler and the seconds are written,
+ * writing the seconds also clears the invalid time and overflow flags.
+ *
+ * @param time The new time.
+ */
+void rtcSetTime(const struct RtcTime *time) {
+	RTC_SR &= ~RTC_SR_TCE_MASK;
+	RTC_TPR = time->ticks;
+	RTC_TSR = time->seconds;
+	RTC_SR |= RTC_SR_TCE_MASK;
+}
+
+/**
+ * Moves the RTC by a number of ticks. The counter stays stopped from the read to the
+ * write, so the move is exact and the phase of the second is kept apart from the ticks
+ * that pass while it is stopped, a few bus cycles.
+ *
+ * @param ticks Prescaler ticks to add, negative to move the clock back.
+ */
+void rtcStep(int64_t ticks) {
+	uint32_t state = irqSave();
+
+	RTC_SR &= ~RTC_SR_TCE_MASK;
+	int64_t now = (int64_t) RTC_TSR * RTC_PRESCALER_HZ
+			+ (RTC_TPR & (RTC_PRESCALER_HZ - 1)) + ticks;
+	RTC_TPR = (uint32_t) (now % RTC_PRESCALER_HZ);
+	RTC_TSR = (uint32_t) (now / RTC_PRESCALER_HZ);
+	RTC_SR |= RTC_SR_TCE_MASK;
+	irqRestore(state);
+}
+
+/**
+ * Programs the alarm, it fires once the time reaches the given second.
+ *
+ * @param seconds Time of the alarm, 0 for no alarm.
+ */
+void rtcSetAlarm(uint32_t seconds) {
+	RTC_TAR = seconds;
+}
+
+/**
+ * Sets the handler posted every time the seconds counter moves. The seconds interrupt
+ * wakes the chip once a second, so it is only enabled while there is a handler.
+ *
+ * @param handler Posted as deferred work with the new second, NULL to stop.
+ */
+void rtcSetSecondsHandler(WorkHandler handler) {
+	if (handler != NULL) {
+		secondsHandler = handler;
+		RTC_IER |= RTC_IER_TSIE_MASK;
+		NVIC_EnableIRQ(RTC_Seconds_IRQn);
+	} else {
+		// Stopped before the handler is cleared, the interrupt never sees it half done
+		RTC_IER &= ~RTC_IER_TSIE_MASK;
+		NVIC_DisableIRQ(RTC_Seconds_IRQn);
+		secondsHandler = NULL;
+	}
+}
+
+/**
+ * Programs the drift compensation.
+ *
+ * @param compensation Value of RTC_TCR bits 15:0, CIR in the high byte and TCR in the low
+ * byte.
+ */
+void rtcSetCompensation(uint16_t compensation) {
+	RTC_TCR = RTC_TCR_CIR(compensation >> 8) | RTC_TCR_TCR(compensation);
+}
+
+/**
+ * Returns the drift compensation in the format of rtcSetCompensation().
+ */
+uint16_t rtcGetCompensation() {
+	return (uint16_t) (RTC_TCR & (RTC_TCR_CIR_MASK | RTC_TCR_TCR_MASK));
+}
+
+/**
+ * Returns the adjustment of the present second, RTC_TCR TCV. It is TCR in the last
+ * second of a compensation interval and 0 in the others, a new compensation takes
+ * effect once the interval in progress has ended.
+ *
+ * @return Ticks the present second is shortened by, negative if it is lengthened.
+ */
+int8_t rtcCompensationApplied() {
+	return (int8_t) ((RTC_TCR & RTC_TCR_TCV_MASK) >> RTC_TCR_TCV_SHIFT);
+}
@@ -0,0 +1,162 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: timer.c
+ * Description: Millisecond time base driven by PIT channel 0. Sleeping functions put the core
+ * into WAIT mode between the time base interrupts instead of spinning in a loop.
+ */
+
+#include "MK60D10.h"
+#include "board.h"
+#include "timer.h"
+#include "profile.h"
+
+#define PIT_TICKS_PER_MS (BUS_CLOCK_HZ / TIMER_TICK_HZ) // PIT0 reload period
+#define PIT_TICKS_PER_US (BUS_CLOCK_HZ / 1000000u)      // PIT0 counts per microsecond
+
+static volatile uint32_t msTicks = 0; // Milliseconds since PITInit()
+static TickHandler tickHandlers[TIMER_MAX_TICK_HANDLERS]; // Called on every tick
+static volatile int tickHandlerCount = 0;
+
+/**
+ * Initializes PIT channel 0 as a 1 ms periodic interrupt.
+ */
+void PITInit() {
+	SIM->SCGC6 |= SIM_SCGC6_PIT_MASK;
+
+	// Enable the PIT module and stop it while the core is halted by a debugger
+	PIT->MCR = PIT_MCR_FRZ_MASK;
+
+	PIT->CHANNEL[0].LDVAL = PIT_TICKS_PER_MS - 1;
+	PIT->CHANNEL[0].TFLG = PIT_TFLG_TIF_MASK;
+	PIT->CHANNEL[0].TCTRL = PIT_TCTRL_TIE_MASK | PIT_TCTRL_TEN_MASK;
+
+	NVIC_ClearPendingIRQ(PIT0_IRQn);
+	NVIC_EnableIRQ(PIT0_IRQn);
+}
+
+/**
+ * Registers a function to be called from the time base interrupt every millisecond.
+ * Handlers run in interrupt context and must return quickly.
+ *
+ * @param handler Function to be called.
+ * @return True if the handler was registered, false if the table is full.
+ */
+bool timerAddTickHandler(TickHandler handler) {
+	if (tickHandlerCount >= TIMER_MAX_TICK_HANDLERS) {
+		return false;
+	}
+	tickHandlers[tickHandlerCount] = handler;
+	tickHandlerCount++; // Publish the entry only after it has been written
+	return true;
+}
+
+/**
+ * PIT channel 0 interrupt handler, advances the millisecond counter and runs the
+ * registered tick handlers.
+ */
+void PIT0_IRQHandler() {
+	PROFILE_STACK_BEGIN();
+	PIT->CHANNEL[0].TFLG = PIT_TFLG_TIF_MASK;
+	msTicks++;
+
+	for (int i = 0; i < tickHandlerCount; i++) {
+		tickHandlers[i]();
+	}
+	PROFILE_STACK_END(PROFILE_STACK_TICK);
+}
+
+/**
+ * Returns the number of milliseconds since PITInit(). Wraps after about 49 days.
+ *
+ * @return Milliseconds elapsed.
+ */
+uint32_t timerMillis() {
+	return msTicks;
+}
+
+/**
+ * Returns the number of microseconds since PITInit(). Wraps after about 71 minutes,
+ * so it is only meant for measuring short intervals.
+ *
+ * @return Microseconds elapsed.
+ */
+uint32_t timerMicros() {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	uint32_t ms = msTicks;
+	uint32_t elapsed = PIT_TICKS_PER_MS - 1 - PIT->CHANNEL[0].CVAL;
+
+	// The counter may have reloaded after msTicks was read but before the
+	// interrupt could run, in that case the pending tick belongs to this reading
+	if ((PIT->CHANNEL[0].TFLG & PIT_TFLG_TIF_MASK)
+			&& elapsed < PIT_TICKS_PER_MS / 2) {
+		ms++;
+	}
+
+	__set_PRIMASK(primask);
+	return ms * 1000u + elapsed / PIT_TICKS_PER_US;
+}
+
+/**
+ * Moves the time base forward after a period during which the PIT was not clocked,
+ * e.g. a deep sleep. Must be called with interrupts disabled.
+ *
+ * @param ms Milliseconds that passed without being counted.
+ */
+void timerAdvance(uint32_t ms) {
+	msTicks += ms;
+}
+
+/**
+ * Computes a deadline the given number of milliseconds from now.
+ *
+ * @param ms Milliseconds from now.
+ * @return Deadline to be checked with deadlineExpired().
+ */
+deadline_t deadlineIn(uint32_t ms) {
+	return msTicks + ms;
+}
+
+/**
+ * Checks whether a deadline has passed. Correct across the counter wrap-around
+ * as long as the deadline is less than about 24 days away.
+ *
+ * @param deadline Deadline returned by deadlineIn().
+ * @return True if the deadline has passed, false otherwise.
+ */
+bool deadlineExpired(deadline_t deadline) {
+	return (int32_t) (msTicks - deadline) >= 0;
+}
+
+/**
+ * Sleeps for the given number of milliseconds. The core waits in WAIT mode and is
+ * woken up by the time base (or any other) interrupt.
+ *
+ * @param ms Duration of the sleep in milliseconds.
+ */
+void sleepMs(uint32_t ms) {
+	// One extra tick makes sure at least ms full milliseconds pass
+	deadline_t deadline = deadlineIn(ms + 1);
+
+	while (!deadlineExpired(deadline)) {
+		__WFI();
+	}
+}
+
+/**
+ * Sleeps for the given number of microseconds. The core waits in WAIT mode while more
+ * than one time base tick remains, the rest is measured on the PIT counter.
+ *
+ * @param us Duration of the sleep in microseconds.
+ */
+void sleepUs(uint32_t us) {
+	uint32_t start = timerMicros();
+	uint32_t elapsed;
+
+	while ((elapsed = timerMicros() - start) < us) {
+		if (us - elapsed > 1000) {
+			__WFI(); // The next time base tick wakes the core up at the latest
+		}
+	}
+}
@@ -0,0 +1,102 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: tone.c
+ * Description: Speaker output of the synthesizer. FTM0 channel 1 drives PTA4 with a PWM of
+ * about 47 kHz, far above what the speaker can follow, and PIT channel 2 sets its duty from
+ * the next sample SYNTH_SAMPLE_RATE_HZ times per second. The duty is double buffered by
+ * FTM0, so it changes at the end of a PWM period. When the synthesizer falls silent PIT2
+ * and FTM0 are stopped and the pin is driven low, as before the first note.
+ */
+
+#include "MK60D10.h"
+#include "board.h"
+#include "irq.h"
+#include "synth.h"
+#include "tone.h"
+#include "profile.h"
+
+#define PWM_PERIOD    1024 // FTM0 clocks per PWM period, the bus clock undivided
+#define SAMPLE_SHIFT  6    // Turns a sample into half the PWM period
+#define SAMPLE_TICKS  (BUS_CLOCK_HZ / SYNTH_SAMPLE_RATE_HZ) // PIT2 period
+#define SPK_CHANNEL   1    // PTA4 is FTM0_CH1 (ALT3)
+#define SPK_PIN       4
+
+static volatile bool running = false; // The sample interrupt is running
+
+/**
+ * Initializes FTM0 for edge-aligned PWM on the speaker channel and PIT channel 2 for
+ * the samples. Both are kept stopped and the pin stays in GPIO mode until a note is
+ * queued. PITInit() has to be called before.
+ */
+void ToneInit() {
+	SIM->SCGC6 |= SIM_SCGC6_FTM0_MASK;
+
+	FTM0->SC = 0;           // Counter stopped
+	FTM0->MODE = FTM_MODE_WPDIS_MASK;
+	FTM0->CNTIN = 0;
+	FTM0->CNT = 0;
+	FTM0->MOD = PWM_PERIOD - 1;
+	FTM0->CONTROLS[SPK_CHANNEL].CnSC = FTM_CnSC_MSB_MASK | FTM_CnSC_ELSB_MASK; // High-true pulses
+	FTM0->CONTROLS[SPK_CHANNEL].CnV = PWM_PERIOD / 2;
+
+	PIT->CHANNEL[2].TCTRL = 0;
+	PIT->CHANNEL[2].LDVAL = SAMPLE_TICKS - 1;
+	PIT->CHANNEL[2].TFLG = PIT_TFLG_TIF_MASK;
+	NVIC_ClearPendingIRQ(PIT2_IRQn);
+	NVIC_EnableIRQ(PIT2_IRQn);
+}
+
+/**
+ * Starts the PWM and the sample interrupt unless they are running, called by the
+ * synthesizer after queuing a note.
+ */
+void toneStart() {
+	uint32_t state = irqSave();
+
+	if (!running) {
+		running = true;
+		FTM0->CNT = 0;
+		FTM0->CONTROLS[SPK_CHANNEL].CnV = PWM_PERIOD / 2; // Silence until the first sample
+		PORTA->PCR[SPK_PIN] = PORT_PCR_MUX(0x03); // Hand the pin over to FTM0
+		FTM0->SC = FTM_SC_CLKS(0x01) | FTM_SC_PS(0);
+		PIT->CHANNEL[2].TFLG = PIT_TFLG_TIF_MASK;
+		PIT->CHANNEL[2].TCTRL = PIT_TCTRL_TIE_MASK | PIT_TCTRL_TEN_MASK;
+	}
+
+	irqRestore(state);
+}
+
+/**
+ * Checks whether the sample interrupt is running, it needs the bus clock.
+ */
+bool toneRunning() {
+	return running;
+}
+
+/**
+ * Sample interrupt, sets the duty of the next PWM period from the next sample and stops
+ * the output once the synthesizer is silent.
+ */
+void PIT2_IRQHandler() {
+	PROFILE_STACK_BEGIN();
+	PROFILE_BEGIN();
+	PIT->CHANNEL[2].TFLG = PIT_TFLG_TIF_MASK;
+
+	int32_t sample = synthSample();
+	FTM0->CONTROLS[SPK_CHANNEL].CnV = (uint32_t) (PWM_PERIOD / 2 + (sample >> SAMPLE_SHIFT));
+
+	if (!synthIsPlaying()) {
+		// A note queued by a preempting interrupt after the check above finds running
+		// still set and does not restart the output, so check again with all masked
+		uint32_t state = irqSave();
+		if (!synthIsPlaying()) {
+			PIT->CHANNEL[2].TCTRL = 0;
+			PORTA->PCR[SPK_PIN] = PORT_PCR_MUX(0x01); // Back to GPIO, the output latch is low
+			FTM0->SC = 0;
+			running = false;
+		}
+		irqRestore(state);
+	}
+	PROFILE_END(PROFILE_SYNTH_SAMPLE);
+	PROFILE_STACK_END(PROFILE_STACK_SYNTH);
+}
@@ -0,0 +1,381 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: uart.c
+ * Description: UART5 console driver. Received bytes are stored by the interrupt handler
+ * into a ring buffer and the handler given to UARTInit() is posted as deferred work, once
+ * until it has started. Transmitted data is queued as segments which DMA channel 0 sends to
+ * the UART one segment at a time, so the callers never wait for the line. A segment either
+ * points to a constant buffer (sent without copying) or to bytes copied into the transmit
+ * ring buffer by UARTSendStr(). The interrupt also notes the RTC time of every received
+ * byte, so a protocol can tell when a byte came in however late the main loop reads it.
+ */
+
+#include "MK60D10.h"
+#include <stddef.h>
+#include "ringbuf.h"
+#include "work.h"
+#include "rtc.h"
+#include "uart.h"
+#include "profile.h"
+
+#define DMAMUX_SOURCE_UART5 11  // UART5 transmit/receive DMA request
+#define DMA_MAX_MAJOR_LOOP 0x7FFF // Longest transfer a single TCD can do
+
+// Piece of data waiting for transmission, data NULL means the bytes are in txBuffer
+struct TxSegment {
+	const uint8_t *data;
+	uint16_t length;
+};
+
+static uint8_t rxStorage[UART_RX_BUFFER_SIZE];
+static uint8_t txStorage[UART_TX_BUFFER_SIZE];
+static struct RingBuffer rxBuffer = RING_BUFFER_INIT(rxStorage); // Filled by the ISR
+static struct RingBuffer txBuffer = RING_BUFFER_INIT(txStorage); // Drained by DMA
+static struct RtcTime rxTimes[UART_RX_BUFFER_SIZE]; // Receive time of the bytes of rxBuffer
+static struct RtcTime readTime; // Receive time of the byte last read by UARTReadCh()
+
+static struct TxSegment txQueue[UART_TX_QUEUE_SIZE];
+static volatile uint8_t txQueueHead = 0;  // Written by the main loop only
+static volatile uint8_t txQueueTail = 0;  // Written by the DMA interrupt only
+static volatile bool txBusy = false;      // DMA transfer in progress
+static uint16_t txUnqueued = 0;           // Bytes copied into txBuffer but not queued yet
+static volatile uint16_t txActiveLength;  // Length of the running DMA transfer
+
+static volatile uint32_t overrunCount = 0; // Bytes lost by the UART hardware
+static volatile uint32_t droppedCount = 0; // Bytes lost because rxBuffer was full
+
+static WorkHandler receivedHandler = NULL;
+static volatile bool rxPosted = false; // rxReceived() is queued and has not started yet
+
+static void txStartNext();
+
+/**
+ * Initializes the UART5 peripheral with specific settings for communication and
+ * the DMA channel used by the transmitter.
+ *
+ * @param received Posted as deferred work when bytes have been received.
+ */
+void UARTInit(WorkHandler received) {
+	receivedHandler = received;
+
+	UART5->C2 &= ~(UART_C2_RE_MASK | UART_C2_TE_MASK);
+	UART5->BDH = 0;
+	UART5->BDL = 0x1A;
+	UART5->C4 = 0x0F;
+	UART5->C1 = 0;
+	UART5->C3 = 0;
+	UART5->MA1 = 0;
+	UART5->MA2 = 0;
+	UART5->S2 |= 0xC0;
+	UART5->C5 = UART_C5_TDMAS_MASK; // TDRE requests DMA instead of an interrupt
+	UART5->C2  |= ( UART_C2_TE_MASK | UART_C2_RE_MASK | UART_C2_RIE_MASK | UART_C2_TIE_MASK );
+
+	// Route the UART5 request to the transmit channel, the channel itself is
+	// enabled for every segment by txStartNext()
+	SIM->SCGC6 |= SIM_SCGC6_DMAMUX_MASK;
+	SIM->SCGC7 |= SIM_SCGC7_DMA_MASK;
+	DMAMUX->CHCFG[UART_TX_DMA_CHANNEL] = 0;
+	DMAMUX->CHCFG[UART_TX_DMA_CHANNEL] = DMAMUX_CHCFG_ENBL_MASK
+			| DMAMUX_CHCFG_SOURCE(DMAMUX_SOURCE_UART5);
+
+	NVIC_ClearPendingIRQ(DMA0_IRQn);
+	NVIC_EnableIRQ(DMA0_IRQn);
+	NVIC_ClearPendingIRQ(UART5_RX_TX_IRQn);
+	NVIC_EnableIRQ(UART5_RX_TX_IRQn);
+}
+
+/**
+ * Deferred handler of received bytes, runs the handler given to UARTInit(). The flag is
+ * cleared first, so a byte that arrives while the bytes are being read posts it again.
+ */
+static void rxReceived(uint32_t arg) {
+	rxPosted = false;
+	receivedHandler(arg);
+}
+
+/**
+ * UART5 status interrupt handler. Moves received bytes into the receive buffer.
+ */
+void UART5_RX_TX_IRQHandler() {
+	PROFILE_STACK_BEGIN();
+	uint8_t s1 = UART5->S1;
+
+	if (UART5->S2 & UART_S2_RXEDGIF_MASK) {
+		UART5->S2 |= UART_S2_RXEDGIF_MASK; // Wake-up edge, see UARTSetWakeOnRx()
+	}
+
+	if (s1 & (UART_S1_RDRF_MASK | UART_S1_OR_MASK)) {
+		uint8_t byte = UART5->D; // Reading S1 and then D clears RDRF and OR
+		if (s1 & UART_S1_OR_MASK) {
+			overrunCount++;
+		}
+		if (s1 & UART_S1_RDRF_MASK) {
+			// In a full ring the slot at head still belongs to the oldest unread byte, so
+			// the time is only written when the byte fits, and before it is published
+			if (ringFree(&rxBuffer) > 0) {
+				rtcRead(&rxTimes[rxBuffer.head & (UART_RX_BUFFER_SIZE - 1)]);
+				(void) ringPut(&rxBuffer, byte);
+			} else {
+				droppedCount++;
+			}
+		}
+		if (!rxPosted && receivedHandler != NULL) {
+			rxPosted = workPost(rxReceived, 0); // Tried again with the next byte if full
+		}
+	}
+
+	PROFILE_STACK_END(PROFILE_STACK_UART);
+}
+
+/**
+ * Starts the DMA transfer of the oldest queued segment. Runs with the DMA interrupt
+ * masked, either from the interrupt itself or from txKick().
+ */
+static void txStartNext() {
+	while (txQueueTail != txQueueHead) {
+		struct TxSegment *segment = &txQueue[txQueueTail & (UART_TX_QUEUE_SIZE - 1)];
+		const volatile uint8_t *source;
+		uint16_t length;
+
+		if (segment->length == 0) {
+			txQueueTail++;
+			continue;
+		}
+
+		if (segment->data != NULL) {
+			source = segment->data;
+			length = segment->length;
+		} else {
+			// Ring data may wrap around, send it up to the end of the storage first
+			source = ringTailPtr(&txBuffer);
+			length = ringContiguous(&txBuffer);
+			if (length > segment->length) {
+				length = segment->length;
+			}
+		}
+		if (length > DMA_MAX_MAJOR_LOOP) {
+			length = DMA_MAX_MAJOR_LOOP;
+		}
+
+		DMA_TCD_Type *tcd = &DMA0->TCD[UART_TX_DMA_CHANNEL];
+		tcd->SADDR = (uint32_t) source;
+		tcd->SOFF = 1;
+		tcd->ATTR = DMA_ATTR_SSIZE(0) | DMA_ATTR_DSIZE(0); // 8-bit transfers
+		tcd->NBYTES_MLNO = 1;                              // One byte per request
+		tcd->SLAST = 0;
+		tcd->DADDR = (uint32_t) &UART5->D;
+		tcd->DOFF = 0;
+		tcd->CITER_ELINKNO = DMA_CITER_ELINKNO_CITER(length);
+		tcd->BITER_ELINKNO = DMA_BITER_ELINKNO_BITER(length);
+		tcd->DLAST_SGA = 0;
+		tcd->CSR = DMA_CSR_INTMAJOR_MASK | DMA_CSR_DREQ_MASK; // Stop and interrupt at the end
+
+		txActiveLength = length;
+		txBusy = true;
+		DMA0->SERQ = DMA_SERQ_SERQ(UART_TX_DMA_CHANNEL);
+		return;
+	}
+	txBusy = false;
+}
+
+/**
+ * DMA channel 0 interrupt handler, the current transfer has finished. Releases the sent
+ * data and starts the next segment.
+ */
+void DMA0_IRQHandler() {
+	PROFILE_STACK_BEGIN();
+	DMA0->CINT = DMA_CINT_CINT(UART_TX_DMA_CHANNEL);
+
+	struct TxSegment *segment = &txQueue[txQueueTail & (UART_TX_QUEUE_SIZE - 1)];
+	if (segment->data != NULL) {
+		segment->data += txActiveLength;
+	} else {
+		ringRelease(&txBuffer, txActiveLength);
+	}
+	segment->length -= txActiveLength;
+	if (segment->length == 0) {
+		txQueueTail++;
+	}
+
+	txStartNext();
+	PROFILE_STACK_END(PROFILE_STACK_DMA);
+}
+
+/**
+ * Starts the transmitter if it is idle.
+ */
+static void txKick() {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if (!txBusy) {
+		txStartNext();
+	}
+	__set_PRIMASK(primask);
+}
+
+/**
+ * Appends a segment to the transmit queue, waits only if the queue is full.
+ */
+static void txQueueSegment(const uint8_t *data, uint16_t length) {
+	while ((uint8_t) (txQueueHead - txQueueTail) >= UART_TX_QUEUE_SIZE) {
+		__WFI(); // A slot is freed by the DMA interrupt
+	}
+	struct TxSegment *segment = &txQueue[txQueueHead & (UART_TX_QUEUE_SIZE - 1)];
+	segment->data = data;
+	segment->length = length;
+	txQueueHead++; // Publish the segment only after it has been written
+	txKick();
+}
+
+/**
+ * Queues the bytes copied into the transmit ring buffer since the last call.
+ */
+static void txFlushRing() {
+	if (txUnqueued != 0) {
+		txQueueSegment(NULL, txUnqueued);
+		txUnqueued = 0;
+	}
+}
+
+/**
+ * Copies a byte into the transmit ring buffer. When the buffer is full the bytes
+ * copied so far are handed to the DMA and the function waits for free space.
+ */
+static void txPut(uint8_t byte) {
+	while (!ringPut(&txBuffer, byte)) {
+		txFlushRing();
+		__WFI(); // Space is freed by the DMA interrupt
+	}
+	txUnqueued++;
+}
+
+/**
+ * Queues a character for transmission via UART.
+ *
+ * @param ch Character to be sent.
+ */
+void SendCh(char ch) {
+	txPut((uint8_t) ch);
+	txFlushRing();
+}
+
+/**
+ * Queues a string for transmission via UART, every '\n' is followed by '\r'.
+ * The string is copied, so it may be changed as soon as the function returns.
+ *
+ * @param s String to be sent.
+ */
+void UARTSendStr(const char *s) {
+	PROFILE_BEGIN();
+	int i = 0;
+	while (s[i] != 0) {
+		txPut(s[i++]);
+		if (s[i - 1] == '\n') {
+			txPut('\r');
+		}
+	}
+	txFlushRing();
+	PROFILE_END(PROFILE_UART_SEND);
+}
+
+/**
+ * Queues binary data for transmission via UART. The data is copied as it is, without
+ * any line ending translation.
+ *
+ * @param data Data to be sent.
+ * @param length Number of bytes to be sent.
+ */
+void UARTSendBytes(const uint8_t *data, uint16_t length) {
+	for (uint16_t i = 0; i < length; i++) {
+		txPut(data[i]);
+	}
+	txFlushRing();
+}
+
+/**
+ * Queues a buffer for transmission via UART without copying it. The buffer must stay
+ * unchanged until it has been sent, which is why this is meant for constant data with
+ * line endings already expanded, see UARTSendConst().
+ *
+ * @param data Data to be sent.
+ * @param length Number of bytes to be sent.
+ */
+void UARTSendBuf(const char *data, uint16_t length) {
+	txQueueSegment((const uint8_t *) data, length);
+}
+
+/**
+ * Checks whether everything queued for transmission has left the UART, i.e. the
+ * clocks may be stopped without cutting off a character.
+ *
+ * @return True if the transmitter is idle.
+ */
+bool UARTTxIdle() {
+	return !txBusy && txQueueHead == txQueueTail
+			&& (UART5->S1 & UART_S1_TC_MASK);
+}
+
+/**
+ * Enables or disables the receive input active edge interrupt, which is able to wake
+ * the core up from a stop mode when a start bit arrives.
+ *
+ * @param enable True to enable the wake-up interrupt.
+ */
+void UARTSetWakeOnRx(bool enable) {
+	if (enable) {
+		UART5->S2 |= UART_S2_RXEDGIF_MASK;
+		UART5->BDH |= UART_BDH_RXEDGIE_MASK;
+	} else {
+		UART5->BDH &= ~UART_BDH_RXEDGIE_MASK;
+	}
+}
+
+/**
+ * Reads one received character if there is any.
+ *
+ * @param ch Where the character is stored.
+ * @return True if a character was read, false if nothing was received.
+ */
+bool UARTReadCh(char* ch) {
+	uint8_t byte;
+
+	readTime = rxTimes[rxBuffer.tail & (UART_RX_BUFFER_SIZE - 1)];
+	if (!ringGet(&rxBuffer, &byte)) {
+		return false;
+	}
+	*ch = (char) byte;
+	return true;
+}
+
+/**
+ * Returns the RTC time the character last read by UARTReadCh() was received, taken by
+ * the receive interrupt.
+ *
+ * @param time Pointer to store the time.
+ */
+void UARTRxTime(struct RtcTime *time) {
+	*time = readTime;
+}
+
+/**
+ * Checks whether there is a received character waiting to be read.
+ *
+ * @return True if UARTReadCh() would return a character.
+ */
+bool UARTRxAvailable() {
+	return ringCount(&rxBuffer) != 0;
+}
+
+/**
+ * Returns the number of received bytes lost by the UART hardware (receiver overrun).
+ */
+uint32_t UARTOverrunCount() {
+	return overrunCount;
+}
+
+/**
+ * Returns the number of received bytes dropped because the receive buffer was full.
+ */
+uint32_t UARTDroppedCount() {
+	return droppedCount;
+}
@@ -0,0 +1,159 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: leds.c
+ * Description: Brightness and fades of the LEDs D9-D12. The brightness is turned into the
+ * bit planes of the software PWM in pwm.h, in plane k an LED is on if bit k of its duty is
+ * set. Fades are moved by the time base.
+ */
+
+#include "board.h"
+#include "timer.h"
+#include "irq.h"
+#include "pwm.h"
+#include "leds.h"
+
+#define LED_FIRST_MASK LED_D12 // LED 0, LED i is LED_D12 << i
+
+// Brightness and running fade of one LED
+struct Led {
+	uint16_t level;     // Current brightness, 8.8 fixed point
+	int32_t step;       // Change of level per ms while fading, a full swing in 1 ms needs 17 bits
+	uint16_t fadeLeft;  // ms left of the fade, 0 when not fading
+	uint8_t target;     // Brightness at the end of the fade
+};
+
+static struct Led ledState[LED_COUNT];
+static volatile uint8_t fadeCount = 0; // LEDs with a fade in progress
+
+static void ledsTick();
+
+/**
+ * Initializes the PWM and hooks the fades to the time base. Has to be called after
+ * PITInit(), the LEDs start switched off.
+ */
+void LedsInit() {
+	PwmInit();
+	timerAddTickHandler(ledsTick);
+}
+
+/**
+ * Maps a brightness to the PWM duty. The eye is far more sensitive at low duty, squaring
+ * makes the steps of a fade look even.
+ *
+ * @param level Brightness, 0 to LED_LEVEL_MAX.
+ * @return Duty in PWM units, 0 to LED_LEVEL_MAX.
+ */
+static uint8_t ledGamma(uint8_t level) {
+	return (uint8_t) ((level * level + LED_LEVEL_MAX) >> 8);
+}
+
+/**
+ * Recomputes the bit planes from the current brightness of all LEDs and hands them to
+ * the PWM. LEDs that are fully on or off need no modulation. Called from both the main
+ * loop and the time base.
+ */
+static void ledsUpdate() {
+	uint8_t on = 0;     // Fully on
+	uint8_t dimmed = 0; // Need PWM
+	uint8_t duty[LED_COUNT];
+	uint8_t planes[PWM_BITS];
+
+	for (int i = 0; i < LED_COUNT; i++) {
+		duty[i] = ledGamma(ledState[i].level >> 8);
+		if (duty[i] == LED_LEVEL_MAX) {
+			on |= LED_FIRST_MASK << i;
+		} else if (duty[i] != 0) {
+			dimmed |= LED_FIRST_MASK << i;
+		}
+	}
+
+	for (int k = 0; k < PWM_BITS; k++) {
+		uint8_t mask = on;
+		for (int i = 0; i < LED_COUNT; i++) {
+			if (duty[i] & (1u << k)) {
+				mask |= LED_FIRST_MASK << i;
+			}
+		}
+		planes[k] = mask;
+	}
+
+	pwmShow(planes, on, dimmed != 0);
+}
+
+/**
+ * Sets the brightness of LEDs immediately, cancelling their fades.
+ *
+ * @param leds LED_D9..LED_D12 bits of the LEDs to set.
+ * @param level Brightness, 0 is off, LED_LEVEL_MAX fully on.
+ */
+void ledsSet(uint8_t leds, uint8_t level) {
+	ledsFade(leds, level, 0);
+}
+
+/**
+ * Fades LEDs linearly from their current brightness to a new one. The fade runs from
+ * the time base, the call returns immediately.
+ *
+ * @param leds LED_D9..LED_D12 bits of the LEDs to fade.
+ * @param level Brightness at the end of the fade.
+ * @param duration_ms Duration of the fade, 0 sets the brightness right away.
+ */
+void ledsFade(uint8_t leds, uint8_t level, uint16_t duration_ms) {
+	uint32_t state = irqSave();
+
+	for (int i = 0; i < LED_COUNT; i++) {
+		if (!(leds & (LED_FIRST_MASK << i))) {
+			continue;
+		}
+		struct Led *led = &ledState[i];
+		if (led->fadeLeft != 0) {
+			fadeCount--;
+		}
+		led->target = level;
+		if (duration_ms == 0) {
+			led->level = level << 8;
+			led->fadeLeft = 0;
+		} else {
+			led->step = ((int32_t) (level << 8) - led->level) / duration_ms;
+			led->fadeLeft = duration_ms;
+			fadeCount++;
+		}
+	}
+
+	ledsUpdate();
+	irqRestore(state);
+}
+
+/**
+ * Checks whether the LEDs need the bus clock running, which is while PWM or a fade
+ * is in progress. Plain on and off states survive VLPS.
+ *
+ * @return True if the chip must not enter a stop mode.
+ */
+bool ledsNeedClocks() {
+	return pwmRunning() || fadeCount != 0;
+}
+
+/**
+ * Time base handler, moves the running fades by one millisecond.
+ */
+static void ledsTick() {
+	if (fadeCount == 0) {
+		return;
+	}
+
+	for (int i = 0; i < LED_COUNT; i++) {
+		struct Led *led = &ledState[i];
+		if (led->fadeLeft == 0) {
+			continue;
+		}
+		if (--led->fadeLeft == 0) {
+			led->level = led->target << 8; // Land exactly on the target
+			fadeCount--;
+		} else {
+			led->level = (uint16_t) (led->level + led->step);
+		}
+	}
+
+	ledsUpdate();
+}
@@ -0,0 +1,21 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: leds.h
+ * Description: Brightness control and fades of the LEDs D9-D12.
+ */
+
+#ifndef LEDS_H
+#define LEDS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LED_COUNT     4   // D9 to D12
+#define LED_LEVEL_MAX 255 // Full brightness
+
+void LedsInit();
+void ledsSet(uint8_t leds, uint8_t level);
+void ledsFade(uint8_t leds, uint8_t level, uint16_t duration_ms);
+bool ledsNeedClocks();
+
+#endif /* LEDS_H */
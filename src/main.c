@@ -1,805 +1,2357 @@
-/*
- * Author: Vladimir Azarov
- * Filename: main.c
- * Description: This program is designed to run on a microcontroller with specific hardware features.
- * It implements a digital clock with an alarm system, allowing the user to set the time, alarm time, melody, and light effects.
- * It handles user input through UART and controls LEDs and a speaker for alarm notifications.
- */
-
-#include "MK60D10.h"
-#include <string.h>
-#include <time.h>
-#include <stdio.h>
-#include <stdbool.h>
-
-// Define constants for LED, buttons, and speaker hardware connections
-#define LED_D9  0x20      // Port B, bit 5
-#define LED_D10 0x10      // Port B, bit 4
-#define LED_D11 0x8       // Port B, bit 3
-#define LED_D12 0x4       // Port B, bit 2
-
-#define BTN_SW2 0x400     // Port E, bit 10
-#define BTN_SW3 0x1000    // Port E, bit 12
-#define BTN_SW4 0x8000000 // Port E, bit 27
-#define BTN_SW5 0x4000000 // Port E, bit 26
-#define BTN_SW6 0x800     // Port E, bit 11
-
-#define SPK 0x10          // Speaker is on PTA4
-
-#define TOTAL_NOTES 10 // Total number of notes in the melody
-#define TOTAL_LIGHT_STATES 20 // Total number of light states
-
-// Enum for tracking the state of the user interface
-enum InterfaceState {
-	IDLE, READING_INPUT, PROCESSING_INPUT
-};
-
-enum InterfaceState interfaceState = IDLE; // Current state of the interface
-
-// Global variables for program functionality
-char inputBuffer[100]; // Buffer to store user input from UART
-int inputIndex = 0; // Index for the input buffer
-
-// Variables for alarm, melody, and light control
-int selectedMelodyID = 1;
-int selectedLightEffectID = 1;
-bool alarmEnabled = false;
-int alarmRepeatCount = 5;
-int alarmIntervalSeconds = 5;
-
-// Variables for time tracking
-time_t globalAlarmTime = 0; // Time for the alarm to go off
-bool isPlayingMelody = false; // Flag to check if melody is playing
-bool isShowingLights = false; // Flag to check if lights are showing
-int melodyIndex = 0; // Index for the current note in the melody
-int lightIndex = 0; // Index for the current light state
-
-// Function prototypes for various utility, initialization, and control functions
-void UARTSendStr(char* str);
-bool UARTReceiveStr(char* buffer, int bufferSize);
-void handleAlarmRepeats();
-void chooseMelody();
-void chooseLightEffect();
-void toggleAlarm(int enable);
-void displayAlarmStatus();
-void setAlarmRepeat();
-void Delay(long long bound);
-void MCUInit();
-void MakeSound(uint32_t duration_ms);
-void UARTInit();
-void PortsInit();
-void RTCInit();
-void setClock();
-void setAlarm();
-void playMelody(int melodyID);
-void lightSignal(int signalID);
-bool getUserTimeInput(int *year, int *month, int *day, int *hour, int *min,
-		int *sec);
-void RTC_IRQHandler();
-void startMelody(int melodyID);
-void startLightEffect(int lightEffectID);
-void playNextNote();
-void updateLights();
-void SendCh(char ch);
-void checkUserInput();
-void processUserInput(char* input);
-void displayMenu();
-int main(void);
-
-/**
- * Initiates the playing of a selected melody.
- *
- * @param melodyID The ID of the melody to be played.
- */
-void startMelody(int melodyID) {
-	selectedMelodyID = melodyID;
-	melodyIndex = 0;
-	isPlayingMelody = true;
-}
-
-/**
- * Initiates a selected light effect.
- *
- * @param lightEffectID The ID of the light effect to be initiated.
- */
-void startLightEffect(int lightEffectID) {
-	selectedLightEffectID = lightEffectID;
-	lightIndex = 0;
-	isShowingLights = true;
-}
-
-/**
- * Plays the next note in the selected melody.
- */
-void playNextNote() {
-	if (melodyIndex < TOTAL_NOTES) {
-		switch (selectedMelodyID) {
-		case 1:
-			MakeSound(50000 + melodyIndex * 5000);
-			Delay(50000);
-			break;
-		case 2:
-
-			MakeSound(100000 + melodyIndex * 10000);
-			Delay(10000);
-			MakeSound(100000 + melodyIndex * 10000);
-			Delay(10000);
-			MakeSound(100000 + melodyIndex * 10000);
-			break;
-		case 3:
-
-			MakeSound(10000 + melodyIndex * 5000);
-			Delay(2000);
-			MakeSound(100000 + melodyIndex * 5000);
-			Delay(10000);
-			MakeSound(10000 + melodyIndex * 5000);
-			Delay(5000);
-			MakeSound(100000 + melodyIndex * 5000);
-			Delay(1000);
-			break;
-		}
-		melodyIndex++;
-	} else {
-		isPlayingMelody = false;
-	}
-}
-/**
- * Updates the lights based on the selected effect.
- */
-void updateLights() {
-	if (lightIndex < TOTAL_LIGHT_STATES) {
-		switch (selectedLightEffectID) {
-		case 1:
-			// All LEDs on/off toggle pattern
-			if (lightIndex % 2 == 0) {
-				PTB->PDOR &= ~0x3C; // Turn all LEDs on
-			} else {
-				PTB->PDOR |= 0x3C;  // Turn all LEDs off
-			}
-			Delay(200000);
-			break;
-		case 2:
-			// Sequential lighting pattern
-			PTB->PDOR = ~(1 << lightIndex); // Turn on one LED at a time
-			Delay(200000);
-			break;
-		case 3:
-			// Rotating light pattern
-			PTB->PDOR = ~(1 << (lightIndex % 4 + 2)); // Rotate through LEDs
-			Delay(200000);
-			break;
-		}
-		lightIndex++;
-	} else {
-		isShowingLights = false;
-	}
-}
-/**
- * Sends a character via UART.
- *
- * @param ch Character to be sent.
- */
-void SendCh(char ch) {
-	while (!(UART5->S1 & UART_S1_TDRE_MASK) && !(UART5->S1 & UART_S1_TC_MASK))
-		;
-	UART5->D = ch;
-}
-/**
- * Sends a string via UART.
- *
- * @param s String to be sent.
- */
-void UARTSendStr(char *s) {
-	int i = 0;
-	while (s[i] != 0) {
-		SendCh(s[i++]);
-		if (s[i - 1] == '\n') {
-			SendCh('\r');
-		}
-	}
-}
-
-/**
- * Reads a string from UART until a newline character is received or the buffer is full.
- *
- * @param buffer The buffer where the received string will be stored.
- * @param bufferSize The size of the buffer.
- * @return Returns true if only a newline or carriage return is received, false otherwise.
- */
-bool UARTReceiveStr(char* buffer, int bufferSize) {
-	int i = 0;
-	char c;
-
-	// Receive characters until newline or buffer is full
-	do {
-		while (!(UART5_S1 & UART_S1_RDRF_MASK))
-			; // Wait for receive buffer to be full
-		c = UART5->D; // Read the received character
-		if (c == '\n' || c == '\r') {
-			if (i == 0) { // if it's the first character received
-				buffer[0] = '\0'; // Null-terminate the string
-				return true; // Return true indicating only newline/carriage return was received
-			}
-			break;
-		}
-		if (c == '\b' || c == '\177') { // Backspace character
-			if (i > 0) {
-				i--; // Remove the previous character
-			}
-		} else if (i < bufferSize - 1) {
-			buffer[i++] = c;
-		}
-	} while (i < bufferSize - 1);
-
-	buffer[i] = '\0'; // Null-terminate the string
-	return false; // Normal input, return false
-}
-/**
- * Handles the repetition of the alarm based on the set configuration.
- */
-void handleAlarmRepeats() {
-	static int currentRepeatCount = 1;
-	if (alarmEnabled) {
-		if (currentRepeatCount < alarmRepeatCount + 1) {
-			// Calculate the next alarm time
-			time_t nextAlarmTime = globalAlarmTime
-					+ (currentRepeatCount * alarmIntervalSeconds);
-
-			// Format the time of the next alarm
-			char nextTimeStr[50];
-			struct tm *nextAlarmTimeInfo = localtime(&nextAlarmTime);
-			strftime(nextTimeStr, sizeof(nextTimeStr), "%Y-%m-%d %H:%M:%S",
-					nextAlarmTimeInfo);
-
-			// Print attempt ID and next alarm time with formatted text
-			char buffer[500];
-			snprintf(buffer, sizeof(buffer),
-					"\033[1;3;31m\nPokus o buzeni %d\033[0m, \033[1;3;32mDalsi Alarm: %s\033[0m\n",
-					currentRepeatCount, nextTimeStr);
-			UARTSendStr(buffer);
-
-			// Set the RTC alarm to the next alarm time
-			RTC_TAR = (uint32_t) nextAlarmTime;
-
-			// Increase the repeat count
-			currentRepeatCount++;
-
-			// Initialize the alarm (melody and lights)
-			startMelody(selectedMelodyID);
-			startLightEffect(selectedLightEffectID);
-		} else {
-			// If all repeats are done
-			currentRepeatCount = 1; // Reset the repeat count
-			RTC_TAR = 0;            // Reset o the RTC alarm register
-		}
-	} else {
-		currentRepeatCount = 1; // Reset the repeat count
-		RTC_TAR = 0;            // Reset the RTC alarm register
-	}
-}
-/**
- * RTC interrupt handler to manage alarm repeats and display.
- */
-void RTC_IRQHandler() {
-	// Check if the alarm interrupt flag is set
-	if (RTC_SR & RTC_SR_TAF_MASK) {
-		handleAlarmRepeats();
-		if (alarmEnabled) {
-			while (isPlayingMelody && isShowingLights) {
-				playNextNote();
-				updateLights();
-			}
-			PTB->PDOR |= 0x3C;  // Turn all LEDs off
-		}
-		displayMenu();
-	}
-}
-
-/**
- * Allows the user to choose a melody for the alarm.
- */
-void chooseMelody() {
-	char buffer[100];
-
-	UARTSendStr("\033[1;37mVyberte melodii (1-3): \033[0m");
-	UARTReceiveStr(buffer, sizeof(buffer));
-	int melodyChoice = atoi(buffer);
-
-	if (melodyChoice >= 1 && melodyChoice <= 3) {
-		selectedMelodyID = melodyChoice;
-		UARTSendStr("\033[1;32m\nMelodie efekt byl vybrana.\n\033[0m");
-	} else {
-		UARTSendStr(
-				"\033[1;31m\nNeplatná volba, zadejte číslo mezi 1 a 3.\n\033[0m");
-	}
-}
-
-/**
- * Allows the user to choose a light effect for the alarm.
- */
-void chooseLightEffect() {
-	char buffer[100];
-
-	UARTSendStr("\033[1;37mVyberte světelný efekt (1-3): \033[0m");
-	UARTReceiveStr(buffer, sizeof(buffer));
-	int lightEffectChoice = atoi(buffer);
-
-	if (lightEffectChoice >= 1 && lightEffectChoice <= 3) {
-		selectedLightEffectID = lightEffectChoice;
-		UARTSendStr("\033[1;32m\nSvětelný efekt byl vybrán.\n\033[0m");
-	} else {
-		UARTSendStr(
-				"\033[1;31m\nNeplatná volba, zadejte číslo mezi 1 a 3.\n\033[0m");
-	}
-}
-/**
- * Toggles the alarm state between enabled and disabled based on the input.
- *
- * @param enable If 1, the alarm is enabled; if 0, the alarm is disabled.
- */
-void toggleAlarm(int enable) {
-	if (enable == 1) {
-		alarmEnabled = true;
-		UARTSendStr("\033[1;32mAlarm byl zapnut.\n\033[0m");
-	} else if (enable == 0) {
-		alarmEnabled = false;
-		UARTSendStr("\033[1;32mAlarm byl vypnut.\n\033[0m");
-	} else {
-		UARTSendStr(
-				"\033[1;31m\nNeplatná volba, zadejte 1 pro zapnutí nebo 0 pro vypnutí alarmu.\n\033[0m");
-	}
-}
-
-/**
- * Displays the current status of the alarm including time, melody, and light effect settings.
- */
-void displayAlarmStatus() {
-	char buffer[500];
-	char alarmTimeStr[50];
-	char currentTimeStr[50];
-	time_t currentTime;
-
-	// Get the current time from RTC
-	currentTime = RTC_TSR;
-
-	// Convert the current time to a readable format
-	struct tm *currentTimeInfo = localtime(&currentTime);
-	strftime(currentTimeStr, sizeof(currentTimeStr), "%Y-%m-%d %H:%M:%S",
-			currentTimeInfo);
-
-	// Convert the global alarm time to a readable format
-	struct tm *alarmTimeInfo = localtime(&globalAlarmTime);
-	strftime(alarmTimeStr, sizeof(alarmTimeStr), "%Y-%m-%d %H:%M:%S",
-			alarmTimeInfo);
-
-	// Create the status message with both the current time, alarm time, repetition count, and interval
-	UARTSendStr("\033[30;47m\nStav alarmu\033[0m\n");
-	snprintf(buffer, sizeof(buffer),
-			"\033[1;32m Alarm je %s\n\033[0m"  // Bold green for "Alarm je"
-					"\033[0;36m Čas alarmu: %s\n\033[0m"// Cyan for "Čas alarmu"
-					"\033[0;33m Aktuální čas: %s\n\033[0m"// Yellow for "Aktuální čas"
-					"\033[0;35m Vybraná melodie: %d\n\033[0m"// Magenta for "Vybraná melodie"
-					"\033[0;35m Vybraný světelný efekt: %d\n\033[0m"// Magenta for "Vybraný světelný efekt"
-					"\033[0;33m Počet opakování alarmu: %d\n\033[0m"// Yellow for "Počet opakování alarmu"
-					"\033[0;33m Interval opakování (v sekundách): %d\n\033[0m",// Yellow for "Interval opakování"
-			alarmEnabled ?
-					"\033[1;32mzapnut\033[0m" : "\033[1;31mvypnut\033[0m", // Green for "zapnut", Red for "vypnut"
-			alarmTimeStr, currentTimeStr, selectedMelodyID,
-			selectedLightEffectID,
-			alarmRepeatCount, alarmIntervalSeconds);
-
-	UARTSendStr(buffer);
-}
-/**
- * Allows the user to set the number of alarm repetitions and the interval between them.
- */
-void setAlarmRepeat() {
-	char buffer[100];
-
-	// Get the repeat count from the user
-	UARTSendStr(
-			"\033[1;37m\nZadejte počet opakování budíku (0 pro žádné opakování): \033[0m");
-	UARTReceiveStr(buffer, sizeof(buffer));
-	int repeatCount = atoi(buffer);
-
-	if (repeatCount >= 0) {
-		alarmRepeatCount = repeatCount;
-
-		// Get the interval between repetitions
-		UARTSendStr(
-				"\033[1;37m\nZadejte interval mezi opakováními v sekundách: \033[0m");
-		UARTReceiveStr(buffer, sizeof(buffer));
-		int intervalSeconds = atoi(buffer);
-
-		if (intervalSeconds > 0) {
-			alarmIntervalSeconds = intervalSeconds;
-			UARTSendStr(
-					"\033[1;32m\nNastavení opakování budíku bylo aktualizováno.\n\033[0m");
-		} else {
-			UARTSendStr(
-					"\033[1;31m\nNeplatný interval, musí být větší než 0.\n\033[0m");
-		}
-	} else {
-		UARTSendStr(
-				"\033[1;31m\nNeplatný počet opakování, musí být nezáporné číslo.\n\033[0m");
-	}
-}
-/**
- * Implements a simple delay.
- *
- * @param bound The duration of the delay.
- */
-void Delay(long long bound) {
-
-	long long i;
-	for (i = 0; i < bound; i++)
-		;
-}
-
-/**
- * Initializes the Microcontroller Unit (MCU) settings.
- */
-void MCUInit() {
-	MCG_C4 |= ( MCG_C4_DMX32_MASK | MCG_C4_DRST_DRS(0x01));
-	SIM_CLKDIV1 |= SIM_CLKDIV1_OUTDIV1(0x00);
-	WDOG_STCTRLH &= ~WDOG_STCTRLH_WDOGEN_MASK;
-}
-/**
- * Generates a sound from the speaker for a specified duration.
- *
- * @param duration_ms Duration of the sound in milliseconds.
- */
-void MakeSound(uint32_t duration_ms) {
-	// Activate the speaker
-	PTA->PSOR = SPK;
-
-	// Add a delay to keep the speaker active for the specified duration
-	Delay(duration_ms);
-
-	// Deactivate the speaker
-	PTA->PCOR = SPK;
-}
-/**
- * Initializes the UART5 peripheral with specific settings for communication.
- */
-void UARTInit() {
-	UART5->C2 &= ~(UART_C2_RE_MASK | UART_C2_TE_MASK);
-	UART5->BDH = 0;
-	UART5->BDL = 0x1A;
-	UART5->C4 = 0x0F;
-	UART5->C1 = 0;
-	UART5->C3 = 0;
-	UART5->MA1 = 0;
-	UART5->MA2 = 0;
-	UART5->S2 |= 0xC0;
-	UART5->C2  |= ( UART_C2_TE_MASK | UART_C2_RE_MASK );
-}
-/**
- * Initializes the ports used by LEDs, buttons, and the speaker.
- */
-void PortsInit() {
-	// Initialize all port clocks
-	SIM->SCGC5 = SIM_SCGC5_PORTB_MASK | SIM_SCGC5_PORTE_MASK
-			| SIM_SCGC5_PORTA_MASK;
-	SIM->SCGC1 = SIM_SCGC1_UART5_MASK;
-	SIM->SCGC6 = SIM_SCGC6_RTC_MASK;
-
-	// Configure LED pins as GPIO outputs
-	PORTB->PCR[5] = PORT_PCR_MUX(0x01); // For LED D9
-	PORTB->PCR[4] = PORT_PCR_MUX(0x01); // For LED D10
-	PORTB->PCR[3] = PORT_PCR_MUX(0x01); // For LED D11
-	PORTB->PCR[2] = PORT_PCR_MUX(0x01); // For LED D12
-
-	// Configure button pins as GPIO inputs
-	PORTE->PCR[10] = PORT_PCR_MUX(0x01); // For button SW2
-	PORTE->PCR[12] = PORT_PCR_MUX(0x01); // For button SW3
-	PORTE->PCR[27] = PORT_PCR_MUX(0x01); // For button SW4
-	PORTE->PCR[26] = PORT_PCR_MUX(0x01); // For button SW5
-	PORTE->PCR[11] = PORT_PCR_MUX(0x01); // For button SW6
-
-	// Configure speaker pin
-	PORTA->PCR[4] = PORT_PCR_MUX(0x01);
-
-	// Set LED pins to output and turn them off
-	PTB->PDDR |= GPIO_PDDR_PDD(0x3C);
-	PTB->PDOR |= GPIO_PDOR_PDO(0x3C);
-
-	PORTE->PCR[8] = PORT_PCR_MUX(0x03); // For UART transmitter
-	PORTE->PCR[9] = PORT_PCR_MUX(0x03); // For UART receiver
-
-	// Set speaker pin to output
-	PTA->PDDR |= GPIO_PDDR_PDD(SPK);
-	PTA->PDOR &= ~SPK;
-}
-
-/**
- * Initializes the Real-Time Clock (RTC) peripheral.
- */
-void RTCInit() {
-	// Reset RTC registers
-	RTC_CR |= RTC_CR_SWR_MASK;
-	RTC_CR &= ~RTC_CR_SWR_MASK;
-
-	// Reset CIR and TCR
-	RTC_TCR = 0;
-
-	// Enable 32.768 kHz crystal oscillator
-	RTC_CR |= RTC_CR_OSCE_MASK;
-
-	// Wait for the oscillator to stabilize
-	Delay(0x600000);
-
-	// Disable the RTC module to configure it
-	RTC_SR &= ~RTC_SR_TCE_MASK;
-
-	// Set the time counter to a known value
-	RTC_TSR = 0x00000000;
-
-	// Set the alarm time
-	RTC_TAR = 0xFFFFFFFF;
-
-	// Time Alarm Interrupt Enable
-	RTC_IER |= RTC_IER_TAIE_MASK;
-
-	// Clear any pending RTC interrupts and enable the RTC interrupt
-	NVIC_ClearPendingIRQ(RTC_IRQn);
-	NVIC_EnableIRQ(RTC_IRQn);
-
-	// Enable the RTC again
-	RTC_SR |= RTC_SR_TCE_MASK;
-}
-
-/**
- * Gets and validates user input for time settings.
- *
- * @param year Pointer to store year.
- * @param month Pointer to store month.
- * @param day Pointer to store day.
- * @param hour Pointer to store hour.
- * @param min Pointer to store minute.
- * @param sec Pointer to store second.
- * @return True if input is valid, False otherwise.
- */
-bool getUserTimeInput(int *year, int *month, int *day, int *hour, int *min,
-		int *sec) {
-	char buffer[100];
-	UARTSendStr(
-			"\033[1;37m\nZadejte datum a čas (YYYY-MM-DD HH:MM:SS): \033[0m");
-	UARTReceiveStr(buffer, sizeof(buffer));
-
-	// Parse the input string and check for successful conversion
-	if (sscanf(buffer, "%d-%d-%d %d:%d:%d", year, month, day, hour, min, sec)
-			== 6) {
-		// Validate the input values (basic validation)
-		if (*year > 1900 && *month >= 1 && *month <= 12 && *day >= 1
-				&& *day <= 31 && *hour >= 0 && *hour < 24 && *min >= 0
-				&& *min < 60 && *sec >= 0 && *sec < 60) {
-			return true;
-		} else {
-			UARTSendStr(
-					"\033[1;31m\nNeplatný vstup, zadejte datum a čas v správném formátu.\n\033[0m");
-			return false;
-		}
-	} else {
-		UARTSendStr(
-				"\033[1;31m\nChybný formát vstupu, zkuste to znovu.\n\033[0m");
-		return false;
-	}
-}
-
-/**
- * Sets the current time in the RTC.
- */
-void setClock() {
-	int year, month, day, hour, minute, second;
-	bool timeSet = false; // Flag to check if time was set
-
-	// Get the current time from the user.
-	if (getUserTimeInput(&year, &month, &day, &hour, &minute, &second)) {
-		// Convert the user input time to a format suitable for the RTC
-		struct tm timeStruct;
-		timeStruct.tm_year = year - 1900; // tm_year is the number of years since 1900
-		timeStruct.tm_mon = month - 1;    // tm_mon is 0-based (0 for January)
-		timeStruct.tm_mday = day;
-		timeStruct.tm_hour = hour;
-		timeStruct.tm_min = minute;
-		timeStruct.tm_sec = second;
-
-		// Convert to time_t (UNIX timestamp)
-		time_t time = mktime(&timeStruct);
-
-		// Disable the RTC before setting the time
-		RTC_SR &= ~RTC_SR_TCE_MASK;
-
-		// Set the time in the RTC
-		RTC_TSR = (uint32_t) time;
-
-		// Re-enable the RTC
-		RTC_SR |= RTC_SR_TCE_MASK;
-		timeSet = true; // Set the flag as true since time was set
-	}
-
-	if (timeSet) {
-		UARTSendStr("\033[1;32m\nČas byl nastaven.\n\033[0m");
-	} else {
-		UARTSendStr("\033[1;31m\nČas nebyl nastaven.\n\033[0m");
-	}
-}
-/**
- * Sets the alarm time.
- */
-void setAlarm() {
-	int year, month, day, hour, minute, second;
-	bool alarmSet = false; // Flag to check if alarm was set
-
-	// Get the alarm time from the user
-	if (getUserTimeInput(&year, &month, &day, &hour, &minute, &second)) {
-		struct tm alarmTime;
-		alarmTime.tm_year = year - 1900;
-		alarmTime.tm_mon = month - 1;
-		alarmTime.tm_mday = day;
-		alarmTime.tm_hour = hour;
-		alarmTime.tm_min = minute;
-		alarmTime.tm_sec = second;
-		alarmTime.tm_isdst = -1;
-
-		// Store the alarm time in global variable
-		globalAlarmTime = mktime(&alarmTime);
-
-		// Set the alarm in RTC
-		RTC_SR &= ~RTC_SR_TCE_MASK;
-		RTC_TAR = (uint32_t) globalAlarmTime;
-		RTC_SR |= RTC_SR_TCE_MASK;
-
-		alarmSet = true; // Set the flag as true since alarm was set
-	}
-
-	if (alarmSet) {
-		UARTSendStr("\033[1;32m\nAlarm byl nastaven.\n\033[0m");
-	} else {
-		UARTSendStr("\033[1;31m\nAlarm nebyl nastaven.\n\033[0m");
-	}
-}
-/**
- * Handles the alarm based on the set parameters.
- */
-void handleAlarm() {
-	// Initialize the melody and light effect
-	startMelody(selectedMelodyID); // Function to initialize the melody
-	startLightEffect(selectedLightEffectID); // Function to initialize the light effect
-	isPlayingMelody = true;
-	isShowingLights = true;
-}
-/**
- * Checks and processes user input received through UART.
- */
-void checkUserInput() {
-	char receivedChar;
-
-	switch (interfaceState) {
-	case IDLE:
-		// Check if there's data available
-		if (UART5_S1 & UART_S1_RDRF_MASK) {
-			interfaceState = READING_INPUT;
-			inputIndex = 0;
-		}
-		break;
-
-	case READING_INPUT:
-		// Ensure there's data available before reading from UART
-		if (UART5_S1 & UART_S1_RDRF_MASK) {
-			receivedChar = UART5_D;
-			if (receivedChar != '\n' && receivedChar != '\r'
-					&& inputIndex < sizeof(inputBuffer) - 1) {
-				inputBuffer[inputIndex++] = receivedChar;
-			} else {
-				inputBuffer[inputIndex] = '\0'; // Null-terminate the string
-				interfaceState = PROCESSING_INPUT;
-			}
-		}
-		break;
-
-	case PROCESSING_INPUT:
-		// Process the received input
-		processUserInput(inputBuffer);
-		interfaceState = IDLE;
-		break;
-	}
-}
-/**
- * Processes user input and executes corresponding actions.
- *
- * @param input User input string.
- */
-void processUserInput(char* input) {
-	int choice = atoi(input); // Convert input to integer
-
-	switch (choice) {
-	case 1:
-		setClock();
-		displayMenu();
-		break;
-	case 2:
-		setAlarm();
-		displayMenu();
-		break;
-	case 3: {
-		char buffer[100];  // Buffer to hold the input string
-		UARTSendStr("\033[32m\n1 - zapnout\033[0m\n");
-		UARTSendStr("\033[31m0 - vypnout\033[0m\n");
-		UARTReceiveStr(buffer, sizeof(buffer));
-		// Extracting the enable/disable value from the input
-		int enable;
-		if (sscanf(buffer, "%d", &enable) == 1) {
-			// If successfully extracted, toggle the alarm
-			toggleAlarm(enable);
-		} else {
-			UARTSendStr(
-					"\033[1;31m\nChybný formát vstupu pro zapnutí/vypnutí alarmu.\n\033[0m");
-		}
-		displayMenu();
-		break;
-	}
-
-	case 4:
-		chooseMelody();
-		displayMenu();
-		break;
-	case 5:
-		chooseLightEffect();
-		displayMenu();
-		break;
-	case 6:
-		setAlarmRepeat();
-		displayMenu();
-		break;
-	case 7:
-		displayAlarmStatus();
-		displayMenu();
-		break;
-	default:
-		displayMenu();
-		break;
-	}
-}
-/**
- * Displays the main menu to the user through UART.
- */
-void displayMenu() {
-
-	UARTSendStr("\033[30;47m\nDigitální Hodiny s Budíkem\033[0m\n");
-
-	// Menu Choices in Bold with Different Colors
-	UARTSendStr(
-			"\033[1;31m1. Nastavit Čas\033[0m - Nastavte aktuální čas hodin.\n");
-	UARTSendStr(
-			"\033[1;32m2. Nastavit Alarm\033[0m - Nastavte čas, kdy má alarm zazvonit.\n");
-	UARTSendStr(
-			"\033[1;33m3. Zapnout/Vypnout Alarm\033[0m - Zapněte nebo vypněte alarm.\n");
-	UARTSendStr(
-			"\033[1;34m4. Vybrat Melodii\033[0m - Vyberte melodii pro alarm.\n");
-	UARTSendStr(
-			"\033[1;35m5. Vybrat Světelný Efekt\033[0m - Vyberte světelný efekt pro alarm.\n");
-	UARTSendStr(
-			"\033[1;36m6. Nastavit Opakování Alarmu\033[0m - Nastavte opakování a interval alarmu.\n");
-	UARTSendStr(
-			"\033[1;37m7. Zobrazit Informace o Budíku\033[0m - Zobrazte aktuální nastavení alarmu.\n");
-
-	UARTSendStr("\033[1;5;37mZadejte volbu: \033[0m");
-}
-/**
- * Main function
- */
-int main(void) {
-	MCUInit();
-	PortsInit();
-	UARTInit();
-	RTCInit();
-
-	UARTSendStr("\033[1;32mInicializace byla dokončena.\n\033[0m");
-
-	while (1) {
-		checkUserInput();
-	}
-	return 0;
-}
+/*
+ * Author: Vladimir Azarov
+ * Filename: main.c
+ * Description: This program is designed to run on a microcontroller with specific hardware features.
+ * It implements a digital clock with an alarm system, allowing the user to set the time, alarm time, melody, and light effects.
+ * It handles user input through UART and controls LEDs and a speaker for alarm notifications.
+ */
+
+#include "board.h"
+#include "irq.h"
+#include "timer.h"
+#include "tone.h"
+#include "synth.h"
+#include "leds.h"
+#include "uart.h"
+#include "power.h"
+#include "alarms.h"
+#include "civil.h"
+#include "fmt.h"
+#include "patterns.h"
+#include "sequencer.h"
+#include "buttons.h"
+#include "console.h"
+#include "command.h"
+#include "proto.h"
+#include "storage.h"
+#include "rtc.h"
+#include "clock.h"
+#include "profile.h"
+#include "work.h"
+#include "eventlog.h"
+#include "screen.h"
+#include "text.h"
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+
+#define BEEP_FREQUENCY 2000 // Hz, feedback of a button press
+#define BEEP_MS        25
+#define BEEP_VOLUME    96   // Quieter than a ring, which it plays over
+
+// Types of the records in the flash log
+#define RECORD_SETTINGS      1 // struct Settings
+#define RECORD_ALARM         2 // struct StoredAlarm
+#define RECORD_ALARM_REMOVED 3 // uint8_t alarm ID
+#define RECORD_EVENT         4 // struct Event mirrored from the event log
+
+#define EVENT_SNAPSHOT_COUNT 16 // Newest events copied into every snapshot of the flash log
+#define EVENT_REPLY_COUNT    5  // Events in one reply to PROTO_OP_FETCH_LOG
+#define SYNC_SKIP_SECONDS    60 // Alarms a sync step jumps over by more are skipped, not rung
+
+// Settings kept in the flash log
+struct Settings {
+	uint16_t interval;   // alarmIntervalSeconds
+	uint8_t melody;      // selectedMelodyID
+	uint8_t lightEffect; // selectedLightEffectID
+	uint8_t repeatCount; // alarmRepeatCount
+	uint8_t enabled;     // alarmEnabled
+	uint16_t compensation; // clockCompensation
+	uint8_t eventMirror; // eventMirror
+	uint8_t backoff;     // alarmBackoff
+	uint8_t escalate;    // alarmEscalate
+};
+
+// Alarm of the table kept in the flash log
+struct StoredAlarm {
+	struct Alarm alarm;
+	uint8_t id;
+};
+
+// Variables for alarm, melody, and light control, used for newly added alarms
+int selectedMelodyID = 1;
+int selectedLightEffectID = 1;
+bool alarmEnabled = false;
+int alarmRepeatCount = 5;
+int alarmIntervalSeconds = 5;
+int alarmBackoff = ALARM_BACKOFF_FIXED; // enum AlarmBackoff of the repeats
+bool alarmEscalate = false; // Rings get louder and brighter with every repeat
+uint16_t clockCompensation = 0; // RTC_TCR drift compensation found by the calibration
+struct Settings savedSettings; // Settings as they are in the flash log
+bool quietMode = false; // Set by the quiet command, no menu and no echo for host scripts
+bool eventMirror = false; // Events are copied to the flash log as well
+uint32_t mirroredEvents = 0; // Sequence number of the first event not in the flash log
+struct ClockExchange syncExchange; // Last PROTO_OP_SYNC_TIME exchange, waiting for its T4
+bool syncOpen = false; // syncExchange holds T1 to T3 of an exchange
+
+// Names of the repeat policies in the status, in the order of enum AlarmBackoff
+const char *const backoffNames[] = {
+	TXT_BACKOFF_FIXED,
+	TXT_BACKOFF_LINEAR,
+	TXT_BACKOFF_EXP
+};
+
+// State of the console dialogs between their questions
+struct Alarm draftAlarm; // Alarm being added by setAlarm()
+int draftRepeatCount;    // Repeat count entered in setAlarmRepeat()
+int draftInterval;       // Interval entered in setAlarmRepeat()
+int draftBackoff;        // Backoff chosen in setAlarmRepeat()
+
+// Variables for time tracking
+bool alarmRinging = false; // Set while the melody and lights of an alarm are playing
+int ringingAlarmID = ALARM_NONE; // Alarm that rang last
+struct Alarm ringingAlarm; // Copy of that alarm as it was when it rang
+bool alarmPosted = false; // alarmDue() has been posted by programNextAlarm() and not run yet
+
+// Boot statistics
+enum RtcStart rtcStart = RTC_COLD_START; // How RTCInit() found the RTC
+uint32_t rtcStartMicros = 0;  // Time spent in RTCInit()
+uint32_t bootMicros = 0;      // Time from PITInit() to the main loop
+
+// Function prototypes for various utility, initialization, and control functions
+void handleAlarmRepeats();
+void programNextAlarm();
+void skipMissedAlarms();
+void deleteAlarm();
+void deleteAlarmEntered(char *line);
+void formatRecurrence(const struct Alarm *alarm, struct Formatter *f);
+void chooseMelody();
+void melodyEntered(char *line);
+void chooseLightEffect();
+void lightEffectEntered(char *line);
+void setAlarmEnabled(bool enable);
+void toggleAlarm(int enable);
+void alarmSwitchEntered(char *line);
+void displayAlarmStatus();
+void formatBootTimes(struct Formatter *f);
+void displayBootTimes();
+void setAlarmRepeat();
+void repeatCountEntered(char *line);
+void repeatIntervalEntered(char *line);
+void backoffEntered(char *line);
+void escalateEntered(char *line);
+void formatBackoff(const struct Alarm *alarm, struct Formatter *f);
+void invalidChoice(int min, int max);
+void setClock();
+void clockEntered(char *line);
+void setAlarm();
+void alarmTimeEntered(char *line);
+void recurrenceEntered(char *line);
+void weekdaysEntered(char *line);
+void periodEntered(char *line);
+void finishAlarm();
+int commitAlarm(struct Alarm *alarm);
+uint8_t parseWeekdays(const char *text);
+bool parseUserTime(const char *line, struct CivilTime *time);
+void alarmDue(uint32_t second);
+void processUserInput(char *input);
+void timeCommand(struct CommandLine *line);
+void alarmCommand(struct CommandLine *line);
+void alarmAddCommand(struct CommandLine *line);
+void alarmListCommand();
+void quietCommand(struct CommandLine *line);
+void logCommand(struct CommandLine *line);
+void formatEvent(uint32_t sequence, const struct Event *event, struct Formatter *f);
+#ifdef PROFILE
+void profileCommand(struct CommandLine *line);
+#endif
+void rtcCommand(struct CommandLine *line);
+void calibrationDone(enum ClockCalibration result);
+bool deleteAlarmNumber(uint32_t number);
+bool parseCommandDate(const char *date, const char *clock, struct CivilTime *civil);
+bool parseCommandTime(struct CommandLine *line, int first, struct RtcTime *time);
+void formatRule(const struct Alarm *alarm, struct Formatter *f);
+uint8_t pingRequest(const uint8_t *payload, uint8_t length, uint8_t *reply,
+		uint8_t *replyLength);
+uint8_t setTimeRequest(const uint8_t *payload, uint8_t length, uint8_t *reply,
+		uint8_t *replyLength);
+uint8_t addAlarmRequest(const uint8_t *payload, uint8_t length, uint8_t *reply,
+		uint8_t *replyLength);
+uint8_t deleteAlarmRequest(const uint8_t *payload, uint8_t length, uint8_t *reply,
+		uint8_t *replyLength);
+uint8_t calibrateRequest(const uint8_t *payload, uint8_t length, uint8_t *reply,
+		uint8_t *replyLength);
+uint8_t syncTimeRequest(const uint8_t *payload, uint8_t length, uint8_t *reply,
+		uint8_t *replyLength);
+uint8_t syncApplyRequest(const uint8_t *payload, uint8_t length, uint8_t *reply,
+		uint8_t *replyLength);
+bool getTimestamp(const uint8_t *payload, struct RtcTime *time);
+void putTimestamp(uint8_t *reply, const struct RtcTime *time);
+void syncDone(enum ClockSync result, const struct ClockSample *applied);
+void updateSecondsHandler();
+uint8_t queryStatusRequest(const uint8_t *payload, uint8_t length, uint8_t *reply,
+		uint8_t *replyLength);
+uint8_t fetchLogRequest(const uint8_t *payload, uint8_t length, uint8_t *reply,
+		uint8_t *replyLength);
+void displayMenu();
+void updateScreen(uint32_t now);
+void clockTicked(uint32_t second);
+void screenCommand(struct CommandLine *line);
+void playbackFinished(uint32_t arg);
+void setRTCTime(uint32_t time, uint16_t millis);
+void snoozeAlarm();
+void dismissAlarm();
+void adjustClock(bool hours);
+void buttonPressed(uint32_t button);
+void inputReceived(uint32_t arg);
+void idleTask();
+struct Settings currentSettings();
+void replayRecord(uint8_t type, const uint8_t *data, uint8_t length);
+void writeSnapshot();
+void storeAlarm(int id);
+void mirrorEvents();
+void storageTask();
+int main(void);
+
+/**
+ * Programs the RTC alarm register for the earliest alarm of the table. An alarm
+ * that is already due is posted right away, the RTC interrupt posts the others.
+ */
+void programNextAlarm() {
+	int id = alarmNext();
+
+	if (!alarmEnabled || id == ALARM_NONE) {
+		rtcSetAlarm(0); // No alarm will match
+		return;
+	}
+
+	uint32_t time = alarmGet(id)->time;
+	if (time <= rtcSeconds()) {
+		if (!alarmPosted) {
+			alarmPosted = workPost(alarmDue, time);
+		}
+	} else {
+		rtcSetAlarm(time);
+	}
+}
+
+/**
+ * Drops the rings of all alarms that should have fired while the alarm was
+ * switched off, so enabling it does not ring for the past.
+ */
+void skipMissedAlarms() {
+	uint32_t now = rtcSeconds();
+	int id;
+
+	while ((id = alarmNext()) != ALARM_NONE && alarmGet(id)->time < now) {
+		struct Alarm *alarm = alarmGet(id);
+		uint32_t next = alarmNextOccurrence(alarm, now - 1);
+
+		eventLog(EVENT_ALARM_SKIPPED, id, alarm->repeatIndex, 0);
+		if (next != 0) {
+			// Jump straight to the first occurrence that is not in the past
+			alarm->baseTime = next;
+			alarm->repeatIndex = 0;
+			alarmReschedule(id, next);
+		} else {
+			alarmRemove(id);
+		}
+	}
+}
+
+/**
+ * Handles all alarms that are due: rings the last of them, schedules their repeats
+ * and programs the RTC for the next pending alarm.
+ */
+void handleAlarmRepeats() {
+	PROFILE_BEGIN();
+	uint32_t now = rtcSeconds();
+	int id;
+
+	while (alarmEnabled && (id = alarmNext()) != ALARM_NONE
+			&& alarmGet(id)->time <= now) {
+		struct Alarm *alarm = alarmGet(id);
+		int attempt = alarm->repeatIndex + 1;
+
+		// Ring the alarm, the sequencer plays it in the background
+		sequencerStart(alarm->melody, alarm->lightEffect, alarmIntensity(alarm));
+		PROFILE_ALARM_RUNG();
+		alarmRinging = true;
+		ringingAlarmID = id;
+		ringingAlarm = *alarm;
+		eventLog(EVENT_ALARM_RANG, id, alarm->repeatIndex, 0);
+
+		alarmAdvance(id);
+
+		// Print attempt ID and next alarm time with formatted text
+		char buffer[160];
+		struct Formatter f;
+		fmtInit(&f, buffer, sizeof(buffer));
+		fmtStr(&f, STYLE_RING "\n" TXT_RING_ALARM);
+		fmtInt(&f, id + 1);
+		fmtStr(&f, TXT_RING_ATTEMPT);
+		fmtInt(&f, attempt);
+		if (alarmGet(id) != NULL) {
+			fmtStr(&f, STYLE_RESET ", " STYLE_NEXT TXT_RING_NEXT);
+			fmtTime(&f, alarmGet(id)->time);
+		} else {
+			fmtStr(&f, STYLE_RESET ", " STYLE_NEXT TXT_RING_LAST);
+		}
+		fmtStr(&f, STYLE_RESET "\n");
+		UARTSendStr(buffer);
+	}
+
+	programNextAlarm();
+	PROFILE_END(PROFILE_ALARM_REPEATS);
+}
+/**
+ * Deferred work posted by the RTC interrupt or programNextAlarm() when an alarm is due.
+ * Rings the alarm, the melody and the light effect are then stepped by the time base.
+ *
+ * @param second Second the alarm was due at.
+ */
+void alarmDue(uint32_t second) {
+	(void) second; // handleAlarmRepeats() rings every alarm due by now
+	alarmPosted = false;
+	handleAlarmRepeats();
+	if (!alarmRinging) {
+		consoleRedraw();
+	}
+}
+
+/**
+ * Deferred work posted by the sequencer when the ring has been played to its end.
+ * Shows the current prompt again.
+ */
+void playbackFinished(uint32_t arg) {
+	(void) arg;
+	// A ring that was stopped and started again since the post is still playing
+	if (alarmRinging && !sequencerRunning()) {
+		alarmRinging = false;
+		eventLog(EVENT_RING_ENDED, ringingAlarmID, ringingAlarm.repeatIndex, 0);
+		consoleRedraw();
+	}
+}
+
+/**
+ * Sets the RTC time. Alarms the clock has jumped over are skipped rather than rung.
+ *
+ * @param time New time in seconds since 1970.
+ * @param millis Milliseconds of the new time, the alarms fire when the second starts.
+ */
+void setRTCTime(uint32_t time, uint16_t millis) {
+	struct RtcTime rtcTime = { time, rtcTicksFromMillis(millis) };
+
+	clockSet(&rtcTime);
+	eventLog(EVENT_TIME_SET, EVENT_NO_ALARM, 0, 0);
+	skipMissedAlarms();
+	programNextAlarm();
+}
+
+/**
+ * Silences the ringing alarm and rings it again after ALARM_SNOOZE_SECONDS, see
+ * alarmSnooze().
+ */
+void snoozeAlarm() {
+	sequencerStop();
+	alarmRinging = false;
+	eventLog(EVENT_ALARM_SNOOZED, ringingAlarmID, ringingAlarm.repeatIndex, 0);
+
+	if (alarmSnooze(ringingAlarmID, &ringingAlarm, rtcSeconds() + ALARM_SNOOZE_SECONDS)
+			!= ALARM_NONE) {
+		programNextAlarm();
+		UARTSendStr(NOTICE_LINE(TXT_SNOOZED));
+	} else {
+		UARTSendStr(ERROR_LINE(TXT_SNOOZE_FULL));
+	}
+}
+
+/**
+ * Silences the ringing alarm and cancels the repeats left of its current occurrence.
+ * A recurring alarm still rings at its next occurrence.
+ */
+void dismissAlarm() {
+	struct Alarm *alarm = alarmGet(ringingAlarmID);
+
+	sequencerStop();
+	alarmRinging = false;
+	eventLog(EVENT_ALARM_DISMISSED, ringingAlarmID, ringingAlarm.repeatIndex, 0);
+
+	// The alarm may have been removed or already moved on to its next occurrence
+	if (alarm != NULL && alarm->baseTime == ringingAlarm.baseTime) {
+		alarm->repeatIndex = alarm->repeatCount;
+		alarmAdvance(ringingAlarmID);
+		programNextAlarm();
+	}
+	ringingAlarmID = ALARM_NONE;
+
+	UARTSendStr(OK_LINE(TXT_DISMISSED));
+}
+
+/**
+ * Moves the clock by one hour or one minute. The value wraps around within the day or
+ * the hour like on a wall clock, setting the minutes also zeroes the seconds.
+ *
+ * @param hours True to advance the hours, false to advance the minutes.
+ */
+void adjustClock(bool hours) {
+	char buffer[60];
+	struct Formatter f;
+	struct RtcTime rtcTime;
+	rtcRead(&rtcTime);
+	uint32_t now = rtcTime.seconds;
+	uint32_t midnight = now - now % SECONDS_PER_DAY;
+	uint32_t secondOfDay = now % SECONDS_PER_DAY;
+
+	if (hours) {
+		secondOfDay = (secondOfDay + 3600) % SECONDS_PER_DAY;
+	} else {
+		uint32_t minute = secondOfDay / 60 % 60;
+		secondOfDay = secondOfDay - secondOfDay % 3600 + (minute + 1) % 60 * 60;
+	}
+	setRTCTime(midnight + secondOfDay, rtcMillisFromTicks(rtcTime.ticks));
+
+	fmtInit(&f, buffer, sizeof(buffer));
+	fmtStr(&f, STYLE_PROMPT "\n" TXT_CLOCK);
+	fmtTime(&f, midnight + secondOfDay);
+	fmtStr(&f, "\n" STYLE_RESET);
+	UARTSendStr(buffer);
+}
+
+/**
+ * Deferred work posted by the buttons for every press. While an alarm is ringing SW2
+ * snoozes and SW3 dismisses it, SW4 and SW5 advance the hours and the minutes of the
+ * clock and SW6 switches the alarms on and off. Every press beeps, over a ringing
+ * alarm as well.
+ *
+ * @param button The enum Button pressed.
+ */
+void buttonPressed(uint32_t button) {
+	synthPlay(SYNTH_VOICE_BEEP, BEEP_FREQUENCY, BEEP_MS, BEEP_VOLUME);
+
+	switch (button) {
+	case BUTTON_SW2:
+		if (alarmRinging) {
+			snoozeAlarm();
+			consoleRedraw();
+		}
+		break;
+	case BUTTON_SW3:
+		if (alarmRinging) {
+			dismissAlarm();
+			consoleRedraw();
+		}
+		break;
+	case BUTTON_SW4:
+		adjustClock(true);
+		consoleRedraw();
+		break;
+	case BUTTON_SW5:
+		adjustClock(false);
+		consoleRedraw();
+		break;
+	case BUTTON_SW6:
+		toggleAlarm(!alarmEnabled);
+		consoleRedraw();
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * Deferred work posted by the UART when bytes have been received. The console handles
+ * at most one line at a time, for the rest the work is posted again so the other work
+ * gets its turn between the lines.
+ */
+void inputReceived(uint32_t arg) {
+	(void) arg;
+	consoleTask();
+	if (UARTRxAvailable()) {
+		workPost(inputReceived, 0);
+	}
+}
+
+/**
+ * Allows the user to choose a melody for the alarm.
+ */
+void chooseMelody() {
+	consolePrompt(PROMPT_LINE(TXT_ASK_MELODY), melodyEntered);
+}
+
+/**
+ * Handles the answer to chooseMelody().
+ *
+ * @param line The line entered by the user.
+ */
+void melodyEntered(char *line) {
+	uint32_t melodyChoice;
+
+	if (parseUint(line, MELODY_COUNT, &melodyChoice) == PARSE_OK && melodyChoice >= 1) {
+		selectedMelodyID = melodyChoice;
+		UARTSendStr(OK_LINE(TXT_MELODY_CHOSEN));
+	} else {
+		invalidChoice(1, MELODY_COUNT);
+	}
+}
+
+/**
+ * Allows the user to choose a light effect for the alarm.
+ */
+void chooseLightEffect() {
+	consolePrompt(PROMPT_LINE(TXT_ASK_LIGHT), lightEffectEntered);
+}
+
+/**
+ * Handles the answer to chooseLightEffect().
+ *
+ * @param line The line entered by the user.
+ */
+void lightEffectEntered(char *line) {
+	uint32_t lightEffectChoice;
+
+	if (parseUint(line, LIGHT_EFFECT_COUNT, &lightEffectChoice) == PARSE_OK
+			&& lightEffectChoice >= 1) {
+		selectedLightEffectID = lightEffectChoice;
+		UARTSendStr(OK_LINE(TXT_LIGHT_CHOSEN));
+	} else {
+		invalidChoice(1, LIGHT_EFFECT_COUNT);
+	}
+}
+
+/**
+ * Tells the user that the answer to a question with numbered choices is not one of
+ * them.
+ *
+ * @param min Lowest valid choice.
+ * @param max Highest valid choice.
+ */
+void invalidChoice(int min, int max) {
+	char buffer[80];
+	struct Formatter f;
+
+	fmtInit(&f, buffer, sizeof(buffer));
+	fmtStr(&f, STYLE_ERROR "\n" TXT_INVALID_CHOICE);
+	fmtInt(&f, min);
+	fmtStr(&f, TXT_CHOICE_AND);
+	fmtInt(&f, max);
+	fmtStr(&f, ".\n" STYLE_RESET);
+	UARTSendStr(buffer);
+}
+/**
+ * Switches the alarms on or off. Rings missed while the alarms were off are skipped.
+ *
+ * @param enable True to switch the alarms on.
+ */
+void setAlarmEnabled(bool enable) {
+	alarmEnabled = enable;
+	eventLog(enable ? EVENT_ALARMS_ON : EVENT_ALARMS_OFF, EVENT_NO_ALARM, 0, 0);
+	if (enable) {
+		skipMissedAlarms();
+	}
+	programNextAlarm();
+}
+
+/**
+ * Toggles the alarm state between enabled and disabled based on the input.
+ *
+ * @param enable If 1, the alarm is enabled; if 0, the alarm is disabled.
+ */
+void toggleAlarm(int enable) {
+	if (enable == 1) {
+		setAlarmEnabled(true);
+		UARTSendStr(OK_LINE(TXT_ALARMS_ON));
+	} else if (enable == 0) {
+		setAlarmEnabled(false);
+		UARTSendStr(OK_LINE(TXT_ALARMS_OFF));
+	} else {
+		invalidChoice(0, 1);
+	}
+}
+
+/**
+ * Handles the answer to the question whether the alarm should be on or off.
+ *
+ * @param line The line entered by the user.
+ */
+void alarmSwitchEntered(char *line) {
+	uint32_t enable;
+
+	// Extracting the enable/disable value from the input
+	if (parseUint(line, 9, &enable) == PARSE_OK) {
+		// If successfully extracted, toggle the alarm
+		toggleAlarm(enable);
+	} else {
+		invalidChoice(0, 1);
+	}
+}
+
+/**
+ * Describes how the last boot went.
+ *
+ * @param f Where the text is appended.
+ */
+void formatBootTimes(struct Formatter *f) {
+	fmtStr(f, rtcStart == RTC_WARM_START ? TXT_WARM_START : TXT_COLD_START);
+	fmtStr(f, TXT_BOOT_RTC);
+	fmtFixed(f, rtcStartMicros / 100, 10);
+	fmtStr(f, TXT_BOOT_TOTAL);
+	fmtFixed(f, bootMicros / 100, 10);
+	fmtStr(f, " ms");
+	if (rtcStart == RTC_NO_OSCILLATOR) {
+		fmtStr(f, TXT_NO_OSCILLATOR);
+	}
+}
+
+/**
+ * Prints how the last boot went.
+ */
+void displayBootTimes() {
+	char buffer[100];
+	struct Formatter f;
+
+	fmtInit(&f, buffer, sizeof(buffer));
+	fmtStr(&f, STYLE_INFO TXT_BOOT);
+	formatBootTimes(&f);
+	fmtStr(&f, "\n" STYLE_RESET);
+	UARTSendStr(buffer);
+}
+
+/**
+ * Displays the current status of the alarm including time, melody, and light effect settings.
+ */
+void displayAlarmStatus() {
+	char buffer[768];
+	char currentTimeStr[CIVIL_TIME_LENGTH + 1];
+
+	uint32_t activePermille = powerActivePermille();
+	uint32_t averageCurrentUa = powerAverageCurrentUa();
+
+	// Convert the current time from RTC to a readable format
+	civilFormat(rtcSeconds(), currentTimeStr);
+
+	// Create the status message with the current time, the defaults for new alarms and the statistics
+	UARTSendConst(STYLE_TITLE "\r\n" TXT_STATUS_TITLE STYLE_RESET "\r\n");
+	struct Formatter f;
+	fmtInit(&f, buffer, sizeof(buffer));
+	fmtStr(&f, ANSI("1;32") TXT_STATUS_ALARM);  // Bold green for TXT_STATUS_ALARM
+	fmtStr(&f, alarmEnabled ? ANSI("1;32") TXT_ENABLED STYLE_RESET
+			: ANSI("1;31") TXT_DISABLED STYLE_RESET); // Green for TXT_ENABLED, red for TXT_DISABLED
+	fmtStr(&f, "\n" STYLE_RESET ANSI("0;33") TXT_STATUS_TIME); // Yellow for TXT_STATUS_TIME
+	fmtStr(&f, currentTimeStr);
+	fmtStr(&f, "\n" STYLE_RESET ANSI("0;35") TXT_STATUS_MELODY); // Magenta for TXT_STATUS_MELODY
+	fmtInt(&f, selectedMelodyID);
+	fmtStr(&f, "\n" STYLE_RESET ANSI("0;35") TXT_STATUS_LIGHT); // Magenta for TXT_STATUS_LIGHT
+	fmtInt(&f, selectedLightEffectID);
+	fmtStr(&f, "\n" STYLE_RESET ANSI("0;33") TXT_STATUS_REPEATS); // Yellow for the repeats
+	fmtInt(&f, alarmRepeatCount);
+	fmtStr(&f, "\n" STYLE_RESET ANSI("0;33") TXT_STATUS_INTERVAL);
+	fmtInt(&f, alarmIntervalSeconds);
+	fmtStr(&f, "\n" STYLE_RESET ANSI("0;33") TXT_STATUS_BACKOFF);
+	fmtStr(&f, backoffNames[alarmBackoff]);
+	fmtStr(&f, alarmEscalate ? TXT_ESCALATING : TXT_STEADY);
+	fmtStr(&f, "\n" STYLE_RESET STYLE_INFO TXT_STATUS_UART); // White for the UART counters
+	fmtUint(&f, UARTOverrunCount());
+	fmtStr(&f, TXT_STATUS_DROPPED);
+	fmtUint(&f, UARTDroppedCount());
+	fmtStr(&f, TXT_STATUS_LOST);
+	fmtUint(&f, workDroppedCount());
+	fmtStr(&f, "\n" STYLE_RESET STYLE_INFO TXT_STATUS_CPU); // White for the power statistics
+	fmtFixed(&f, activePermille, 10);
+	fmtStr(&f, TXT_STATUS_CURRENT);
+	fmtFixed(&f, averageCurrentUa / 100, 10);
+	fmtStr(&f, " mA\n" TXT_STATUS_RTC);
+	fmtInt(&f, clockCompensationPpb(clockCompensation));
+	fmtStr(&f, " ppb\n" TXT_STATUS_START);
+	formatBootTimes(&f);
+	fmtStr(&f, "\n" STYLE_RESET ANSI("0;36") TXT_STATUS_TABLE); // Cyan for the alarm table
+	fmtInt(&f, alarmCount());
+	fmtChar(&f, '/');
+	fmtInt(&f, ALARM_CAPACITY);
+	fmtStr(&f, "\n" STYLE_RESET);
+	UARTSendStr(buffer);
+
+	// One line for every alarm of the table
+	for (int i = 0; i < alarmCount(); i++) {
+		int id = alarmAt(i);
+		const struct Alarm *alarm = alarmGet(id);
+
+		fmtInit(&f, buffer, sizeof(buffer));
+		fmtStr(&f, ANSI("0;36") "  ");
+		fmtInt(&f, id + 1);
+		fmtStr(&f, ": ");
+		fmtTime(&f, alarm->time);
+		fmtStr(&f, " (");
+		formatRecurrence(alarm, &f);
+		fmtStr(&f, TXT_LIST_MELODY);
+		fmtInt(&f, alarm->melody);
+		fmtStr(&f, TXT_LIST_LIGHT);
+		fmtInt(&f, alarm->lightEffect);
+		fmtStr(&f, TXT_LIST_REPEATS);
+		fmtInt(&f, alarm->repeatIndex);
+		fmtChar(&f, '/');
+		fmtInt(&f, alarm->repeatCount);
+		fmtStr(&f, TXT_LIST_INTERVAL);
+		fmtInt(&f, alarm->interval);
+		fmtStr(&f, " s, ");
+		fmtStr(&f, backoffNames[alarm->backoff]);
+		if (alarm->escalate) {
+			fmtStr(&f, TXT_ESCALATING);
+		}
+		fmtStr(&f, "\n" STYLE_RESET);
+		UARTSendStr(buffer);
+	}
+}
+/**
+ * Allows the user to set the number of alarm repetitions and the interval between them.
+ */
+void setAlarmRepeat() {
+	consolePrompt(PROMPT_LINE(TXT_ASK_REPEATS), repeatCountEntered);
+}
+
+/**
+ * Handles the repeat count entered in setAlarmRepeat() and asks for the interval.
+ *
+ * @param line The line entered by the user.
+ */
+void repeatCountEntered(char *line) {
+	uint32_t repeatCount;
+
+	if (parseUint(line, UINT8_MAX, &repeatCount) == PARSE_OK) {
+		draftRepeatCount = repeatCount;
+
+		// Get the interval between repetitions
+		consolePrompt(PROMPT_LINE(TXT_ASK_INTERVAL), repeatIntervalEntered);
+	} else {
+		UARTSendStr(ERROR_LINE(TXT_BAD_REPEATS));
+	}
+}
+
+/**
+ * Handles the repeat interval entered in setAlarmRepeat() and asks how the gaps grow.
+ *
+ * @param line The line entered by the user.
+ */
+void repeatIntervalEntered(char *line) {
+	uint32_t intervalSeconds;
+
+	if (parseUint(line, UINT16_MAX, &intervalSeconds) == PARSE_OK
+			&& intervalSeconds > 0) {
+		draftInterval = intervalSeconds;
+		consolePrompt(PROMPT_LINE(TXT_ASK_BACKOFF), backoffEntered);
+	} else {
+		UARTSendStr(ERROR_LINE(TXT_BAD_INTERVAL));
+	}
+}
+
+/**
+ * Handles the backoff entered in setAlarmRepeat() and asks whether the rings escalate.
+ *
+ * @param line The line entered by the user.
+ */
+void backoffEntered(char *line) {
+	uint32_t backoff;
+
+	if (parseUint(line, ALARM_BACKOFF_EXPONENTIAL, &backoff) == PARSE_OK) {
+		draftBackoff = backoff;
+		consolePrompt(PROMPT_LINE(TXT_ASK_ESCALATE), escalateEntered);
+	} else {
+		invalidChoice(0, ALARM_BACKOFF_EXPONENTIAL);
+	}
+}
+
+/**
+ * Handles the last answer of setAlarmRepeat(). The settings change only when all
+ * answers are valid.
+ *
+ * @param line The line entered by the user.
+ */
+void escalateEntered(char *line) {
+	uint32_t escalate;
+
+	if (parseUint(line, 1, &escalate) == PARSE_OK) {
+		alarmRepeatCount = draftRepeatCount;
+		alarmIntervalSeconds = draftInterval;
+		alarmBackoff = draftBackoff;
+		alarmEscalate = escalate;
+		UARTSendStr(OK_LINE(TXT_REPEATS_SET));
+	} else {
+		invalidChoice(0, 1);
+	}
+}
+/**
+ * Parses and validates a date and time entered by the user, a format error is reported
+ * together with its position.
+ *
+ * @param line The line entered by the user.
+ * @param time Pointer to store the date and time.
+ * @return True if input is valid, False otherwise.
+ */
+bool parseUserTime(const char *line, struct CivilTime *time) {
+	// Parse and validate the input string, including the length of the month
+	int error = parseDateTime(line, time);
+	if (error == PARSE_OK) {
+		return true;
+	}
+
+	char message[100];
+	struct Formatter f;
+	fmtInit(&f, message, sizeof(message));
+	fmtStr(&f, STYLE_ERROR "\n" TXT_BAD_FORMAT_AT);
+	fmtInt(&f, error + 1);
+	fmtStr(&f, TXT_TRY_AGAIN "\n" STYLE_RESET);
+	UARTSendStr(message);
+	return false;
+}
+
+// Question asked by setClock() and setAlarm()
+const char timePrompt[] = PROMPT_LINE(TXT_ASK_DATE_TIME);
+
+/**
+ * Sets the current time in the RTC.
+ */
+void setClock() {
+	consolePrompt(timePrompt, clockEntered);
+}
+
+/**
+ * Handles the time entered in setClock().
+ *
+ * @param line The line entered by the user.
+ */
+void clockEntered(char *line) {
+	struct CivilTime civilTime;
+
+	if (parseUserTime(line, &civilTime)) {
+		// Convert the user input time to seconds since 1970 as counted by the RTC
+		setRTCTime(civilToEpoch(&civilTime), 0);
+		UARTSendStr(OK_LINE(TXT_TIME_SET));
+	} else {
+		UARTSendStr(ERROR_LINE(TXT_TIME_NOT_SET));
+	}
+}
+/**
+ * Adds a new alarm to the alarm table. The melody, light effect and repeat settings
+ * currently selected are used for it. The time and the recurrence rule are asked for
+ * first, the alarm is added by finishAlarm().
+ */
+void setAlarm() {
+	consolePrompt(timePrompt, alarmTimeEntered);
+}
+
+/**
+ * Handles the time of the new alarm and asks for its recurrence rule.
+ *
+ * @param line The line entered by the user.
+ */
+void alarmTimeEntered(char *line) {
+	struct CivilTime alarmTime;
+
+	if (!parseUserTime(line, &alarmTime)) {
+		UARTSendStr(ERROR_LINE(TXT_ALARM_NOT_SET));
+		return;
+	}
+
+	draftAlarm.time = civilToEpoch(&alarmTime);
+	draftAlarm.baseTime = draftAlarm.time;
+	draftAlarm.interval = alarmIntervalSeconds;
+	draftAlarm.repeatCount = alarmRepeatCount;
+	draftAlarm.repeatIndex = 0;
+	draftAlarm.melody = selectedMelodyID;
+	draftAlarm.lightEffect = selectedLightEffectID;
+	draftAlarm.recurrence = ALARM_ONCE;
+	draftAlarm.weekdays = 0;
+	draftAlarm.period = 0;
+	draftAlarm.backoff = alarmBackoff;
+	draftAlarm.escalate = alarmEscalate;
+
+	consolePrompt(PROMPT_LINE(TXT_ASK_RECURRENCE), recurrenceEntered);
+}
+
+/**
+ * Handles the recurrence rule of the new alarm, asking for the details of the rules
+ * that have any.
+ *
+ * @param line The line entered by the user.
+ */
+void recurrenceEntered(char *line) {
+	uint32_t choice = UINT32_MAX;
+	parseUint(line, 3, &choice);
+
+	switch (choice) {
+	case 0:
+		finishAlarm();
+		break;
+	case 1:
+		draftAlarm.recurrence = ALARM_DAILY;
+		finishAlarm();
+		break;
+	case 2:
+		consolePrompt(PROMPT_LINE(TXT_ASK_WEEKDAYS), weekdaysEntered);
+		break;
+	case 3:
+		consolePrompt(PROMPT_LINE(TXT_ASK_PERIOD), periodEntered);
+		break;
+	default:
+		invalidChoice(0, 3);
+		UARTSendStr(ERROR_LINE(TXT_ALARM_NOT_SET));
+		break;
+	}
+}
+
+/**
+ * Parses a list of weekdays given as digits, 1 is Monday and 7 Sunday.
+ *
+ * @param text The digits, e.g. "12345".
+ * @return ALARM_MONDAY..ALARM_SUNDAY bits, 0 if the text is empty or invalid.
+ */
+uint8_t parseWeekdays(const char *text) {
+	uint8_t weekdays = 0;
+
+	for (int i = 0; text[i] != '\0'; i++) {
+		if (text[i] < '1' || text[i] > '7') {
+			return 0;
+		}
+		weekdays |= 1 << (text[i] - '1');
+	}
+	return weekdays;
+}
+
+/**
+ * Handles the weekdays of a new alarm recurring on selected days.
+ *
+ * @param line The line entered by the user.
+ */
+void weekdaysEntered(char *line) {
+	draftAlarm.weekdays = parseWeekdays(line);
+
+	if (draftAlarm.weekdays != 0) {
+		draftAlarm.recurrence = ALARM_WEEKDAYS;
+		finishAlarm();
+	} else {
+		UARTSendStr(ERROR_LINE(TXT_BAD_WEEKDAYS));
+		UARTSendStr(ERROR_LINE(TXT_ALARM_NOT_SET));
+	}
+}
+
+/**
+ * Handles the period of a new alarm recurring every N minutes.
+ *
+ * @param line The line entered by the user.
+ */
+void periodEntered(char *line) {
+	uint32_t period;
+
+	if (parseUint(line, UINT16_MAX, &period) == PARSE_OK && period > 0) {
+		draftAlarm.recurrence = ALARM_EVERY;
+		draftAlarm.period = period;
+		finishAlarm();
+	} else {
+		UARTSendStr(ERROR_LINE(TXT_BAD_PERIOD));
+		UARTSendStr(ERROR_LINE(TXT_ALARM_NOT_SET));
+	}
+}
+
+/**
+ * Adds an alarm to the alarm table. A recurring alarm starts with its first occurrence
+ * that matches the rule and is not in the past.
+ *
+ * @param alarm The alarm, its time is adjusted to the first occurrence.
+ * @return ID of the alarm, ALARM_NONE if the table is full.
+ */
+int commitAlarm(struct Alarm *alarm) {
+	if (alarm->recurrence != ALARM_ONCE) {
+		uint32_t now = rtcSeconds();
+		uint32_t after = alarm->time > now + 1 ? alarm->time - 1 : now;
+		alarm->time = alarmNextOccurrence(alarm, after);
+		alarm->baseTime = alarm->time;
+	}
+
+	// Store the alarm in the table and reprogram the RTC if it is the earliest one
+	int id = alarmAdd(alarm);
+	if (id != ALARM_NONE) {
+		eventLog(EVENT_ALARM_ADDED, id, 0, 0);
+	}
+	programNextAlarm();
+	return id;
+}
+
+/**
+ * Removes an alarm given by the number the user sees.
+ *
+ * @param number Number of the alarm, 1 to ALARM_CAPACITY.
+ * @return True if the alarm was removed, false if there is no such alarm.
+ */
+bool deleteAlarmNumber(uint32_t number) {
+	if (number < 1 || !alarmRemove((int) number - 1)) {
+		return false;
+	}
+	eventLog(EVENT_ALARM_DELETED, (int) number - 1, 0, 0);
+	programNextAlarm();
+	return true;
+}
+
+/**
+ * Adds the alarm completed by the dialog of setAlarm() to the alarm table.
+ */
+void finishAlarm() {
+	int id = commitAlarm(&draftAlarm);
+
+	if (id != ALARM_NONE) {
+		char buffer[80];
+		struct Formatter f;
+		fmtInit(&f, buffer, sizeof(buffer));
+		fmtStr(&f, STYLE_OK "\n" TXT_RING_ALARM);
+		fmtInt(&f, id + 1);
+		fmtStr(&f, TXT_ALARM_SET "\n" STYLE_RESET);
+		UARTSendStr(buffer);
+	} else if (alarmCount() >= ALARM_CAPACITY) {
+		UARTSendStr(ERROR_LINE(TXT_TABLE_FULL));
+	} else {
+		UARTSendStr(ERROR_LINE(TXT_ALARM_NOT_SET));
+	}
+}
+
+/**
+ * Describes the recurrence rule of an alarm in words.
+ *
+ * @param alarm The alarm.
+ * @param f Where the text is appended.
+ */
+void formatRecurrence(const struct Alarm *alarm, struct Formatter *f) {
+	switch (alarm->recurrence) {
+	case ALARM_DAILY:
+		fmtStr(f, TXT_DAILY);
+		break;
+	case ALARM_WEEKDAYS:
+		fmtStr(f, TXT_WEEKDAYS);
+		for (int i = 0; i < 7; i++) {
+			if (alarm->weekdays & (1 << i)) {
+				fmtChar(f, '1' + i);
+			}
+		}
+		break;
+	case ALARM_EVERY:
+		fmtStr(f, TXT_EVERY);
+		fmtInt(f, alarm->period);
+		fmtStr(f, TXT_MINUTES);
+		break;
+	default:
+		fmtStr(f, TXT_ONCE);
+		break;
+	}
+}
+
+/**
+ * Removes an alarm selected by the user from the alarm table.
+ */
+void deleteAlarm() {
+	consolePrompt(PROMPT_LINE(TXT_ASK_DELETE), deleteAlarmEntered);
+}
+
+/**
+ * Handles the number of the alarm to be removed.
+ *
+ * @param line The line entered by the user.
+ */
+void deleteAlarmEntered(char *line) {
+	uint32_t number;
+
+	if (parseUint(line, ALARM_CAPACITY, &number) == PARSE_OK && deleteAlarmNumber(number)) {
+		UARTSendStr(OK_LINE(TXT_DELETED));
+	} else {
+		UARTSendStr(ERROR_LINE(TXT_NO_SUCH_ALARM));
+	}
+}
+// One-line commands accepted instead of a menu choice
+const struct Command commands[] = {
+	{ "time", timeCommand },
+	{ "alarm", alarmCommand },
+	{ "quiet", quietCommand },
+	{ "screen", screenCommand },
+	{ "log", logCommand },
+	{ "rtc", rtcCommand },
+#ifdef PROFILE
+	{ "prof", profileCommand }
+#endif
+};
+
+/**
+ * Processes a menu choice or a one-line command entered by the user and starts the
+ * corresponding action. Actions that need more input ask for it through the console,
+ * the menu is shown again when they are done.
+ *
+ * @param input User input string.
+ */
+void processUserInput(char *input) {
+	if (commandIsCommand(input)) {
+		commandExecute(commands, sizeof(commands) / sizeof(commands[0]), input);
+		return;
+	}
+
+	uint32_t choice = 0; // Anything that is not a number shows the prompt again
+	parseUint(input, 99, &choice);
+
+	switch (choice) {
+	case 1:
+		setClock();
+		break;
+	case 2:
+		setAlarm();
+		break;
+	case 3:
+		consolePrompt(ANSI("32") "\n" TXT_SWITCH_ON STYLE_RESET "\n"
+				ANSI("31") TXT_SWITCH_OFF STYLE_RESET "\n",
+				alarmSwitchEntered);
+		break;
+	case 4:
+		chooseMelody();
+		break;
+	case 5:
+		chooseLightEffect();
+		break;
+	case 6:
+		setAlarmRepeat();
+		break;
+	case 7:
+		displayAlarmStatus();
+		break;
+	case 8:
+		deleteAlarm();
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * Command "time" prints the current time with milliseconds, "time YYYY-MM-DD
+ * HH:MM:SS[.mmm]" sets it.
+ *
+ * @param line The command.
+ */
+void timeCommand(struct CommandLine *line) {
+	char text[CIVIL_TIME_LENGTH + 5];
+	struct RtcTime time;
+
+	if (line->count == 1) {
+		struct Formatter f;
+		rtcRead(&time);
+		fmtInit(&f, text, sizeof(text));
+		fmtTime(&f, time.seconds);
+		fmtChar(&f, '.');
+		fmtUintPad(&f, rtcMillisFromTicks(time.ticks), 3);
+		commandOk(text);
+		return;
+	}
+
+	if (!parseCommandTime(line, 1, &time)) {
+		commandError(TXT_EXPECTED "time YYYY-MM-DD HH:MM:SS[.mmm]");
+		return;
+	}
+
+	setRTCTime(time.seconds, rtcMillisFromTicks(time.ticks));
+	commandOk(NULL);
+}
+
+/**
+ * Parses the date and the time of day of a command, "YYYY-MM-DD" and "HH:MM:SS". Words
+ * too long to be joined without cutting them are rejected, not parsed by their prefix.
+ *
+ * @param date Word with the date.
+ * @param clock Word with the time of day.
+ * @param civil Pointer to store the date and time.
+ * @return True if the words are a valid date and time, false otherwise.
+ */
+bool parseCommandDate(const char *date, const char *clock, struct CivilTime *civil) {
+	char text[CIVIL_TIME_LENGTH + 1];
+	struct Formatter f;
+
+	if (strlen(date) + 1 + strlen(clock) > CIVIL_TIME_LENGTH) {
+		return false;
+	}
+	fmtInit(&f, text, sizeof(text));
+	fmtStr(&f, date);
+	fmtChar(&f, ' ');
+	fmtStr(&f, clock);
+	return parseDateTime(text, civil) == PARSE_OK;
+}
+
+/**
+ * Parses a date and time given as two words of a command. The seconds may be followed
+ * by up to three decimals.
+ *
+ * @param line The command.
+ * @param first Index of the word with the date.
+ * @param time Pointer to store the time.
+ * @return True if the command ends with a valid date and time, false otherwise.
+ */
+bool parseCommandTime(struct CommandLine *line, int first, struct RtcTime *time) {
+	struct CivilTime civil;
+	uint32_t millis = 0;
+	int digits = 0;
+
+	if (line->count != first + 2) {
+		return false;
+	}
+
+	// Split the decimals off the seconds
+	char *fraction = line->words[first + 1];
+	while (*fraction != '\0' && *fraction != '.') {
+		fraction++;
+	}
+	if (*fraction == '.') {
+		*fraction++ = '\0';
+		for (; *fraction != '\0'; fraction++, digits++) {
+			if (*fraction < '0' || *fraction > '9' || digits == 3) {
+				return false;
+			}
+			millis = millis * 10 + (uint32_t) (*fraction - '0');
+		}
+		if (digits == 0) {
+			return false;
+		}
+		for (; digits < 3; digits++) {
+			millis *= 10;
+		}
+	}
+
+	if (!parseCommandDate(line->words[first], line->words[first + 1], &civil)) {
+		return false;
+	}
+
+	time->seconds = civilToEpoch(&civil);
+	time->ticks = rtcTicksFromMillis((uint16_t) millis);
+	return true;
+}
+
+/**
+ * Command "alarm" with the subcommands add, del, list, on and off.
+ *
+ * @param line The command.
+ */
+void alarmCommand(struct CommandLine *line) {
+	const char *sub = line->count > 1 ? line->words[1] : "";
+	uint32_t number;
+
+	if (commandIs(sub, "add") && line->count >= 4) {
+		alarmAddCommand(line);
+	} else if (commandIs(sub, "del") && line->count == 3) {
+		if (parseUint(line->words[2], ALARM_CAPACITY, &number) == PARSE_OK
+				&& deleteAlarmNumber(number)) {
+			commandOk(NULL);
+		} else {
+			commandError(TXT_ERR_NO_ALARM);
+		}
+	} else if (commandIs(sub, "list") && line->count == 2) {
+		alarmListCommand();
+	} else if (commandIs(sub, "on") && line->count == 2) {
+		setAlarmEnabled(true);
+		commandOk(NULL);
+	} else if (commandIs(sub, "off") && line->count == 2) {
+		setAlarmEnabled(false);
+		commandOk(NULL);
+	} else {
+		commandError(TXT_EXPECTED "alarm add|del|list|on|off");
+	}
+}
+
+/**
+ * Command "alarm add YYYY-MM-DD HH:MM:SS [mel=N] [light=N] [rep=COUNT/SECONDS]
+ * [once|daily|days=DIGITS|every=MINUTES]". Settings that are not given are taken
+ * from the defaults for new alarms. Replies with the number of the new alarm.
+ *
+ * @param line The command.
+ */
+void alarmAddCommand(struct CommandLine *line) {
+	char text[CIVIL_TIME_LENGTH + 1];
+	struct CivilTime time;
+	struct Alarm alarm;
+	struct Formatter f;
+	uint32_t value;
+
+	if (!parseCommandDate(line->words[2], line->words[3], &time)) {
+		commandError(TXT_ERR_DATE_TIME);
+		return;
+	}
+
+	alarm.time = civilToEpoch(&time);
+	alarm.baseTime = alarm.time;
+	alarm.interval = alarmIntervalSeconds;
+	alarm.repeatCount = alarmRepeatCount;
+	alarm.repeatIndex = 0;
+	alarm.melody = selectedMelodyID;
+	alarm.lightEffect = selectedLightEffectID;
+	alarm.recurrence = ALARM_ONCE;
+	alarm.weekdays = 0;
+	alarm.period = 0;
+	alarm.backoff = alarmBackoff;
+	alarm.escalate = alarmEscalate;
+
+	for (int i = 4; i < line->count; i++) {
+		const char *word = line->words[i];
+		const char *v;
+
+		if ((v = commandValue(word, "mel")) != NULL) {
+			if (parseUint(v, MELODY_COUNT, &value) != PARSE_OK || value == 0) {
+				commandError(TXT_ERR_MELODY);
+				return;
+			}
+			alarm.melody = value;
+		} else if ((v = commandValue(word, "light")) != NULL) {
+			if (parseUint(v, LIGHT_EFFECT_COUNT, &value) != PARSE_OK || value == 0) {
+				commandError(TXT_ERR_LIGHT);
+				return;
+			}
+			alarm.lightEffect = value;
+		} else if ((v = commandValue(word, "rep")) != NULL) {
+			// COUNT/SECONDS, the slash is replaced so both halves can be parsed
+			char *slash = line->words[i] + (v - word);
+			while (*slash != '\0' && *slash != '/') {
+				slash++;
+			}
+			if (*slash == '\0') {
+				commandError(TXT_EXPECTED TXT_USAGE_REP);
+				return;
+			}
+			*slash = '\0';
+			if (parseUint(v, UINT8_MAX, &value) != PARSE_OK) {
+				commandError(TXT_ERR_REPEATS);
+				return;
+			}
+			alarm.repeatCount = value;
+			if (parseUint(slash + 1, UINT16_MAX, &value) != PARSE_OK || value == 0) {
+				commandError(TXT_ERR_INTERVAL);
+				return;
+			}
+			alarm.interval = value;
+		} else if ((v = commandValue(word, "backoff")) != NULL) {
+			if (commandIs(v, "fixed")) {
+				alarm.backoff = ALARM_BACKOFF_FIXED;
+			} else if (commandIs(v, "linear")) {
+				alarm.backoff = ALARM_BACKOFF_LINEAR;
+			} else if (commandIs(v, "exp")) {
+				alarm.backoff = ALARM_BACKOFF_EXPONENTIAL;
+			} else {
+				commandError(TXT_EXPECTED "backoff=fixed|linear|exp");
+				return;
+			}
+		} else if (commandIs(word, "escalate")) {
+			alarm.escalate = true;
+		} else if (commandIs(word, "steady")) {
+			alarm.escalate = false;
+		} else if (commandIs(word, "once")) {
+			alarm.recurrence = ALARM_ONCE;
+		} else if (commandIs(word, "daily")) {
+			alarm.recurrence = ALARM_DAILY;
+		} else if ((v = commandValue(word, "days")) != NULL) {
+			alarm.weekdays = parseWeekdays(v);
+			if (alarm.weekdays == 0) {
+				commandError(TXT_ERR_WEEKDAYS);
+				return;
+			}
+			alarm.recurrence = ALARM_WEEKDAYS;
+		} else if ((v = commandValue(word, "every")) != NULL) {
+			if (parseUint(v, UINT16_MAX, &value) != PARSE_OK || value == 0) {
+				commandError(TXT_ERR_PERIOD);
+				return;
+			}
+			alarm.recurrence = ALARM_EVERY;
+			alarm.period = value;
+		} else {
+			commandError(TXT_UNKNOWN_PARAMETER);
+			return;
+		}
+	}
+
+	int id = commitAlarm(&alarm);
+	if (id == ALARM_NONE) {
+		commandError(TXT_ERR_TABLE_FULL);
+		return;
+	}
+	fmtInit(&f, text, sizeof(text));
+	fmtInt(&f, id + 1);
+	commandOk(text);
+}
+
+/**
+ * Appends the recurrence rule of an alarm in the syntax of "alarm add".
+ *
+ * @param alarm The alarm.
+ * @param f Where the text is appended.
+ */
+void formatRule(const struct Alarm *alarm, struct Formatter *f) {
+	switch (alarm->recurrence) {
+	case ALARM_DAILY:
+		fmtStr(f, "daily");
+		break;
+	case ALARM_WEEKDAYS:
+		fmtStr(f, "days=");
+		for (int i = 0; i < 7; i++) {
+			if (alarm->weekdays & (1 << i)) {
+				fmtChar(f, '1' + i);
+			}
+		}
+		break;
+	case ALARM_EVERY:
+		fmtStr(f, "every=");
+		fmtInt(f, alarm->period);
+		break;
+	default:
+		fmtStr(f, "once");
+		break;
+	}
+}
+
+/**
+ * Appends the repeat policy of an alarm in the syntax of "alarm add".
+ *
+ * @param alarm The alarm.
+ * @param f Where the text is appended.
+ */
+void formatBackoff(const struct Alarm *alarm, struct Formatter *f) {
+	static const char *const words[] = { "fixed", "linear", "exp" };
+
+	fmtStr(f, "backoff=");
+	fmtStr(f, words[alarm->backoff]);
+	fmtStr(f, alarm->escalate ? " escalate" : " steady");
+}
+
+/**
+ * Command "alarm list" prints one line per alarm in the syntax of "alarm add",
+ * preceded by its number, and replies with the number of alarms.
+ */
+void alarmListCommand() {
+	char buffer[100];
+	struct Formatter f;
+
+	for (int i = 0; i < alarmCount(); i++) {
+		int id = alarmAt(i);
+		const struct Alarm *alarm = alarmGet(id);
+
+		fmtInit(&f, buffer, sizeof(buffer));
+		fmtInt(&f, id + 1);
+		fmtChar(&f, ' ');
+		fmtTime(&f, alarm->time);
+		fmtStr(&f, " mel=");
+		fmtInt(&f, alarm->melody);
+		fmtStr(&f, " light=");
+		fmtInt(&f, alarm->lightEffect);
+		fmtStr(&f, " rep=");
+		fmtInt(&f, alarm->repeatCount);
+		fmtChar(&f, '/');
+		fmtInt(&f, alarm->interval);
+		fmtChar(&f, ' ');
+		formatBackoff(alarm, &f);
+		fmtChar(&f, ' ');
+		formatRule(alarm, &f);
+		fmtChar(&f, '\n');
+		UARTSendStr(buffer);
+	}
+
+	fmtInit(&f, buffer, sizeof(buffer));
+	fmtInt(&f, alarmCount());
+	commandOk(buffer);
+}
+
+/**
+ * Command "quiet on|off". In quiet mode the menu is not shown and typed characters
+ * are not echoed, which suits scripts sending many commands in a row.
+ *
+ * @param line The command.
+ */
+void quietCommand(struct CommandLine *line) {
+	const char *mode = line->count == 2 ? line->words[1] : "";
+
+	if (commandIs(mode, "on")) {
+		quietMode = true;
+		screenInvalidate();
+	} else if (commandIs(mode, "off")) {
+		quietMode = false;
+	} else {
+		commandError(TXT_EXPECTED "quiet on|off");
+		return;
+	}
+	updateSecondsHandler();
+	consoleSetEcho(!quietMode);
+	commandOk(NULL);
+}
+
+/**
+ * Command "screen" draws the whole screen again with the next prompt, for a terminal
+ * that has been cleared or connected later.
+ *
+ * @param line The command.
+ */
+void screenCommand(struct CommandLine *line) {
+	(void) line;
+	screenInvalidate();
+	commandOk(NULL);
+}
+
+// Names of the events in the output of the log command, in the order of enum EventType
+static const char *const eventNames[EVENT_TYPE_COUNT] = {
+	"boot", "rang", "snoozed", "dismissed", "ended", "skipped", "added", "deleted",
+	"on", "off", "time", "cal", "sync"
+};
+
+/**
+ * Formats an event of the log as one line of the log command.
+ *
+ * @param sequence Sequence number of the event.
+ * @param event The event.
+ * @param f Formatter the line is appended to.
+ */
+void formatEvent(uint32_t sequence, const struct Event *event, struct Formatter *f) {
+	fmtUint(f, sequence);
+	fmtChar(f, ' ');
+	fmtTime(f, event->time);
+	fmtChar(f, ' ');
+	fmtStr(f, event->type < EVENT_TYPE_COUNT ? eventNames[event->type] : "?");
+	if (event->alarm != EVENT_NO_ALARM) {
+		fmtStr(f, " alarm=");
+		fmtUint(f, event->alarm + 1u);
+	}
+	if (event->type >= EVENT_ALARM_RANG && event->type <= EVENT_ALARM_SKIPPED) {
+		fmtStr(f, " rep=");
+		fmtUint(f, event->repeat);
+	}
+	if (event->detail != 0) {
+		fmtStr(f, " detail=");
+		fmtUint(f, event->detail);
+	}
+}
+
+/**
+ * Command "log" prints the event log from the oldest event, "log flash on|off" switches
+ * the copying of the events to the flash log, where they survive a reset.
+ *
+ * @param line The command.
+ */
+void logCommand(struct CommandLine *line) {
+	char buffer[80];
+	struct Formatter f;
+	struct Event event;
+
+	if (line->count == 3 && commandIs(line->words[1], "flash")) {
+		if (commandIs(line->words[2], "on")) {
+			eventMirror = true;
+		} else if (commandIs(line->words[2], "off")) {
+			eventMirror = false;
+		} else {
+			commandError(TXT_EXPECTED "log [flash on|off]");
+			return;
+		}
+		commandOk(NULL);
+		return;
+	}
+	if (line->count != 1) {
+		commandError(TXT_EXPECTED "log [flash on|off]");
+		return;
+	}
+
+	uint32_t next = eventLogNext();
+	for (uint32_t sequence = eventLogOldest(); sequence < next; sequence++) {
+		if (eventLogGet(sequence, &event)) {
+			fmtInit(&f, buffer, sizeof(buffer));
+			formatEvent(sequence, &event, &f);
+			fmtChar(&f, '\n');
+			UARTSendStr(buffer);
+		}
+	}
+
+	fmtInit(&f, buffer, sizeof(buffer));
+	fmtUint(&f, next - eventLogOldest());
+	fmtStr(&f, eventMirror ? " flash=on" : " flash=off");
+	commandOk(buffer);
+}
+
+/**
+ * Command "rtc" prints the drift compensation, "rtc cal YYYY-MM-DD HH:MM:SS.mmm" measures
+ * the drift against the exact time given by the host and corrects it. The first
+ * calibration after a reset only sets the time and starts the measurement, the next one
+ * at least CLOCK_CALIBRATION_MIN_SECONDS later programs the compensation.
+ *
+ * @param line The command.
+ */
+void rtcCommand(struct CommandLine *line) {
+	char text[60];
+	struct Formatter f;
+	struct RtcTime reference;
+	int32_t driftPpb = 0;
+
+	fmtInit(&f, text, sizeof(text));
+	if (line->count > 1) {
+		if (!commandIs(line->words[1], "cal") || !parseCommandTime(line, 2, &reference)) {
+			commandError(TXT_EXPECTED "rtc [cal YYYY-MM-DD HH:MM:SS.mmm]");
+			return;
+		}
+
+		enum ClockCalibration result = clockCalibrate(&reference, &driftPpb);
+		if (result != CLOCK_CAL_TOO_SHORT) {
+			calibrationDone(result);
+		}
+		switch (result) {
+		case CLOCK_CAL_STARTED:
+			commandOk(TXT_CAL_STARTED);
+			return;
+		case CLOCK_CAL_TOO_SHORT:
+			commandError(TXT_CAL_TOO_SHORT);
+			return;
+		case CLOCK_CAL_RANGE:
+			commandError(TXT_CAL_OUT_OF_RANGE);
+			return;
+		default:
+			fmtStr(&f, "drift=");
+			fmtInt(&f, driftPpb);
+			fmtStr(&f, " ");
+			break;
+		}
+	}
+
+	fmtStr(&f, "tcr=");
+	fmtInt(&f, (int8_t) (clockCompensation & 0xFF));
+	fmtStr(&f, " cir=");
+	fmtUint(&f, clockCompensation >> 8);
+	fmtStr(&f, " ppb=");
+	fmtInt(&f, clockCompensationPpb(clockCompensation));
+	if (clockSlewing()) {
+		fmtStr(&f, " slew=");
+		fmtInt(&f, (int32_t) (clockSlewLeft() * 1000 / RTC_PRESCALER_HZ));
+		fmtStr(&f, "ms");
+	}
+	commandOk(text);
+}
+
+/**
+ * Takes over the result of a calibration that has set the clock.
+ *
+ * @param result Result of clockCalibrate(), not CLOCK_CAL_TOO_SHORT.
+ */
+void calibrationDone(enum ClockCalibration result) {
+	clockCompensation = rtcGetCompensation();
+	eventLog(EVENT_CALIBRATED, EVENT_NO_ALARM, 0, (uint8_t) result);
+	skipMissedAlarms();
+	programNextAlarm();
+}
+
+/**
+ * Takes over a correction of the clock by a time sync. The alarm times are absolute, so
+ * only the RTC alarm is programmed again. Alarms a step has jumped over ring late unless
+ * the step was as large as setting the clock, then they are skipped like in setRTCTime().
+ *
+ * @param result Result of clockSyncApply(), not CLOCK_SYNC_NONE.
+ * @param applied The exchange applied.
+ */
+void syncDone(enum ClockSync result, const struct ClockSample *applied) {
+	eventLog(EVENT_TIME_SYNCED, EVENT_NO_ALARM, 0, (uint8_t) result);
+	if (result == CLOCK_SYNC_STEPPED
+			&& -applied->offset > (int64_t) SYNC_SKIP_SECONDS * RTC_PRESCALER_HZ) {
+		skipMissedAlarms();
+	}
+	programNextAlarm();
+	updateSecondsHandler();
+}
+
+#ifdef PROFILE
+/**
+ * Command "prof" prints the cycle statistics of the profiled points, the stack depth of
+ * the handlers and the stack high-water mark, "prof reset" clears the cycle statistics.
+ *
+ * @param line The command.
+ */
+void profileCommand(struct CommandLine *line) {
+	char buffer[100];
+	struct Formatter f;
+
+	if (line->count == 2 && commandIs(line->words[1], "reset")) {
+		profileReset();
+		commandOk(NULL);
+		return;
+	}
+	if (line->count != 1) {
+		commandError(TXT_EXPECTED "prof [reset]");
+		return;
+	}
+
+	// One line for every point, in core clock cycles
+	for (int i = 0; i < PROFILE_POINT_COUNT; i++) {
+		struct ProfileStats stats = profileGet(i);
+		fmtInit(&f, buffer, sizeof(buffer));
+		fmtStr(&f, profileName(i));
+		fmtStr(&f, ": n=");
+		fmtUint(&f, stats.count);
+		if (stats.count != 0) {
+			fmtStr(&f, " min=");
+			fmtUint(&f, stats.min);
+			fmtStr(&f, " avg=");
+			fmtUint(&f, (uint32_t) (stats.total / stats.count));
+			fmtStr(&f, " max=");
+			fmtUint(&f, stats.max);
+		}
+		fmtChar(&f, '\n');
+		UARTSendStr(buffer);
+	}
+
+	// Deepest use of the stack below every handler, in bytes
+	for (int i = 0; i < PROFILE_STACK_COUNT; i++) {
+		fmtInit(&f, buffer, sizeof(buffer));
+		fmtStr(&f, profileStackName(i));
+		fmtStr(&f, ": stack=");
+		fmtUint(&f, profileStackDepth(i));
+		fmtChar(&f, '\n');
+		UARTSendStr(buffer);
+	}
+
+	fmtInit(&f, buffer, sizeof(buffer));
+	fmtStr(&f, "stack=");
+	fmtUint(&f, profileStackUsed());
+	fmtChar(&f, '/');
+	fmtUint(&f, profileStackSize());
+	commandOk(buffer);
+}
+#endif
+// Requests of the binary protocol
+const struct ProtoOpcode opcodes[] = {
+	{ PROTO_OP_PING, pingRequest },
+	{ PROTO_OP_SET_TIME, setTimeRequest },
+	{ PROTO_OP_CALIBRATE, calibrateRequest },
+	{ PROTO_OP_SYNC_TIME, syncTimeRequest },
+	{ PROTO_OP_SYNC_APPLY, syncApplyRequest },
+	{ PROTO_OP_ADD_ALARM, addAlarmRequest },
+	{ PROTO_OP_DELETE_ALARM, deleteAlarmRequest },
+	{ PROTO_OP_QUERY_STATUS, queryStatusRequest },
+	{ PROTO_OP_FETCH_LOG, fetchLogRequest }
+};
+
+/**
+ * Binary request that only checks the link.
+ *
+ * @return PROTO_OK.
+ */
+uint8_t pingRequest(const uint8_t *payload, uint8_t length, uint8_t *reply,
+		uint8_t *replyLength) {
+	(void) payload;
+	(void) length;
+	(void) reply;
+	*replyLength = 0;
+	return PROTO_OK;
+}
+
+/**
+ * Binary request setting the RTC time.
+ *
+ * @param payload u32 time in seconds since 1970, optionally u16 milliseconds.
+ * @return Status of the request.
+ */
+uint8_t setTimeRequest(const uint8_t *payload, uint8_t length, uint8_t *reply,
+		uint8_t *replyLength) {
+	(void) reply;
+	if (length != 4 && length != 6) {
+		return PROTO_BAD_LENGTH;
+	}
+	uint16_t millis = length == 6 ? protoGet16(&payload[4]) : 0;
+	if (millis >= 1000) {
+		return PROTO_BAD_VALUE;
+	}
+	setRTCTime(protoGet32(payload), millis);
+	*replyLength = 0;
+	return PROTO_OK;
+}
+
+/**
+ * Binary request measuring the drift of the RTC and correcting it, see rtcCommand().
+ *
+ * @param payload u32 reference time in seconds since 1970, u16 milliseconds.
+ * @param reply u8 result (enum ClockCalibration), i32 drift in ppb, u16 RTC_TCR
+ * compensation.
+ * @return Status of the request.
+ */
+uint8_t calibrateRequest(const uint8_t *payload, uint8_t length, uint8_t *reply,
+		uint8_t *replyLength) {
+	if (length != 6) {
+		return PROTO_BAD_LENGTH;
+	}
+	uint16_t millis = protoGet16(&payload[4]);
+	if (millis >= 1000) {
+		return PROTO_BAD_VALUE;
+	}
+
+	struct RtcTime reference = { protoGet32(payload), rtcTicksFromMillis(millis) };
+	int32_t driftPpb;
+	enum ClockCalibration result = clockCalibrate(&reference, &driftPpb);
+	if (result != CLOCK_CAL_TOO_SHORT) {
+		calibrationDone(result);
+	}
+
+	reply[0] = (uint8_t) result;
+	protoPut32(&reply[1], (uint32_t) driftPpb);
+	protoPut16(&reply[5], clockCompensation);
+	*replyLength = 7;
+	return PROTO_OK;
+}
+
+/**
+ * Reads a time of the sync requests.
+ *
+ * @param payload u32 time in seconds since 1970, u16 milliseconds.
+ * @param time Pointer to store the time.
+ * @return False if the milliseconds are out of range.
+ */
+bool getTimestamp(const uint8_t *payload, struct RtcTime *time) {
+	uint16_t millis = protoGet16(&payload[4]);
+
+	time->seconds = protoGet32(payload);
+	time->ticks = rtcTicksFromMillis(millis);
+	return millis < 1000;
+}
+
+/**
+ * Writes a time in the layout read by getTimestamp().
+ */
+void putTimestamp(uint8_t *reply, const struct RtcTime *time) {
+	protoPut32(reply, time->seconds);
+	protoPut16(&reply[4], rtcMillisFromTicks(time->ticks));
+}
+
+/**
+ * Binary request of one NTP-style exchange of a time sync, see clock.c. The exchange is
+ * completed by the T4 sent with the next request, PROTO_OP_SYNC_APPLY completes the
+ * last one and corrects the clock.
+ *
+ * @param payload Host time T1 the request was sent, optionally the host time T4 the
+ * reply to the previous request was received, each u32 seconds and u16 milliseconds.
+ * @param reply RTC times T2 the request was received and T3 the reply was sent, u8
+ * number of exchanges taken.
+ * @return Status of the request.
+ */
+uint8_t syncTimeRequest(const uint8_t *payload, uint8_t length, uint8_t *reply,
+		uint8_t *replyLength) {
+	struct RtcTime received, sent, returned;
+
+	protoReceivedTime(&received); // Taken by the UART interrupt, not delayed by the queue
+	if (length != 6 && length != 12) {
+		return PROTO_BAD_LENGTH;
+	}
+	if (!getTimestamp(payload, &sent) || (length == 12 && !getTimestamp(&payload[6], &returned))) {
+		return PROTO_BAD_VALUE;
+	}
+
+	if (length == 12 && syncOpen) {
+		syncExchange.returned = returned;
+		clockSyncSample(&syncExchange);
+	}
+	syncExchange.sent = sent;
+	syncExchange.received = received;
+	syncOpen = true;
+
+	putTimestamp(reply, &received);
+	reply[12] = (uint8_t) clockSyncSamples();
+	*replyLength = 13;
+	rtcRead(&syncExchange.replied); // The reply is sent right after the return
+	putTimestamp(&reply[6], &syncExchange.replied);
+	return PROTO_OK;
+}
+
+/**
+ * Binary request ending a time sync. Completes the last exchange and corrects the clock
+ * by the exchange with the shortest round trip, a small offset is slewed and a large
+ * one stepped, see clockSyncApply().
+ *
+ * @param payload Host time T4 the reply to the last PROTO_OP_SYNC_TIME was received, u32
+ * seconds and u16 milliseconds.
+ * @param reply u8 result (enum ClockSync), i32 offset of the RTC corrected in us, u32
+ * round trip of the exchange applied in us.
+ * @return Status of the request.
+ */
+uint8_t syncApplyRequest(const uint8_t *payload, uint8_t length, uint8_t *reply,
+		uint8_t *replyLength) {
+	struct RtcTime returned;
+
+	if (length != 6) {
+		return PROTO_BAD_LENGTH;
+	}
+	if (!getTimestamp(payload, &returned)) {
+		return PROTO_BAD_VALUE;
+	}
+	if (syncOpen) {
+		syncExchange.returned = returned;
+		clockSyncSample(&syncExchange);
+		syncOpen = false;
+	}
+
+	struct ClockSample applied;
+	enum ClockSync result = clockSyncApply(&applied);
+	if (result != CLOCK_SYNC_NONE) {
+		syncDone(result, &applied);
+	}
+
+	int64_t offsetMicros = applied.offset * 1000000 / RTC_PRESCALER_HZ;
+	int64_t delayMicros = applied.delay * 1000000 / RTC_PRESCALER_HZ;
+	if (offsetMicros > INT32_MAX || offsetMicros < INT32_MIN) {
+		offsetMicros = offsetMicros > 0 ? INT32_MAX : INT32_MIN;
+	}
+	reply[0] = (uint8_t) result;
+	protoPut32(&reply[1], (uint32_t) (int32_t) offsetMicros);
+	protoPut32(&reply[5], delayMicros > UINT32_MAX ? UINT32_MAX : (uint32_t) delayMicros);
+	*replyLength = 9;
+	return PROTO_OK;
+}
+
+/**
+ * Binary request adding an alarm, the fields follow struct Alarm.
+ *
+ * @param payload u32 time, u16 interval, u8 repeat count, melody, light effect,
+ * recurrence, weekdays, u16 period and u8 repeat policy, the backoff in bits 0 to 6 and
+ * bit 7 set for escalating rings.
+ * @param reply u8 number of the new alarm.
+ * @return Status of the request.
+ */
+uint8_t addAlarmRequest(const uint8_t *payload, uint8_t length, uint8_t *reply,
+		uint8_t *replyLength) {
+	struct Alarm alarm;
+
+	if (length != 14) {
+		return PROTO_BAD_LENGTH;
+	}
+
+	alarm.time = protoGet32(&payload[0]);
+	alarm.baseTime = alarm.time;
+	alarm.interval = protoGet16(&payload[4]);
+	alarm.repeatCount = payload[6];
+	alarm.repeatIndex = 0;
+	alarm.melody = payload[7];
+	alarm.lightEffect = payload[8];
+	alarm.recurrence = payload[9];
+	alarm.weekdays = payload[10];
+	alarm.period = protoGet16(&payload[11]);
+	alarm.backoff = payload[13] & 0x7F;
+	alarm.escalate = (payload[13] & 0x80) != 0;
+
+	if (alarm.melody < 1 || alarm.melody > MELODY_COUNT
+			|| alarm.lightEffect < 1 || alarm.lightEffect > LIGHT_EFFECT_COUNT
+			|| alarm.interval == 0 || alarm.recurrence > ALARM_EVERY
+			|| alarm.backoff > ALARM_BACKOFF_EXPONENTIAL
+			|| (alarm.recurrence == ALARM_WEEKDAYS
+					&& (alarm.weekdays == 0 || alarm.weekdays > 0x7F))
+			|| (alarm.recurrence == ALARM_EVERY && alarm.period == 0)) {
+		return PROTO_BAD_VALUE;
+	}
+
+	int id = commitAlarm(&alarm);
+	if (id == ALARM_NONE) {
+		return PROTO_TABLE_FULL;
+	}
+	reply[0] = id + 1;
+	*replyLength = 1;
+	return PROTO_OK;
+}
+
+/**
+ * Binary request removing an alarm.
+ *
+ * @param payload u8 number of the alarm.
+ * @return Status of the request.
+ */
+uint8_t deleteAlarmRequest(const uint8_t *payload, uint8_t length, uint8_t *reply,
+		uint8_t *replyLength) {
+	(void) reply;
+	if (length != 1) {
+		return PROTO_BAD_LENGTH;
+	}
+	if (!deleteAlarmNumber(payload[0])) {
+		return PROTO_BAD_VALUE;
+	}
+	*replyLength = 0;
+	return PROTO_OK;
+}
+
+/**
+ * Binary request for the state of the clock, the same information as
+ * displayAlarmStatus() shows at the top in a fraction of the bytes.
+ *
+ * @param reply u32 time, u8 alarms enabled, u8 number of alarms, u32 time of the next
+ * alarm or 0, u16 CPU activity in permille, u32 estimated current in uA.
+ * @return Status of the request.
+ */
+uint8_t queryStatusRequest(const uint8_t *payload, uint8_t length, uint8_t *reply,
+		uint8_t *replyLength) {
+	(void) payload;
+	if (length != 0) {
+		return PROTO_BAD_LENGTH;
+	}
+
+	int next = alarmNext();
+	protoPut32(&reply[0], rtcSeconds());
+	reply[4] = alarmEnabled;
+	reply[5] = alarmCount();
+	protoPut32(&reply[6], next != ALARM_NONE ? alarmGet(next)->time : 0);
+	protoPut16(&reply[10], powerActivePermille());
+	protoPut32(&reply[12], powerAverageCurrentUa());
+	*replyLength = 16;
+	return PROTO_OK;
+}
+
+/**
+ * Binary request for the event log, read in pieces of up to EVENT_REPLY_COUNT events.
+ * A host asks again from the returned sequence plus the count until the count is 0.
+ *
+ * @param payload u32 sequence number of the first event wanted.
+ * @param reply u32 sequence number of the first event returned, u8 count and the events,
+ * each u32 time, u8 type, alarm, repeat index and detail.
+ * @return Status of the request.
+ */
+uint8_t fetchLogRequest(const uint8_t *payload, uint8_t length, uint8_t *reply,
+		uint8_t *replyLength) {
+	struct Event event;
+
+	if (length != 4) {
+		return PROTO_BAD_LENGTH;
+	}
+
+	// Events overwritten since the host asked are skipped, the host sees it by the sequence
+	uint32_t sequence = protoGet32(payload);
+	if (sequence < eventLogOldest()) {
+		sequence = eventLogOldest();
+	}
+	if (sequence > eventLogNext()) {
+		sequence = eventLogNext();
+	}
+
+	uint8_t count = 0;
+	while (count < EVENT_REPLY_COUNT && eventLogGet(sequence + count, &event)) {
+		uint8_t *record = &reply[5 + count * sizeof(struct Event)];
+		protoPut32(&record[0], event.time);
+		record[4] = event.type;
+		record[5] = event.alarm;
+		record[6] = event.repeat;
+		record[7] = event.detail;
+		count++;
+	}
+
+	protoPut32(&reply[0], sequence);
+	reply[4] = count;
+	*replyLength = (uint8_t) (5 + count * sizeof(struct Event));
+	return PROTO_OK;
+}
+
+// Fixed part of the screen, drawn once by screenDraw()
+const char menuHeader[] =
+		STYLE_TITLE TXT_MENU_TITLE STYLE_RESET "\r\n"
+
+		// Menu Choices in Bold with Different Colors
+		ANSI("1;31") TXT_MENU_CLOCK STYLE_RESET TXT_HELP_CLOCK "\r\n"
+		ANSI("1;32") TXT_MENU_ALARM STYLE_RESET TXT_HELP_ALARM "\r\n"
+		ANSI("1;33") TXT_MENU_SWITCH STYLE_RESET TXT_HELP_SWITCH "\r\n"
+		ANSI("1;34") TXT_MENU_MELODY STYLE_RESET TXT_HELP_MELODY "\r\n"
+		ANSI("1;35") TXT_MENU_LIGHT STYLE_RESET TXT_HELP_LIGHT "\r\n"
+		ANSI("1;36") TXT_MENU_REPEAT STYLE_RESET TXT_HELP_REPEAT "\r\n"
+		ANSI("1;37") TXT_MENU_STATUS STYLE_RESET TXT_HELP_STATUS "\r\n"
+		ANSI("1;31") TXT_MENU_DELETE STYLE_RESET TXT_HELP_DELETE "\r\n"
+		"\r\n";
+
+// Labels of the status lines below the menu, in the order of enum ScreenField
+const char *const statusLabels[SCREEN_FIELD_COUNT] = {
+	ANSI("1;33") TXT_LABEL_CLOCK STYLE_RESET,
+	ANSI("1;33") TXT_LABEL_ALARMS STYLE_RESET
+};
+
+const char menuPrompt[] = "\r\n" ANSI("1;5;37") TXT_MENU_PROMPT STYLE_RESET;
+
+/**
+ * Invites the next menu choice. The screen with the menu is drawn when the terminal
+ * does not show it yet, otherwise only the status lines are brought up to date and
+ * the prompt is sent.
+ */
+void displayMenu() {
+	PROFILE_BEGIN();
+	if (!quietMode) {
+		updateScreen(rtcSeconds());
+		if (!screenIsDrawn()) {
+			screenDraw();
+		}
+		UARTSendConst(menuPrompt);
+	}
+	PROFILE_END(PROFILE_MENU);
+}
+
+/**
+ * Brings the status lines of the screen up to date, only what changed is sent.
+ *
+ * @param now Current time.
+ */
+void updateScreen(uint32_t now) {
+	char text[SCREEN_FIELD_LENGTH];
+	struct Formatter f;
+
+	fmtInit(&f, text, sizeof(text));
+	fmtTime(&f, now);
+	screenSetField(SCREEN_CLOCK, text);
+
+	int id = alarmNext();
+	fmtInit(&f, text, sizeof(text));
+	if (alarmRinging) {
+		fmtStr(&f, TXT_RINGING);
+	}
+	fmtStr(&f, alarmEnabled ? TXT_ENABLED : TXT_DISABLED);
+	if (id != ALARM_NONE) {
+		fmtStr(&f, TXT_NEXT_RING);
+		fmtTime(&f, alarmGet(id)->time);
+	}
+	fmtStr(&f, TXT_IN_TABLE);
+	fmtInt(&f, alarmCount());
+	screenSetField(SCREEN_ALARMS, text);
+}
+
+/**
+ * Posted by the RTC every second while the screen is live or the clock is slewed, steps
+ * the slew and ticks the clock line.
+ *
+ * @param second The new second.
+ */
+void clockTicked(uint32_t second) {
+	clockSecond();
+	if (quietMode && !clockSlewing()) {
+		updateSecondsHandler(); // Only a slew needed the seconds
+	}
+	if (!quietMode && screenIsDrawn()) {
+		updateScreen(second);
+	}
+}
+
+/**
+ * Enables the seconds interrupt while the screen is live or the clock is slewed, quiet
+ * mode lets the chip sleep through the seconds otherwise.
+ */
+void updateSecondsHandler() {
+	rtcSetSecondsHandler(!quietMode || clockSlewing() ? clockTicked : NULL);
+}
+
+/**
+ * Puts the core to sleep until the next event when the main loop has nothing to do.
+ * The time base keeps running only while an alarm is ringing or output is being
+ * sent, otherwise the chip goes to VLPS.
+ */
+void idleTask() {
+	uint32_t state = irqSave();
+	if (!workPending()) {
+		bool needsClocks = sequencerRunning() || toneRunning() || ledsNeedClocks()
+				|| buttonsNeedClocks() || !UARTTxIdle();
+		powerSleep(!needsClocks);
+	}
+	irqRestore(state);
+}
+/**
+ * Collects the settings that are kept in the flash log.
+ *
+ * @return The current settings.
+ */
+struct Settings currentSettings() {
+	struct Settings settings;
+
+	settings.interval = alarmIntervalSeconds;
+	settings.melody = selectedMelodyID;
+	settings.lightEffect = selectedLightEffectID;
+	settings.repeatCount = alarmRepeatCount;
+	settings.enabled = alarmEnabled;
+	settings.compensation = clockCompensation;
+	settings.eventMirror = eventMirror;
+	settings.backoff = alarmBackoff;
+	settings.escalate = alarmEscalate;
+	return settings;
+}
+
+/**
+ * Applies a record of the flash log at boot. Records of an unexpected size come from
+ * another firmware version and are ignored.
+ *
+ * @param type Type of the record.
+ * @param data Payload of the record.
+ * @param length Length of the payload.
+ */
+void replayRecord(uint8_t type, const uint8_t *data, uint8_t length) {
+	switch (type) {
+	case RECORD_SETTINGS:
+		if (length == sizeof(struct Settings)) {
+			const struct Settings *settings = (const struct Settings *) data;
+			alarmIntervalSeconds = settings->interval;
+			selectedMelodyID = settings->melody;
+			selectedLightEffectID = settings->lightEffect;
+			alarmRepeatCount = settings->repeatCount;
+			alarmEnabled = settings->enabled;
+			clockCompensation = settings->compensation;
+			eventMirror = settings->eventMirror;
+			alarmBackoff = settings->backoff <= ALARM_BACKOFF_EXPONENTIAL
+					? settings->backoff : ALARM_BACKOFF_FIXED;
+			alarmEscalate = settings->escalate;
+		}
+		break;
+	case RECORD_ALARM:
+		if (length == sizeof(struct StoredAlarm)) {
+			const struct StoredAlarm *stored = (const struct StoredAlarm *) data;
+			struct Alarm alarm = stored->alarm;
+			if (alarm.backoff > ALARM_BACKOFF_EXPONENTIAL) {
+				// Padding of a record from before the repeat policies
+				alarm.backoff = ALARM_BACKOFF_FIXED;
+				alarm.escalate = false;
+			}
+			alarmRestore(stored->id, &alarm);
+		}
+		break;
+	case RECORD_ALARM_REMOVED:
+		if (length == 1) {
+			alarmRemove(data[0]);
+		}
+		break;
+	case RECORD_EVENT:
+		if (length == sizeof(struct Event)) {
+			eventLogRestore((const struct Event *) data);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * Stores the current state of an alarm in the flash log.
+ *
+ * @param id ID of the alarm, which may have been removed.
+ */
+void storeAlarm(int id) {
+	const struct Alarm *alarm = alarmGet(id);
+
+	if (alarm != NULL) {
+		struct StoredAlarm stored;
+		stored.alarm = *alarm;
+		stored.id = id;
+		storageAppend(RECORD_ALARM, &stored, sizeof(stored));
+	} else {
+		uint8_t removed = id;
+		storageAppend(RECORD_ALARM_REMOVED, &removed, sizeof(removed));
+	}
+}
+
+/**
+ * Writes the whole state to the flash log when it moves to a new sector.
+ */
+void writeSnapshot() {
+	savedSettings = currentSettings();
+	storageAppend(RECORD_SETTINGS, &savedSettings, sizeof(savedSettings));
+	for (int i = 0; i < alarmCount(); i++) {
+		storeAlarm(alarmAt(i));
+	}
+
+	// The newest of the events already mirrored, the rest follows from mirrorEvents()
+	if (eventMirror) {
+		uint32_t first = mirroredEvents > EVENT_SNAPSHOT_COUNT
+				? mirroredEvents - EVENT_SNAPSHOT_COUNT : 0;
+		struct Event event;
+		for (uint32_t sequence = first; sequence < mirroredEvents; sequence++) {
+			if (eventLogGet(sequence, &event)) {
+				storageAppend(RECORD_EVENT, &event, sizeof(event));
+			}
+		}
+	}
+}
+
+/**
+ * Copies the events logged since the last call to the flash log if the mirroring is
+ * switched on. Called from the main loop, so logging an event never waits for the flash.
+ */
+void mirrorEvents() {
+	struct Event event;
+
+	if (!eventMirror) {
+		mirroredEvents = eventLogNext();
+		return;
+	}
+	if (mirroredEvents < eventLogOldest()) {
+		mirroredEvents = eventLogOldest(); // More events than the ring holds, rare
+	}
+	while (mirroredEvents < eventLogNext()) {
+		eventLogGet(mirroredEvents, &event);
+		// Counted before the append, so a snapshot written instead of the record holds it
+		mirroredEvents++;
+		if (!storageAppend(RECORD_EVENT, &event, sizeof(event))) {
+			mirroredEvents--; // Tried again by the next call
+			return;
+		}
+	}
+}
+
+/**
+ * Saves the settings and alarms that have changed since the last call. Called from the
+ * main loop, so a dialog or an alarm ring changes RAM first and the flash shortly after.
+ */
+void storageTask() {
+	struct Settings settings = currentSettings();
+
+	if (settings.interval != savedSettings.interval || settings.melody != savedSettings.melody
+			|| settings.lightEffect != savedSettings.lightEffect
+			|| settings.repeatCount != savedSettings.repeatCount
+			|| settings.enabled != savedSettings.enabled
+			|| settings.compensation != savedSettings.compensation
+			|| settings.eventMirror != savedSettings.eventMirror
+			|| settings.backoff != savedSettings.backoff
+			|| settings.escalate != savedSettings.escalate) {
+		savedSettings = settings;
+		storageAppend(RECORD_SETTINGS, &settings, sizeof(settings));
+	}
+
+	uint32_t changes = alarmTakeChanges();
+	for (int id = 0; changes != 0; id++, changes >>= 1) {
+		if (changes & 1) {
+			storeAlarm(id);
+		}
+	}
+
+	mirrorEvents();
+}
+
+/**
+ * Main function
+ */
+int main(void) {
+#ifdef PROFILE
+	ProfileInit();
+#endif
+	MCUInit();
+	PortsInit();
+	WorkInit();
+	EventLogInit();
+	PITInit();
+	AlarmsInit();
+	StorageInit(replayRecord, writeSnapshot);
+	SynthInit();
+	LedsInit();
+	SequencerInit(playbackFinished);
+	ButtonsInit(buttonPressed);
+	PowerInit();
+	UARTInit(inputReceived);
+	uint32_t rtcStartTime = timerMicros();
+	rtcStart = RTCInit(alarmDue);
+	rtcStartMicros = timerMicros() - rtcStartTime;
+	rtcSetCompensation(clockCompensation);
+	ConsoleInit(processUserInput, displayMenu);
+	ScreenInit(menuHeader, statusLabels);
+	ProtoInit(opcodes, sizeof(opcodes) / sizeof(opcodes[0]));
+
+	// Continue with the settings and alarms restored from the flash log
+	savedSettings = currentSettings();
+	alarmTakeChanges();
+	mirroredEvents = eventLogNext(); // Restored events are in the flash log already
+	eventLog(EVENT_BOOT, EVENT_NO_ALARM, 0, (uint8_t) rtcStart);
+	if (alarmEnabled) {
+		skipMissedAlarms();
+	}
+	programNextAlarm();
+	bootMicros = timerMicros();
+
+#ifndef UI_PLAIN
+	screenDraw(); // The messages below go to the scrolling region, a plain terminal
+	              // gets the menu only after them
+#endif
+	UARTSendStr(STYLE_OK TXT_READY "\n" STYLE_RESET);
+	displayBootTimes();
+	rtcSetSecondsHandler(clockTicked);
+	displayMenu();
+
+	while (1) {
+		workTask();
+		storageTask();
+		idleTask();
+	}
+	return 0;
+}
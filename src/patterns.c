@@ -0,0 +1,74 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: patterns.c
+ * Description: Melodies and light effects of the alarm. Everything here is constant and stays
+ * in flash, adding an effect only means adding a table and an entry to the list.
+ */
+
+#include "board.h"
+#include "leds.h"
+#include "patterns.h"
+
+#define ARRAY_LENGTH(a) (sizeof(a) / sizeof((a)[0]))
+
+// 1 - ascending C major scale
+static const struct Note scale[] = {
+	{ 523, 200 }, { 587, 200 }, { 659, 200 }, { 698, 200 }, { 784, 200 },
+	{ 880, 200 }, { 988, 200 }, { 1047, 200 }, { 784, 200 }, { 1047, 200 }
+};
+
+// 2 - classic triple beep
+static const struct Note tripleBeep[] = {
+	{ 1760, 150 }, { 1760, 150 }, { 1760, 150 }, { 0, 250 }, { 1760, 150 },
+	{ 1760, 150 }, { 1760, 150 }, { 0, 250 }, { 2093, 300 }, { 2093, 300 }
+};
+
+// 3 - two-tone siren falling to a low note
+static const struct Note siren[] = {
+	{ 1319, 200 }, { 1047, 200 }, { 1319, 200 }, { 1047, 200 }, { 1319, 200 },
+	{ 1047, 200 }, { 784, 200 }, { 659, 200 }, { 523, 200 }, { 392, 200 }
+};
+
+const struct Melody melodies[MELODY_COUNT] = {
+	{ scale, ARRAY_LENGTH(scale), 1 },
+	{ tripleBeep, ARRAY_LENGTH(tripleBeep), 1 },
+	{ siren, ARRAY_LENGTH(siren), 1 }
+};
+
+// 1 - all LEDs blinking together
+static const struct LightFrame blink[] = {
+	{ LED_ALL, LED_LEVEL_MAX, 10, 0 }, { 0, 0, 10, 0 }
+};
+
+// 2 - one LED running there and back
+static const struct LightFrame pingPong[] = {
+	{ LED_D12, LED_LEVEL_MAX, 10, 0 }, { LED_D11, LED_LEVEL_MAX, 10, 0 },
+	{ LED_D10, LED_LEVEL_MAX, 10, 0 }, { LED_D9, LED_LEVEL_MAX, 10, 0 },
+	{ LED_D10, LED_LEVEL_MAX, 10, 0 }, { LED_D11, LED_LEVEL_MAX, 10, 0 }
+};
+
+// 3 - one LED rotating in one direction
+static const struct LightFrame rotate[] = {
+	{ LED_D12, LED_LEVEL_MAX, 10, 0 }, { LED_D11, LED_LEVEL_MAX, 10, 0 },
+	{ LED_D10, LED_LEVEL_MAX, 10, 0 }, { LED_D9, LED_LEVEL_MAX, 10, 0 }
+};
+
+// 4 - all LEDs slowly breathing
+static const struct LightFrame breathe[] = {
+	{ LED_ALL, LED_LEVEL_MAX, 70, 70 }, { 0, 0, 70, 70 }
+};
+
+// 5 - soft sweep, every LED fades in while the previous one fades out
+static const struct LightFrame sweep[] = {
+	{ LED_D12, LED_LEVEL_MAX, 15, 15 }, { LED_D11, LED_LEVEL_MAX, 15, 15 },
+	{ LED_D10, LED_LEVEL_MAX, 15, 15 }, { LED_D9, LED_LEVEL_MAX, 15, 15 },
+	{ LED_D10, LED_LEVEL_MAX, 15, 15 }, { LED_D11, LED_LEVEL_MAX, 15, 15 }
+};
+
+const struct LightEffect lightEffects[LIGHT_EFFECT_COUNT] = {
+	{ blink, ARRAY_LENGTH(blink), 10 },
+	{ pingPong, ARRAY_LENGTH(pingPong), 3 },
+	{ rotate, ARRAY_LENGTH(rotate), 5 },
+	{ breathe, ARRAY_LENGTH(breathe), 2 },
+	{ sweep, ARRAY_LENGTH(sweep), 2 }
+};
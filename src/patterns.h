@@ -0,0 +1,44 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: patterns.h
+ * Description: Melodies and light effects of the alarm stored as constant tables.
+ */
+
+#ifndef PATTERNS_H
+#define PATTERNS_H
+
+#include <stdint.h>
+
+#define MELODY_COUNT 3       // Melodies selectable by chooseMelody()
+#define LIGHT_EFFECT_COUNT 5 // Light effects selectable by chooseLightEffect()
+
+// Note of a melody, frequency 0 is a pause
+struct Note {
+	uint16_t frequency; // Hz
+	uint16_t duration;  // ms, including the gap after the note
+};
+
+// State of the LEDs shown for a while, the LEDs not listed go dark
+struct LightFrame {
+	uint8_t leds;       // LED_D9..LED_D12 bits of the LEDs that are lit
+	uint8_t level;      // Brightness of the lit LEDs, up to LED_LEVEL_MAX
+	uint8_t duration;   // Tens of ms
+	uint8_t fade;       // Tens of ms to fade into the frame, 0 switches at once
+};
+
+struct Melody {
+	const struct Note *notes;
+	uint8_t length;     // Number of notes
+	uint8_t loops;      // How many times the notes are played
+};
+
+struct LightEffect {
+	const struct LightFrame *frames;
+	uint8_t length;     // Number of frames
+	uint8_t loops;      // How many times the frames are shown
+};
+
+extern const struct Melody melodies[MELODY_COUNT];
+extern const struct LightEffect lightEffects[LIGHT_EFFECT_COUNT];
+
+#endif /* PATTERNS_H */
@@ -0,0 +1,24 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: power.h
+ * Description: Low-power idle modes of the main loop and their duty cycle statistics.
+ */
+
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Typical supply currents of the K60 at 48 MHz used to estimate the average current.
+// These are datasheet figures, not a measurement of the particular board.
+#define POWER_RUN_CURRENT_UA  30000
+#define POWER_WAIT_CURRENT_UA 15000
+#define POWER_VLPS_CURRENT_UA 3
+
+void PowerInit();
+void powerSleep(bool deep);
+uint32_t powerActivePermille();
+uint32_t powerAverageCurrentUa();
+
+#endif /* POWER_H */
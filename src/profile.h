@@ -0,0 +1,93 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: profile.h
+ * Description: Cycle counting with the DWT of the Cortex-M4 and stack depth of the handlers,
+ * built only with PROFILE defined (make PROFILE=1). Without it the macros below expand to
+ * nothing and no code is left.
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+
+// Measured pieces of code
+enum ProfilePoint {
+	PROFILE_RTC_IRQ,        // RTC_IRQHandler()
+	PROFILE_ALARM_REPEATS,  // handleAlarmRepeats()
+	PROFILE_UART_SEND,      // UARTSendStr()
+	PROFILE_MENU,           // displayMenu()
+	PROFILE_MELODY_STEP,    // Next note of the sequencer
+	PROFILE_LIGHT_STEP,     // Next light frame of the sequencer
+	PROFILE_ALARM_LATENCY,  // From the alarm second to its first note
+	PROFILE_SYNTH_SAMPLE,   // PIT2_IRQHandler(), one sample of the synthesizer
+	PROFILE_POINT_COUNT
+};
+
+// Handlers whose deepest use of the stack is measured
+enum ProfileStack {
+	PROFILE_STACK_TICK,    // PIT0_IRQHandler(), the time base handlers
+	PROFILE_STACK_PWM,     // PIT1_IRQHandler()
+	PROFILE_STACK_SYNTH,   // PIT2_IRQHandler()
+	PROFILE_STACK_RTC,     // RTC_IRQHandler()
+	PROFILE_STACK_SECONDS, // RTC_Seconds_IRQHandler()
+	PROFILE_STACK_BUTTONS, // PORTE_IRQHandler()
+	PROFILE_STACK_UART,    // UART5_RX_TX_IRQHandler()
+	PROFILE_STACK_DMA,     // DMA0_IRQHandler()
+	PROFILE_STACK_WORK,    // The deepest of the deferred work handlers
+	PROFILE_STACK_COUNT
+};
+
+#ifdef PROFILE
+
+#include "MK60D10.h"
+
+// Statistics of one point, in core clock cycles
+struct ProfileStats {
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint64_t total;
+};
+
+void ProfileInit();
+void profileRecord(enum ProfilePoint point, uint32_t cycles);
+void profileAlarmFired();
+void profileAlarmRung();
+void profileReset();
+const char *profileName(enum ProfilePoint point);
+struct ProfileStats profileGet(enum ProfilePoint point);
+uint32_t profileStackUsed();
+uint32_t profileStackSize();
+void profileStackPaint(const uint32_t *sp);
+void profileStackRecord(enum ProfileStack handler, const uint32_t *sp);
+uint32_t profileStackDepth(enum ProfileStack handler);
+const char *profileStackName(enum ProfileStack handler);
+
+/**
+ * Returns the cycle counter.
+ */
+static inline uint32_t profileCycles() {
+	return DWT->CYCCNT;
+}
+
+#define PROFILE_BEGIN() uint32_t profileStart = profileCycles()
+#define PROFILE_END(point) profileRecord((point), profileCycles() - profileStart)
+#define PROFILE_ALARM_FIRED() profileAlarmFired()
+#define PROFILE_ALARM_RUNG() profileAlarmRung()
+#define PROFILE_STACK_BEGIN() const uint32_t *profileSp = (const uint32_t *) __get_MSP(); \
+	profileStackPaint(profileSp)
+#define PROFILE_STACK_END(handler) profileStackRecord((handler), profileSp)
+
+#else
+
+#define PROFILE_BEGIN()
+#define PROFILE_END(point)
+#define PROFILE_ALARM_FIRED()
+#define PROFILE_ALARM_RUNG()
+#define PROFILE_STACK_BEGIN()
+#define PROFILE_STACK_END(handler)
+
+#endif /* PROFILE */
+
+#endif /* PROFILE_H */
@@ -0,0 +1,123 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: proto.c
+ * Description: Receiver and dispatcher of the binary protocol. The console passes every
+ * received byte here first, a frame starts with PROTO_STX and its bytes never reach the line
+ * editor. Requests are run through an opcode table supplied by the application. The bytes
+ * are passed on from UARTReadCh(), so the receive time of a frame is the one the UART
+ * interrupt noted for its last byte.
+ */
+
+#include "timer.h"
+#include "uart.h"
+#include "crc.h"
+#include "proto.h"
+
+static const struct ProtoOpcode *opcodes; // Known requests
+static int opcodeCount;
+
+static uint8_t frame[PROTO_MAX_LENGTH + 3]; // LEN, OPCODE, PAYLOAD and the CRC
+static uint8_t received = 0;                // Bytes of frame received so far
+static bool receiving = false;              // A frame has been started
+static deadline_t frameDeadline;            // Time by which the frame must be complete
+static struct RtcTime frameTime;            // RTC time the last byte of the frame came in
+
+/**
+ * Initializes the protocol.
+ *
+ * @param table Known requests.
+ * @param tableLength Number of entries in table.
+ */
+void ProtoInit(const struct ProtoOpcode *table, int tableLength) {
+	opcodes = table;
+	opcodeCount = tableLength;
+	receiving = false;
+}
+
+/**
+ * Sends a reply frame.
+ *
+ * @param opcode Opcode of the request.
+ * @param status Status of the request.
+ * @param data Reply data.
+ * @param length Number of bytes of data.
+ */
+static void protoReply(uint8_t opcode, uint8_t status, const uint8_t *data, uint8_t length) {
+	uint8_t reply[PROTO_MAX_LENGTH + 4];
+
+	reply[0] = PROTO_STX;
+	reply[1] = length + 2;
+	reply[2] = opcode | PROTO_REPLY;
+	reply[3] = status;
+	for (uint8_t i = 0; i < length; i++) {
+		reply[4 + i] = data[i];
+	}
+	protoPut16(&reply[4 + length], crc16(CRC16_INIT, &reply[1], length + 3));
+	UARTSendBytes(reply, length + 6);
+}
+
+/**
+ * Checks and runs a complete request.
+ */
+static void protoDispatch() {
+	uint8_t length = frame[0];
+	uint8_t opcode = frame[1];
+	uint8_t data[PROTO_MAX_REPLY];
+	uint8_t dataLength = 0;
+
+	if (crc16(CRC16_INIT, frame, length + 1) != protoGet16(&frame[length + 1])) {
+		protoReply(opcode, PROTO_BAD_CRC, data, 0);
+		return;
+	}
+
+	for (int i = 0; i < opcodeCount; i++) {
+		if (opcodes[i].opcode == opcode) {
+			uint8_t status = opcodes[i].run(&frame[2], length - 1, data, &dataLength);
+			protoReply(opcode, status, data, status == PROTO_OK ? dataLength : 0);
+			return;
+		}
+	}
+	protoReply(opcode, PROTO_BAD_OPCODE, data, 0);
+}
+
+/**
+ * Passes a received byte to the protocol.
+ *
+ * @param byte The byte.
+ * @return True if the byte was part of a frame, false if it belongs to the console.
+ */
+bool protoFeed(uint8_t byte) {
+	if (receiving && deadlineExpired(frameDeadline)) {
+		receiving = false; // The rest of the frame was lost
+	}
+
+	if (!receiving) {
+		if (byte != PROTO_STX) {
+			return false;
+		}
+		receiving = true;
+		received = 0;
+		frameDeadline = deadlineIn(PROTO_TIMEOUT_MS);
+		return true;
+	}
+
+	frame[received++] = byte;
+	if (received == 1 && (byte == 0 || byte > PROTO_MAX_LENGTH)) {
+		receiving = false; // Not a valid length, wait for the next STX
+	} else if (received == frame[0] + 3) {
+		receiving = false;
+		UARTRxTime(&frameTime);
+		protoDispatch();
+	}
+	return true;
+}
+
+/**
+ * Returns the RTC time the request being run was received, when its last byte came in
+ * on the line. The time spent in the receive buffer and the work queue is not part of it.
+ *
+ * @param time Pointer to store the time.
+ */
+void protoReceivedTime(struct RtcTime *time) {
+	*time = frameTime;
+}
@@ -0,0 +1,97 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: proto.h
+ * Description: Binary framed protocol for host tools, sharing the UART with the console.
+ */
+
+#ifndef PROTO_H
+#define PROTO_H
+
+#include "rtc.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Frame: STX, LEN, OPCODE, PAYLOAD[LEN - 1], CRC16 low, CRC16 high. The CRC is CRC-16/CCITT
+// (polynomial 0x1021, initial value 0xFFFF) of LEN, OPCODE and PAYLOAD. A reply has the
+// same layout with OPCODE | PROTO_REPLY followed by a status byte and the reply data.
+#define PROTO_STX        0x02 // Starts a frame, never typed on the console
+#define PROTO_MAX_LENGTH 48   // Largest LEN
+#define PROTO_TIMEOUT_MS 100  // An incomplete frame is dropped after this long
+#define PROTO_REPLY      0x80 // Set in the opcode of replies
+
+// Opcodes
+#define PROTO_OP_PING         0x01
+#define PROTO_OP_SET_TIME     0x10 // u32 time, optionally u16 milliseconds
+#define PROTO_OP_CALIBRATE    0x11 // u32 time, u16 milliseconds; replies u8 result, i32 drift
+                                   // in ppb, u16 RTC_TCR compensation
+#define PROTO_OP_SYNC_TIME    0x12 // u32 time, u16 milliseconds sent (T1), optionally u32 time,
+                                   // u16 milliseconds the previous reply came in (T4); replies
+                                   // u32 time, u16 milliseconds received (T2) and replied (T3),
+                                   // u8 exchanges taken
+#define PROTO_OP_SYNC_APPLY   0x13 // u32 time, u16 milliseconds the last reply came in (T4);
+                                   // replies u8 result, i32 offset corrected in us, u32 round
+                                   // trip in us
+#define PROTO_OP_ADD_ALARM    0x20 // u32 time, u16 interval, u8 repeats, melody, light effect,
+                                   // recurrence, weekdays, u16 period, u8 backoff | 0x80 for
+                                   // escalating rings; replies u8 alarm number
+#define PROTO_OP_DELETE_ALARM 0x21 // u8 alarm number
+#define PROTO_OP_QUERY_STATUS 0x30 // Replies u32 time, u8 enabled, u8 alarms, u32 next alarm,
+                                   // u16 CPU activity in permille, u32 current in uA
+#define PROTO_OP_FETCH_LOG    0x40 // u32 first sequence; replies u32 sequence, u8 count and
+                                   // count events of u32 time, u8 type, alarm, repeat, detail
+
+// Status of a reply
+#define PROTO_OK             0
+#define PROTO_BAD_CRC        1
+#define PROTO_BAD_OPCODE     2
+#define PROTO_BAD_LENGTH     3
+#define PROTO_BAD_VALUE      4
+#define PROTO_TABLE_FULL     5
+#define PROTO_UNSUPPORTED    6
+
+#define PROTO_MAX_REPLY (PROTO_MAX_LENGTH - 2) // Largest reply data
+
+// Runs a request, fills the reply data and returns the status
+typedef uint8_t (*ProtoHandler)(const uint8_t *payload, uint8_t length, uint8_t *reply,
+		uint8_t *replyLength);
+
+struct ProtoOpcode {
+	uint8_t opcode;
+	ProtoHandler run;
+};
+
+void ProtoInit(const struct ProtoOpcode *table, int tableLength);
+bool protoFeed(uint8_t byte);
+void protoReceivedTime(struct RtcTime *time);
+
+/**
+ * Reads a little-endian 16-bit value.
+ */
+static inline uint16_t protoGet16(const uint8_t *p) {
+	return (uint16_t) (p[0] | p[1] << 8);
+}
+
+/**
+ * Reads a little-endian 32-bit value.
+ */
+static inline uint32_t protoGet32(const uint8_t *p) {
+	return p[0] | p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+/**
+ * Writes a little-endian 16-bit value.
+ */
+static inline void protoPut16(uint8_t *p, uint16_t value) {
+	p[0] = (uint8_t) value;
+	p[1] = (uint8_t) (value >> 8);
+}
+
+/**
+ * Writes a little-endian 32-bit value.
+ */
+static inline void protoPut32(uint8_t *p, uint32_t value) {
+	protoPut16(p, (uint16_t) value);
+	protoPut16(p + 2, (uint16_t) (value >> 16));
+}
+
+#endif /* PROTO_H */
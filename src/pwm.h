@@ -0,0 +1,22 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: pwm.h
+ * Description: Output of the LED brightness computed by leds.c as bit angle modulation: a
+ * PWM period is split into PWM_BITS slots lasting 1, 2, 4 ... 128 units and an LED is on in
+ * the slots whose plane has its bit set.
+ */
+
+#ifndef PWM_H
+#define PWM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PWM_BITS 8
+
+void PwmInit();
+void pwmShow(const uint8_t *planes, uint8_t on, bool modulate);
+bool pwmRunning();
+void PIT1_IRQHandler();
+
+#endif /* PWM_H */
@@ -0,0 +1,97 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: ringbuf.h
+ * Description: Lock-free single-producer/single-consumer byte ring buffer. One side may run
+ * in an interrupt handler and the other in the main loop without disabling interrupts.
+ */
+
+#ifndef RINGBUF_H
+#define RINGBUF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Ring buffer of bytes, the size must be a power of two. Head and tail are free-running
+// counters, head is only written by the producer and tail only by the consumer.
+struct RingBuffer {
+	volatile uint8_t *data;
+	uint16_t size;
+	volatile uint16_t head;
+	volatile uint16_t tail;
+};
+
+#define RING_BUFFER_INIT(storage) { (storage), sizeof(storage), 0, 0 }
+
+/**
+ * Returns the number of bytes stored in the ring buffer.
+ */
+static inline uint16_t ringCount(const struct RingBuffer *rb) {
+	return (uint16_t) (rb->head - rb->tail);
+}
+
+/**
+ * Returns the number of bytes that can still be stored in the ring buffer.
+ */
+static inline uint16_t ringFree(const struct RingBuffer *rb) {
+	return (uint16_t) (rb->size - ringCount(rb));
+}
+
+/**
+ * Stores a byte in the ring buffer. Producer side only.
+ *
+ * @return True if the byte was stored, false if the buffer is full.
+ */
+static inline bool ringPut(struct RingBuffer *rb, uint8_t byte) {
+	uint16_t head = rb->head;
+
+	if ((uint16_t) (head - rb->tail) >= rb->size) {
+		return false;
+	}
+	rb->data[head & (rb->size - 1)] = byte;
+	rb->head = head + 1; // Publish the byte only after it has been written
+	return true;
+}
+
+/**
+ * Removes the oldest byte from the ring buffer. Consumer side only.
+ *
+ * @return True if a byte was read, false if the buffer is empty.
+ */
+static inline bool ringGet(struct RingBuffer *rb, uint8_t *byte) {
+	uint16_t tail = rb->tail;
+
+	if (tail == rb->head) {
+		return false;
+	}
+	*byte = rb->data[tail & (rb->size - 1)];
+	rb->tail = tail + 1; // Release the slot only after it has been read
+	return true;
+}
+
+/**
+ * Returns the number of stored bytes that can be read as one contiguous block starting
+ * at ringTailPtr(), i.e. up to the end of the storage. Consumer side only.
+ */
+static inline uint16_t ringContiguous(const struct RingBuffer *rb) {
+	uint16_t offset = rb->tail & (rb->size - 1);
+	uint16_t count = ringCount(rb);
+
+	return count < rb->size - offset ? count : (uint16_t) (rb->size - offset);
+}
+
+/**
+ * Returns a pointer to the oldest stored byte. Consumer side only.
+ */
+static inline volatile uint8_t *ringTailPtr(const struct RingBuffer *rb) {
+	return &rb->data[rb->tail & (rb->size - 1)];
+}
+
+/**
+ * Releases bytes that were consumed directly from the storage, e.g. by DMA.
+ * Consumer side only.
+ */
+static inline void ringRelease(struct RingBuffer *rb, uint16_t count) {
+	rb->tail = (uint16_t) (rb->tail + count);
+}
+
+#endif /* RINGBUF_H */
@@ -0,0 +1,60 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: rtc.h
+ * Description: RTC with sub-second access, the alarm and the drift compensation register.
+ */
+
+#ifndef RTC_H
+#define RTC_H
+
+#include "work.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#define RTC_PRESCALER_HZ 32768 // Prescaler ticks per second
+#define RTC_OSC_TIMEOUT_MS 3000 // Longest start of the 32.768 kHz crystal oscillator
+
+// Time as counted by the RTC
+struct RtcTime {
+	uint32_t seconds; // Seconds since 1970
+	uint16_t ticks;   // Fraction of the second in 1/RTC_PRESCALER_HZ
+};
+
+// How RTCInit() found the RTC
+enum RtcStart {
+	RTC_COLD_START,   // The RTC was reset and its oscillator started
+	RTC_WARM_START,   // The RTC kept counting across the reset
+	RTC_NO_OSCILLATOR // The oscillator did not start within RTC_OSC_TIMEOUT_MS
+};
+
+
+enum RtcStart RTCInit(WorkHandler alarm);
+uint32_t rtcSeconds();
+void rtcRead(struct RtcTime *time);
+uint64_t rtcMicros();
+void rtcSetTime(const struct RtcTime *time);
+void rtcStep(int64_t ticks);
+void rtcSetAlarm(uint32_t seconds);
+void rtcSetSecondsHandler(WorkHandler handler);
+void rtcSetCompensation(uint16_t compensation);
+uint16_t rtcGetCompensation();
+int8_t rtcCompensationApplied();
+void RTC_IRQHandler();
+void RTC_Seconds_IRQHandler();
+
+/**
+ * Converts milliseconds to prescaler ticks, rounding up so rtcMillisFromTicks() gives the
+ * same milliseconds back.
+ */
+static inline uint16_t rtcTicksFromMillis(uint16_t ms) {
+	return (uint16_t) (((uint32_t) ms * RTC_PRESCALER_HZ + 999u) / 1000u);
+}
+
+/**
+ * Converts prescaler ticks to milliseconds, rounding down.
+ */
+static inline uint16_t rtcMillisFromTicks(uint16_t ticks) {
+	return (uint16_t) ((uint32_t) ticks * 1000u / RTC_PRESCALER_HZ);
+}
+
+#endif /* RTC_H */
@@ -0,0 +1,171 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: screen.c
+ * Description: Terminal screen drawn once and then updated in place with ANSI cursor
+ * positioning. The header and the status lines stay at the top, the lines below them are
+ * a scrolling region where the dialogs run as before. A status line that changes is
+ * rewritten from its first changed character only, with the cursor saved and restored
+ * around it, so a ticking clock costs about a dozen bytes per second instead of the menu.
+ * A UI_PLAIN build never moves the cursor. The screen is printed as ordinary lines and
+ * does not count as drawn, so it is printed again with fresh status lines every time.
+ */
+
+#include "uart.h"
+#include "fmt.h"
+#include "screen.h"
+#include <stddef.h>
+#include <string.h>
+
+static const char *header = NULL;       // Fixed lines at the top, with "\r\n" line endings
+static uint16_t headerLength = 0;
+static uint8_t headerLines = 0;
+static const char *const *fieldLabels = NULL;
+static uint8_t labelWidths[SCREEN_FIELD_COUNT]; // Visible width of the labels
+static char fields[SCREEN_FIELD_COUNT][SCREEN_FIELD_LENGTH]; // Text as it is on the screen
+static bool drawn = false;              // The terminal shows the screen
+
+/**
+ * Returns the number of terminal columns taken by the beginning of a text. Escape
+ * sequences take none and a UTF-8 character takes one.
+ *
+ * @param text The text.
+ * @param length Number of bytes to measure.
+ */
+static uint8_t visibleWidth(const char *text, size_t length) {
+	uint8_t width = 0;
+
+	for (size_t i = 0; i < length; i++) {
+		if (text[i] == '\033') {
+			// Skip up to the final byte of the control sequence
+			i++;
+			if (i < length && text[i] == '[') {
+				while (i + 1 < length && ((unsigned char) text[i + 1] < 0x40
+						|| (unsigned char) text[i + 1] > 0x7E)) {
+					i++;
+				}
+				i++;
+			}
+		} else if (((unsigned char) text[i] & 0xC0) != 0x80) {
+			width++;
+		}
+	}
+	return width;
+}
+
+/**
+ * Initializes the screen, nothing is drawn until screenDraw().
+ *
+ * @param headerText Lines at the top of the screen, each ending with "\r\n". Sent
+ *        without copying, so it must stay unchanged.
+ * @param labels SCREEN_FIELD_COUNT labels written in front of the status lines.
+ */
+void ScreenInit(const char *headerText, const char *const *labels) {
+	header = headerText;
+	headerLength = (uint16_t) strlen(headerText);
+	headerLines = 0;
+	for (uint16_t i = 0; i < headerLength; i++) {
+		if (headerText[i] == '\n') {
+			headerLines++;
+		}
+	}
+
+	fieldLabels = labels;
+	for (int i = 0; i < SCREEN_FIELD_COUNT; i++) {
+		labelWidths[i] = visibleWidth(labels[i], strlen(labels[i]));
+		fields[i][0] = '\0';
+	}
+	drawn = false;
+}
+
+/**
+ * Clears the terminal and draws the whole screen with the status lines as they were
+ * last set. The cursor is left at the top of the scrolling region.
+ */
+void screenDraw() {
+#ifndef UI_PLAIN
+	char buffer[24];
+	struct Formatter f;
+	uint8_t scrollTop = (uint8_t) (headerLines + SCREEN_FIELD_COUNT + 1);
+
+	UARTSendConst("\033[r\033[2J\033[H");
+#endif
+	UARTSendBuf(header, headerLength);
+	for (int i = 0; i < SCREEN_FIELD_COUNT; i++) {
+		UARTSendStr(fieldLabels[i]);
+		UARTSendStr(fields[i]);
+		UARTSendConst("\r\n");
+	}
+
+#ifndef UI_PLAIN
+	// Setting the region homes the cursor, so it is moved into the region afterwards
+	fmtInit(&f, buffer, sizeof(buffer));
+	fmtStr(&f, "\033[");
+	fmtUint(&f, scrollTop);
+	fmtStr(&f, "r\033[");
+	fmtUint(&f, scrollTop);
+	fmtStr(&f, ";1H");
+	UARTSendStr(buffer);
+	drawn = true;
+#endif
+}
+
+/**
+ * Forgets that the screen is drawn, the next screenDraw() is needed before the status
+ * lines are updated again. Used when the terminal may have been cleared or taken over.
+ */
+void screenInvalidate() {
+	drawn = false;
+}
+
+/**
+ * Tells whether the terminal shows the screen.
+ */
+bool screenIsDrawn() {
+	return drawn;
+}
+
+/**
+ * Sets the text of a status line. When the screen is drawn only the part from the
+ * first changed character on is sent, nothing at all if the text is the same.
+ *
+ * @param field The status line.
+ * @param text New text without line endings or escape sequences, longer text is cut.
+ */
+void screenSetField(enum ScreenField field, const char *text) {
+	char *old = fields[field];
+	size_t same = 0;
+
+	while (same < SCREEN_FIELD_LENGTH - 1 && old[same] != '\0' && old[same] == text[same]) {
+		same++;
+	}
+	if (old[same] == text[same] || (same == SCREEN_FIELD_LENGTH - 1 && old[same] == '\0')) {
+		return; // Unchanged, at most the cut part differs
+	}
+	while (same > 0 && ((unsigned char) text[same] & 0xC0) == 0x80) {
+		same--; // Rewrite the whole UTF-8 character
+	}
+
+	size_t oldLength = strlen(old);
+	strncpy(old, text, SCREEN_FIELD_LENGTH - 1);
+	old[SCREEN_FIELD_LENGTH - 1] = '\0';
+
+	if (!drawn) {
+		return;
+	}
+
+	char buffer[SCREEN_FIELD_LENGTH + 24];
+	struct Formatter f;
+
+	fmtInit(&f, buffer, sizeof(buffer));
+	fmtStr(&f, "\0337\033[");
+	fmtUint(&f, (uint32_t) headerLines + 1 + field);
+	fmtChar(&f, ';');
+	fmtUint(&f, (uint32_t) labelWidths[field] + visibleWidth(old, same) + 1);
+	fmtChar(&f, 'H');
+	fmtStr(&f, old + same);
+	if (strlen(old) < oldLength) {
+		fmtStr(&f, "\033[K"); // The rest of the old text
+	}
+	fmtStr(&f, "\0338");
+	UARTSendStr(buffer);
+}
@@ -0,0 +1,28 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: screen.h
+ * Description: Terminal screen drawn once and then updated in place. A fixed header is
+ * followed by the status lines and the scrolling area for the dialogs.
+ */
+
+#ifndef SCREEN_H
+#define SCREEN_H
+
+#include <stdbool.h>
+
+#define SCREEN_FIELD_LENGTH 80 // Longest text of a status line including the terminating null
+
+// Status lines below the header, updated in place
+enum ScreenField {
+	SCREEN_CLOCK,  // Current time
+	SCREEN_ALARMS, // State of the alarms
+	SCREEN_FIELD_COUNT
+};
+
+void ScreenInit(const char *header, const char *const *labels);
+void screenDraw();
+void screenInvalidate();
+bool screenIsDrawn();
+void screenSetField(enum ScreenField field, const char *text);
+
+#endif /* SCREEN_H */
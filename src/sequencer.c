@@ -0,0 +1,173 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: sequencer.c
+ * Description: Generic sequencer for the melodies and light effects in patterns.c. Both tracks
+ * are stepped from the 1 ms time base, every tick only counts down the current step, so the
+ * work done in the interrupt is constant and the main loop does not take part at all. The end
+ * of the playback is posted as deferred work.
+ */
+
+#include "board.h"
+#include "timer.h"
+#include "irq.h"
+#include "synth.h"
+#include "leds.h"
+#include "patterns.h"
+#include "sequencer.h"
+#include "profile.h"
+#include <stddef.h>
+
+#define LIGHT_DURATION_MS 10 // LightFrame.duration unit
+
+// Playback position in one pattern table
+struct Track {
+	uint8_t index;      // Step being played
+	uint8_t loop;       // Finished passes over the table
+	uint16_t remaining; // ms left in the current step, 0 when the track is stopped
+};
+
+static const struct Melody *melody;          // Melody being played
+static const struct LightEffect *lightEffect; // Light effect being shown
+static struct Track melodyTrack;
+static struct Track lightTrack;
+static uint8_t melodyVolume = SYNTH_VOLUME_MAX; // Volume of the notes
+static uint8_t lightIntensity = LED_LEVEL_MAX; // Brightness the frames are scaled to
+static WorkHandler finishedHandler = NULL;
+
+static void sequencerTick();
+
+/**
+ * Initializes the sequencer and hooks it to the time base.
+ *
+ * @param finished Posted as deferred work when a playback ends by itself, may be NULL.
+ */
+void SequencerInit(WorkHandler finished) {
+	finishedHandler = finished;
+	timerAddTickHandler(sequencerTick);
+}
+
+/**
+ * Starts the note of the melody track at its current position.
+ */
+static void melodyStep() {
+	PROFILE_BEGIN();
+	const struct Note *note = &melody->notes[melodyTrack.index];
+
+	// Frequency 0 silences the voice
+	synthPlay(SYNTH_VOICE_MELODY, note->frequency, note->duration - NOTE_GAP_MS, melodyVolume);
+	melodyTrack.remaining = note->duration;
+	PROFILE_END(PROFILE_MELODY_STEP);
+}
+
+/**
+ * Shows the frame of the light track at its current position.
+ */
+static void lightStep() {
+	PROFILE_BEGIN();
+	const struct LightFrame *frame = &lightEffect->frames[lightTrack.index];
+
+	uint16_t fade = frame->fade * LIGHT_DURATION_MS;
+
+	ledsFade(frame->leds, (uint8_t) (frame->level * lightIntensity / LED_LEVEL_MAX), fade);
+	ledsFade(LED_ALL & ~frame->leds, 0, fade);
+	lightTrack.remaining = frame->duration * LIGHT_DURATION_MS;
+	PROFILE_END(PROFILE_LIGHT_STEP);
+}
+
+/**
+ * Moves a track to its next step.
+ *
+ * @param track Track to advance.
+ * @param length Number of steps in the table of the track.
+ * @param loops Number of passes over the table.
+ * @return True if there is a next step, false if the track has finished.
+ */
+static bool trackAdvance(struct Track *track, uint8_t length, uint8_t loops) {
+	if (++track->index < length) {
+		return true;
+	}
+	track->index = 0;
+	return ++track->loop < loops;
+}
+
+/**
+ * Starts playing a melody together with a light effect. Whatever was playing before
+ * is replaced. IDs out of range leave the respective track silent.
+ *
+ * @param melodyID ID of the melody, 1 to MELODY_COUNT.
+ * @param lightEffectID ID of the light effect, 1 to LIGHT_EFFECT_COUNT.
+ * @param intensity Volume and brightness, SEQUENCER_INTENSITY_MAX plays the patterns
+ *        as they are.
+ */
+void sequencerStart(int melodyID, int lightEffectID, uint8_t intensity) {
+	uint32_t state = irqSave();
+
+	melodyTrack = (struct Track) { 0 };
+	lightTrack = (struct Track) { 0 };
+	melodyVolume = (uint8_t) (intensity * SYNTH_VOLUME_MAX / SEQUENCER_INTENSITY_MAX);
+	lightIntensity = (uint8_t) (intensity * LED_LEVEL_MAX / SEQUENCER_INTENSITY_MAX);
+
+	melody = (melodyID >= 1 && melodyID <= MELODY_COUNT) ? &melodies[melodyID - 1] : NULL;
+	if (melody != NULL && melody->length > 0 && melody->loops > 0) {
+		melodyStep();
+	}
+	lightEffect = (lightEffectID >= 1 && lightEffectID <= LIGHT_EFFECT_COUNT)
+			? &lightEffects[lightEffectID - 1] : NULL;
+	if (lightEffect != NULL && lightEffect->length > 0 && lightEffect->loops > 0) {
+		lightStep();
+	}
+
+	irqRestore(state);
+}
+
+/**
+ * Stops the melody and the light effect immediately.
+ */
+void sequencerStop() {
+	uint32_t state = irqSave();
+
+	melodyTrack.remaining = 0;
+	lightTrack.remaining = 0;
+	synthStop(SYNTH_VOICE_MELODY);
+	ledsSet(LED_ALL, 0);
+
+	irqRestore(state);
+}
+
+/**
+ * Checks whether a melody or a light effect is still being played.
+ *
+ * @return True if either track is running.
+ */
+bool sequencerRunning() {
+	return melodyTrack.remaining != 0 || lightTrack.remaining != 0;
+}
+
+/**
+ * Time base handler, advances both tracks by one millisecond.
+ */
+static void sequencerTick() {
+	if (!sequencerRunning()) {
+		return;
+	}
+
+	if (melodyTrack.remaining != 0 && --melodyTrack.remaining == 0) {
+		if (trackAdvance(&melodyTrack, melody->length, melody->loops)) {
+			melodyStep();
+		} else {
+			synthStop(SYNTH_VOICE_MELODY);
+		}
+	}
+
+	if (lightTrack.remaining != 0 && --lightTrack.remaining == 0) {
+		if (trackAdvance(&lightTrack, lightEffect->length, lightEffect->loops)) {
+			lightStep();
+		} else {
+			ledsSet(LED_ALL, 0);
+		}
+	}
+
+	if (!sequencerRunning() && finishedHandler != NULL) {
+		workPost(finishedHandler, 0);
+	}
+}
@@ -0,0 +1,22 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: sequencer.h
+ * Description: Plays a melody and a light effect from the pattern tables in the background.
+ */
+
+#ifndef SEQUENCER_H
+#define SEQUENCER_H
+
+#include "work.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#define NOTE_GAP_MS 20 // Silence at the end of every note so repeated notes are audible
+#define SEQUENCER_INTENSITY_MAX 255 // Full volume and brightness
+
+void SequencerInit(WorkHandler finished);
+void sequencerStart(int melodyID, int lightEffectID, uint8_t intensity);
+void sequencerStop();
+bool sequencerRunning();
+
+#endif /* SEQUENCER_H */
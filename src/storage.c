@@ -0,0 +1,195 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: storage.c
+ * Description: Wear-levelled record log in the last sectors of the program flash. Records are
+ * only ever appended to the active sector, a sector starts with a header holding a sequence
+ * number and the active one is the valid sector with the highest number. When it is full the
+ * next sector in the rotation is erased and a snapshot of the whole state is written there,
+ * so every sector is erased equally often and a change costs one small program operation.
+ * Every record carries a CRC, at boot the active sector is replayed up to the first record
+ * that is erased or damaged by a reset during programming.
+ */
+
+#include "flash.h"
+#include "crc.h"
+#include "storage.h"
+#include <stddef.h>
+
+#define STORAGE_MAGIC   0x474F4C41u // "ALOG", also marks the record format
+#define HEADER_SIZE     8           // Magic and sequence number
+#define RECORD_HEADER   4           // Type, length and CRC
+#define RECORD_ERASED   0xFF        // Type byte of erased flash, the end of the log
+
+static StorageReplayHandler replayHandler;
+static StorageSnapshotHandler snapshotHandler;
+static int activeSector = -1;   // Sector records are appended to, -1 before the first write
+static uint32_t sequence = 0;   // Sequence number of the active sector
+static uint32_t writeOffset;    // Offset of the next record in the active sector
+static bool compacting = false; // The snapshot is being written
+
+/**
+ * Returns the address of a sector of the log.
+ */
+static uint32_t sectorAddress(int sector) {
+	return STORAGE_BASE + (uint32_t) sector * STORAGE_SECTOR_SIZE;
+}
+
+/**
+ * Reads a longword of the flash.
+ */
+static uint32_t flashRead(uint32_t address) {
+	return *(const volatile uint32_t *) flashPointer(address);
+}
+
+/**
+ * Returns a record of the active sector.
+ */
+static const uint8_t *recordAt(uint32_t offset) {
+	return flashPointer(sectorAddress(activeSector) + offset);
+}
+
+/**
+ * Checks a record of the active sector.
+ *
+ * @param offset Offset of the record in the sector.
+ * @return Size of the record including its header and padding, 0 if there is no valid
+ * record at the offset.
+ */
+static uint32_t recordSize(uint32_t offset) {
+	const uint8_t *record = recordAt(offset);
+	uint32_t size = RECORD_HEADER + ((record[1] + 3u) & ~3u);
+
+	if (record[0] == RECORD_ERASED || record[1] > STORAGE_RECORD_MAX
+			|| offset + size > STORAGE_SECTOR_SIZE) {
+		return 0;
+	}
+
+	uint16_t crc = crc16(CRC16_INIT, record, 2);
+	crc = crc16(crc, &record[RECORD_HEADER], record[1]);
+	return crc == (uint16_t) (record[2] | record[3] << 8) ? size : 0;
+}
+
+/**
+ * Finds the active sector and replays its records.
+ *
+ * @param replay Called for every record of the log, oldest first.
+ * @param snapshot Called when the log moves to a new sector, it must append records
+ * that restore the whole current state.
+ */
+void StorageInit(StorageReplayHandler replay, StorageSnapshotHandler snapshot) {
+	replayHandler = replay;
+	snapshotHandler = snapshot;
+	activeSector = -1;
+
+	FlashInit();
+
+	for (int i = 0; i < STORAGE_SECTOR_COUNT; i++) {
+		uint32_t address = sectorAddress(i);
+		uint32_t number = flashRead(address + 4);
+		if (flashRead(address) == STORAGE_MAGIC
+				&& (activeSector < 0 || (int32_t) (number - sequence) > 0)) {
+			activeSector = i;
+			sequence = number;
+		}
+	}
+	if (activeSector < 0) {
+		return; // Nothing stored yet, the first append formats a sector
+	}
+
+	writeOffset = HEADER_SIZE;
+	while (writeOffset < STORAGE_SECTOR_SIZE) {
+		uint32_t size = recordSize(writeOffset);
+		if (size == 0) {
+			break;
+		}
+		const uint8_t *record = recordAt(writeOffset);
+		replayHandler(record[0], &record[RECORD_HEADER], record[1]);
+		writeOffset += size;
+	}
+
+	// Anything left after the last good record must be erased flash, a damaged record
+	// cannot be overwritten, so the next append moves to a fresh sector instead
+	if (writeOffset < STORAGE_SECTOR_SIZE
+			&& flashRead(sectorAddress(activeSector) + writeOffset) != 0xFFFFFFFFu) {
+		writeOffset = STORAGE_SECTOR_SIZE;
+	}
+}
+
+/**
+ * Moves the log to the next sector and writes the snapshot of the state there.
+ *
+ * @return True if the new sector holds the whole state.
+ */
+static bool storageCompact() {
+	int sector = (activeSector + 1) % STORAGE_SECTOR_COUNT;
+	uint32_t address = sectorAddress(sector);
+
+	if (!flashErase(address) || !flashProgram(address + 4, sequence + 1)) {
+		return false;
+	}
+	activeSector = sector;
+	sequence++;
+	writeOffset = HEADER_SIZE;
+
+	compacting = true;
+	snapshotHandler();
+	compacting = false;
+
+	// The magic is written last, until then the previous sector stays the valid one
+	// at boot, so a reset during the snapshot loses nothing
+	return flashProgram(address, STORAGE_MAGIC);
+}
+
+/**
+ * Appends a record to the log. The change the record describes must already be part
+ * of the state written by the snapshot handler, since a full sector is replaced by a
+ * snapshot instead of the record.
+ *
+ * @param type Type of the record, anything but 0xFF.
+ * @param data Payload of the record.
+ * @param length Length of the payload, at most STORAGE_RECORD_MAX.
+ * @return True if the record is stored.
+ */
+bool storageAppend(uint8_t type, const void *data, uint8_t length) {
+	const uint8_t *bytes = data;
+	uint32_t size = RECORD_HEADER + ((length + 3u) & ~3u);
+
+	if (type == RECORD_ERASED || length > STORAGE_RECORD_MAX) {
+		return false;
+	}
+	if (activeSector < 0 || writeOffset + size > STORAGE_SECTOR_SIZE) {
+		return !compacting && storageCompact();
+	}
+
+	uint16_t crc = crc16(CRC16_INIT, (const uint8_t[]) { type, length }, 2);
+	crc = crc16(crc, bytes, length);
+
+	uint32_t address = sectorAddress(activeSector) + writeOffset;
+	writeOffset += size;
+
+	// Header first, then the payload a longword at a time, padded with the erased value
+	bool ok = flashProgram(address, type | length << 8 | (uint32_t) crc << 16);
+	for (uint32_t i = 0; ok && i < length; i += 4) {
+		uint32_t word = 0;
+		for (uint32_t j = 0; j < 4; j++) {
+			uint32_t byte = i + j < length ? bytes[i + j] : 0xFF;
+			word |= byte << (8 * j);
+		}
+		ok = flashProgram(address + RECORD_HEADER + i, word);
+	}
+
+	if (!ok) {
+		// Replay would stop at the damaged record, continue in a fresh sector instead
+		writeOffset = STORAGE_SECTOR_SIZE;
+	}
+	return ok;
+}
+
+/**
+ * Returns the space left in the active sector.
+ *
+ * @return Free bytes, 0 if nothing has been stored yet.
+ */
+uint16_t storageFree() {
+	return activeSector < 0 ? 0 : (uint16_t) (STORAGE_SECTOR_SIZE - writeOffset);
+}
@@ -0,0 +1,25 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: storage.h
+ * Description: Append-only record log in the program flash that survives resets.
+ */
+
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define STORAGE_BASE         0x0007E000u // Last 8 KB of flash block 1, kept free of code
+#define STORAGE_SECTOR_SIZE  0x800u      // Erase unit of the K60 program flash
+#define STORAGE_SECTOR_COUNT 4           // Sectors the log rotates through
+#define STORAGE_RECORD_MAX   64          // Largest record payload in bytes
+
+typedef void (*StorageReplayHandler)(uint8_t type, const uint8_t *data, uint8_t length);
+typedef void (*StorageSnapshotHandler)(); // Appends records describing the whole state
+
+void StorageInit(StorageReplayHandler replay, StorageSnapshotHandler snapshot);
+bool storageAppend(uint8_t type, const void *data, uint8_t length);
+uint16_t storageFree();
+
+#endif /* STORAGE_H */
@@ -0,0 +1,198 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: synth.c
+ * Description: Square wave voices mixed into the samples of the speaker. Notes go through a
+ * bounded lock-free queue with many producers and one consumer, the same scheme as the
+ * deferred work queue of work.c: a producer reserves a slot with a compare-and-swap of the
+ * head and publishes it through the sequence number of the slot. The sample interrupt is
+ * the consumer and the only code touching the voices. It takes at most one note per sample
+ * and every voice costs one addition and one comparison, so the time per sample is bounded
+ * whatever is queued or playing. A note ends after its duration counted in samples.
+ */
+
+#include "tone.h"
+#include "synth.h"
+#include <stdatomic.h>
+#include <stddef.h>
+
+// One queued note. The slot at position p is free for the producer of p while its
+// sequence is p and holds the note of p once its sequence is p + 1.
+struct SynthSlot {
+	atomic_uint sequence;
+	uint8_t voice;
+	uint8_t volume;
+	uint16_t frequency;  // 0 silences the voice
+	uint16_t duration;   // ms
+};
+
+// State of a voice, only used by the sample interrupt
+struct Voice {
+	uint32_t phase;      // Position in the period, the top bit selects the half wave
+	uint32_t step;       // Added to phase every sample
+	uint32_t remaining;  // Samples left of the note, 0 when silent
+	int32_t amplitude;   // Sample value of the upper half wave
+};
+
+static struct SynthSlot slots[SYNTH_QUEUE_SIZE];
+static atomic_uint head;             // Next position to reserve, advanced by the producers
+static atomic_uint tail;             // Next position to take, advanced by the sample interrupt
+static atomic_uint droppedCount;     // Notes rejected because the queue was full
+static struct Voice voices[SYNTH_VOICE_COUNT];
+static volatile uint16_t frequencies[SYNTH_VOICE_COUNT]; // Note being played by each voice
+static volatile uint8_t activeVoices = 0; // Bit of every voice that is playing a note
+
+/**
+ * Empties the queue, silences the voices and initializes the speaker output.
+ */
+void SynthInit() {
+	for (unsigned i = 0; i < SYNTH_QUEUE_SIZE; i++) {
+		atomic_init(&slots[i].sequence, i);
+	}
+	atomic_init(&head, 0);
+	atomic_init(&tail, 0);
+	atomic_init(&droppedCount, 0);
+	for (int i = 0; i < SYNTH_VOICE_COUNT; i++) {
+		voices[i] = (struct Voice) { 0 };
+		frequencies[i] = 0;
+	}
+	activeVoices = 0;
+	ToneInit();
+}
+
+/**
+ * Queues a note and starts the sample interrupt. Safe from any interrupt handler and
+ * from the main loop.
+ *
+ * @param voice Voice playing the note, replacing the note it plays.
+ * @param frequency Frequency in Hz, 0 or out of range silences the voice.
+ * @param duration_ms Duration of the note.
+ * @param volume Loudness, SYNTH_VOLUME_MAX for a full scale square wave.
+ * @return True if the note was queued, false if the queue is full.
+ */
+bool synthPlay(enum SynthVoice voice, uint16_t frequency, uint16_t duration_ms, uint8_t volume) {
+	unsigned position = atomic_load_explicit(&head, memory_order_relaxed);
+	struct SynthSlot *slot;
+
+	for (;;) {
+		slot = &slots[position & (SYNTH_QUEUE_SIZE - 1)];
+		unsigned sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+		int difference = (int) (sequence - position);
+
+		if (difference == 0) {
+			// On failure the current head is loaded into position and the slot is checked again
+			if (atomic_compare_exchange_weak_explicit(&head, &position, position + 1,
+					memory_order_relaxed, memory_order_relaxed)) {
+				break;
+			}
+		} else if (difference < 0) {
+			atomic_fetch_add_explicit(&droppedCount, 1, memory_order_relaxed);
+			return false; // The slot still holds a note from the previous round
+		} else {
+			position = atomic_load_explicit(&head, memory_order_relaxed);
+		}
+	}
+
+	slot->voice = (uint8_t) voice;
+	slot->volume = volume;
+	slot->frequency = frequency;
+	slot->duration = duration_ms;
+	atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+	toneStart();
+	return true;
+}
+
+/**
+ * Silences a voice.
+ *
+ * @param voice The voice.
+ * @return True if the request was queued, false if the queue is full.
+ */
+bool synthStop(enum SynthVoice voice) {
+	return synthPlay(voice, 0, 0, 0);
+}
+
+/**
+ * Checks whether a voice is playing or a note is queued. The sample interrupt stops
+ * once this turns false.
+ */
+bool synthIsPlaying() {
+	return activeVoices != 0 || atomic_load_explicit(&head, memory_order_relaxed)
+			!= atomic_load_explicit(&tail, memory_order_relaxed);
+}
+
+/**
+ * Returns the frequency a voice is playing, 0 while it is silent.
+ */
+uint16_t synthFrequency(enum SynthVoice voice) {
+	return frequencies[voice];
+}
+
+/**
+ * Starts the note of a slot taken from the queue.
+ */
+static void startNote(const struct SynthSlot *slot) {
+	struct Voice *voice = &voices[slot->voice];
+	uint8_t bit = (uint8_t) (1u << slot->voice);
+
+	if (slot->frequency < SYNTH_MIN_FREQUENCY || slot->frequency > SYNTH_MAX_FREQUENCY
+			|| slot->duration == 0) {
+		voice->remaining = 0;
+		frequencies[slot->voice] = 0;
+		activeVoices &= (uint8_t) ~bit;
+		return;
+	}
+
+	// A new note keeps the phase, so a voice changing its note does not click
+	voice->step = (uint32_t) (((uint64_t) slot->frequency << 32) / SYNTH_SAMPLE_RATE_HZ);
+	voice->remaining = (uint32_t) slot->duration * (SYNTH_SAMPLE_RATE_HZ / 1000);
+	voice->amplitude = (int32_t) slot->volume * SYNTH_SAMPLE_MAX / SYNTH_VOLUME_MAX;
+	frequencies[slot->voice] = slot->frequency;
+	activeVoices |= bit;
+}
+
+/**
+ * Computes the next sample, called by the sample interrupt only. Starts the next queued
+ * note and advances every voice by one sample. Voices sounding together are added and
+ * the sum is clipped, a single voice plays at full scale.
+ *
+ * @return Sample between -SYNTH_SAMPLE_MAX and SYNTH_SAMPLE_MAX, 0 when silent.
+ */
+int32_t synthSample() {
+	unsigned position = atomic_load_explicit(&tail, memory_order_relaxed);
+	struct SynthSlot *slot = &slots[position & (SYNTH_QUEUE_SIZE - 1)];
+
+	// A slot that is reserved but not yet published waits for the next sample
+	if (atomic_load_explicit(&slot->sequence, memory_order_acquire) == position + 1) {
+		startNote(slot);
+		atomic_store_explicit(&slot->sequence, position + SYNTH_QUEUE_SIZE, memory_order_release);
+		atomic_store_explicit(&tail, position + 1, memory_order_relaxed);
+	}
+
+	int32_t sample = 0;
+	for (int i = 0; i < SYNTH_VOICE_COUNT; i++) {
+		struct Voice *voice = &voices[i];
+		if (voice->remaining == 0) {
+			continue;
+		}
+		sample += (voice->phase & 0x80000000u) ? -voice->amplitude : voice->amplitude;
+		voice->phase += voice->step;
+		if (--voice->remaining == 0) {
+			frequencies[i] = 0;
+			activeVoices &= (uint8_t) ~(1u << i);
+		}
+	}
+
+	if (sample > SYNTH_SAMPLE_MAX) {
+		sample = SYNTH_SAMPLE_MAX;
+	} else if (sample < -SYNTH_SAMPLE_MAX) {
+		sample = -SYNTH_SAMPLE_MAX;
+	}
+	return sample;
+}
+
+/**
+ * Returns the number of notes rejected because the queue was full.
+ */
+uint32_t synthDroppedCount() {
+	return atomic_load_explicit(&droppedCount, memory_order_relaxed);
+}
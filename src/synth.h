@@ -0,0 +1,41 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: synth.h
+ * Description: Software synthesizer of the speaker. Square wave voices are mixed into one
+ * sample stream taken by the sample interrupt of tone.h, so a beep plays over a ringing
+ * melody instead of waiting for it. Notes are queued without locking from the main loop
+ * and from interrupts.
+ */
+
+#ifndef SYNTH_H
+#define SYNTH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SYNTH_SAMPLE_RATE_HZ 20000 // Samples per second taken by the sample interrupt
+#define SYNTH_MIN_FREQUENCY  20    // Lowest frequency of a note, in Hz
+#define SYNTH_MAX_FREQUENCY  (SYNTH_SAMPLE_RATE_HZ / 2) // Highest frequency of a note
+#define SYNTH_VOLUME_MAX     255   // Volume of a full scale square wave
+#define SYNTH_SAMPLE_MAX     32767 // Largest sample, the samples are signed
+
+// Notes waiting for the sample interrupt, power of two. The sample interrupt takes one
+// per sample, independent producers each keep at most a note or two queued.
+#define SYNTH_QUEUE_SIZE 8
+
+// Voices mixed together, one per independent source of sound
+enum SynthVoice {
+	SYNTH_VOICE_MELODY, // Notes of the sequencer
+	SYNTH_VOICE_BEEP,   // Feedback of the buttons
+	SYNTH_VOICE_COUNT
+};
+
+void SynthInit();
+bool synthPlay(enum SynthVoice voice, uint16_t frequency, uint16_t duration_ms, uint8_t volume);
+bool synthStop(enum SynthVoice voice);
+bool synthIsPlaying();
+uint16_t synthFrequency(enum SynthVoice voice);
+int32_t synthSample();
+uint32_t synthDroppedCount();
+
+#endif /* SYNTH_H */
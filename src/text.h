@@ -0,0 +1,42 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: text.h
+ * Description: Texts of the user interface, chosen at compile time. UI_LANG_EN selects the
+ * English texts instead of the Czech ones, UI_PLAIN leaves out the ANSI colors for terminals
+ * without them. Every text is a string literal defined once, so the compiler and the
+ * linker keep a single copy of it in flash however many places send it.
+ */
+
+#ifndef TEXT_H
+#define TEXT_H
+
+#ifdef UI_LANG_EN
+#include "text_en.h"
+#else
+#include "text_cs.h"
+#endif
+
+// Select Graphic Rendition sequence, empty on plain terminals
+#ifdef UI_PLAIN
+#define ANSI(attributes) ""
+#else
+#define ANSI(attributes) "\033[" attributes "m"
+#endif
+
+#define STYLE_RESET  ANSI("0")
+#define STYLE_TITLE  ANSI("30;47")  // Headings, black on white
+#define STYLE_PROMPT ANSI("1;37")   // Questions
+#define STYLE_OK     ANSI("1;32")   // Confirmations
+#define STYLE_ERROR  ANSI("1;31")   // Rejected input
+#define STYLE_NOTICE ANSI("1;33")   // Changes not asked for in a dialog
+#define STYLE_RING   ANSI("1;3;31") // Ringing alarms
+#define STYLE_NEXT   ANSI("1;3;32") // Next ring of an alarm
+#define STYLE_INFO   ANSI("0;37")   // Statistics
+
+// A message on a line of its own
+#define PROMPT_LINE(text) STYLE_PROMPT "\n" text STYLE_RESET
+#define OK_LINE(text)     STYLE_OK "\n" text "\n" STYLE_RESET
+#define ERROR_LINE(text)  STYLE_ERROR "\n" text "\n" STYLE_RESET
+#define NOTICE_LINE(text) STYLE_NOTICE "\n" text "\n" STYLE_RESET
+
+#endif /* TEXT_H */
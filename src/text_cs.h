@@ -0,0 +1,147 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: text_cs.h
+ * Description: Czech texts of the user interface, included by text.h. The texts carry no
+ * colors and no line breaks around them, text.h adds those.
+ */
+
+#ifndef TEXT_CS_H
+#define TEXT_CS_H
+
+// Main menu
+#define TXT_MENU_TITLE     "Digitální Hodiny s Budíkem"
+#define TXT_MENU_CLOCK     "1. Nastavit Čas"
+#define TXT_HELP_CLOCK     " - Nastavte aktuální čas hodin."
+#define TXT_MENU_ALARM     "2. Nastavit Alarm"
+#define TXT_HELP_ALARM     " - Nastavte čas, kdy má alarm zazvonit."
+#define TXT_MENU_SWITCH    "3. Zapnout/Vypnout Alarm"
+#define TXT_HELP_SWITCH    " - Zapněte nebo vypněte alarm."
+#define TXT_MENU_MELODY    "4. Vybrat Melodii"
+#define TXT_HELP_MELODY    " - Vyberte melodii pro alarm."
+#define TXT_MENU_LIGHT     "5. Vybrat Světelný Efekt"
+#define TXT_HELP_LIGHT     " - Vyberte světelný efekt pro alarm."
+#define TXT_MENU_REPEAT    "6. Nastavit Opakování Alarmu"
+#define TXT_HELP_REPEAT    " - Nastavte opakování a interval alarmu."
+#define TXT_MENU_STATUS    "7. Zobrazit Informace o Budíku"
+#define TXT_HELP_STATUS    " - Zobrazte aktuální nastavení alarmu."
+#define TXT_MENU_DELETE    "8. Smazat Alarm"
+#define TXT_HELP_DELETE    " - Odstraňte alarm z tabulky alarmů."
+#define TXT_MENU_PROMPT    "Zadejte volbu: "
+#define TXT_READY          "Inicializace byla dokončena."
+
+// Status lines of the screen, the labels padded to the same width
+#define TXT_LABEL_CLOCK    "Čas:   "
+#define TXT_LABEL_ALARMS   "Alarm: "
+#define TXT_RINGING        "ZVONÍ, "
+#define TXT_ENABLED        "zapnut"
+#define TXT_DISABLED       "vypnut"
+#define TXT_NEXT_RING      ", další "
+#define TXT_IN_TABLE       ", v tabulce "
+
+// Rings and buttons
+#define TXT_RING_ALARM     "Alarm "
+#define TXT_RING_ATTEMPT   " - pokus o buzeni "
+#define TXT_RING_NEXT      "Dalsi Alarm: "
+#define TXT_RING_LAST      "posledni pokus"
+#define TXT_SNOOZED        "Alarm odložen o 5 minut."
+#define TXT_SNOOZE_FULL    "Alarm nelze odložit, tabulka alarmů je plná."
+#define TXT_DISMISSED      "Alarm byl ukončen."
+#define TXT_CLOCK          "Čas: "
+
+// Dialogs
+#define TXT_INVALID_CHOICE "Neplatná volba, zadejte číslo mezi "
+#define TXT_CHOICE_AND     " a "
+#define TXT_ASK_MELODY     "Vyberte melodii (1-3): "
+#define TXT_MELODY_CHOSEN  "Melodie byla vybrána."
+#define TXT_ASK_LIGHT      "Vyberte světelný efekt (1-5): "
+#define TXT_LIGHT_CHOSEN   "Světelný efekt byl vybrán."
+#define TXT_SWITCH_ON      "1 - zapnout"
+#define TXT_SWITCH_OFF     "0 - vypnout"
+#define TXT_ALARMS_ON      "Alarm byl zapnut."
+#define TXT_ALARMS_OFF     "Alarm byl vypnut."
+#define TXT_ASK_REPEATS    "Zadejte počet opakování budíku (0 pro žádné opakování): "
+#define TXT_BAD_REPEATS    "Neplatný počet opakování, musí být mezi 0 a 255."
+#define TXT_ASK_INTERVAL   "Zadejte interval mezi opakováními v sekundách: "
+#define TXT_BAD_INTERVAL   "Neplatný interval, musí být mezi 1 a 65535."
+#define TXT_ASK_BACKOFF    "Zadejte průběh opakování (0 - stálý interval, " \
+		"1 - lineárně rostoucí, 2 - exponenciálně rostoucí): "
+#define TXT_ASK_ESCALATE   "Zesilovat zvuk a světlo s každým opakováním? (1 - ano, 0 - ne): "
+#define TXT_REPEATS_SET    "Nastavení opakování budíku bylo aktualizováno."
+#define TXT_BAD_FORMAT_AT  "Chybný formát vstupu na pozici "
+#define TXT_TRY_AGAIN      ", zkuste to znovu."
+#define TXT_ASK_DATE_TIME  "Zadejte datum a čas (YYYY-MM-DD HH:MM:SS): "
+#define TXT_TIME_SET       "Čas byl nastaven."
+#define TXT_TIME_NOT_SET   "Čas nebyl nastaven."
+#define TXT_ASK_RECURRENCE "Opakovat alarm (0 - jednou, 1 - denně, 2 - vybrané dny, " \
+		"3 - každých N minut): "
+#define TXT_ASK_WEEKDAYS   "Zadejte dny v týdnu (1 - pondělí až 7 - neděle, např. 12345): "
+#define TXT_BAD_WEEKDAYS   "Neplatný výběr dnů."
+#define TXT_ASK_PERIOD     "Zadejte periodu v minutách: "
+#define TXT_BAD_PERIOD     "Neplatná perioda, musí být mezi 1 a 65535."
+#define TXT_ALARM_SET      " byl nastaven."
+#define TXT_ALARM_NOT_SET  "Alarm nebyl nastaven."
+#define TXT_TABLE_FULL     "Alarm nebyl nastaven, tabulka alarmů je plná."
+#define TXT_ASK_DELETE     "Zadejte číslo alarmu ke smazání: "
+#define TXT_DELETED        "Alarm byl smazán."
+#define TXT_NO_SUCH_ALARM  "Alarm s tímto číslem neexistuje."
+
+// Status of the alarm
+#define TXT_STATUS_TITLE   "Stav alarmu"
+#define TXT_STATUS_ALARM   " Alarm je "
+#define TXT_STATUS_TIME    " Aktuální čas: "
+#define TXT_STATUS_MELODY  " Vybraná melodie: "
+#define TXT_STATUS_LIGHT   " Vybraný světelný efekt: "
+#define TXT_STATUS_REPEATS " Počet opakování alarmu: "
+#define TXT_STATUS_INTERVAL " Interval opakování (v sekundách): "
+#define TXT_STATUS_BACKOFF " Průběh opakování: "
+#define TXT_ESCALATING     ", zesilující"
+#define TXT_STEADY         ", stálá síla"
+#define TXT_STATUS_UART    " UART přetečení: "
+#define TXT_STATUS_DROPPED ", zahozené bajty: "
+#define TXT_STATUS_LOST    ", ztracené události: "
+#define TXT_STATUS_CPU     " Aktivita CPU: "
+#define TXT_STATUS_CURRENT " %, odhad proudu: "
+#define TXT_STATUS_RTC     " Korekce RTC: "
+#define TXT_STATUS_START   " Start: "
+#define TXT_STATUS_TABLE   " Naplánované alarmy: "
+#define TXT_LIST_MELODY    "), melodie "
+#define TXT_LIST_LIGHT     ", efekt "
+#define TXT_LIST_REPEATS   ", opakování "
+#define TXT_LIST_INTERVAL  " po "
+#define TXT_BACKOFF_FIXED  "stálý interval"
+#define TXT_BACKOFF_LINEAR "lineárně rostoucí"
+#define TXT_BACKOFF_EXP    "exponenciálně rostoucí"
+#define TXT_ONCE           "jednou"
+#define TXT_DAILY          "denně"
+#define TXT_WEEKDAYS       "dny "
+#define TXT_EVERY          "každých "
+#define TXT_MINUTES        " min"
+
+// Boot
+#define TXT_BOOT           "Start: "
+#define TXT_WARM_START     "teplý start"
+#define TXT_COLD_START     "studený start"
+#define TXT_BOOT_RTC       ", RTC "
+#define TXT_BOOT_TOTAL     " ms, celkem "
+#define TXT_NO_OSCILLATOR  ", oscilátor RTC nenaběhl"
+
+// Replies of the commands after OK or ERR
+#define TXT_EXPECTED       "očekáváno: "
+#define TXT_TOO_MANY_WORDS "příliš mnoho parametrů"
+#define TXT_UNKNOWN_COMMAND "neznámý příkaz"
+#define TXT_UNKNOWN_PARAMETER "neznámý parametr"
+#define TXT_ERR_NO_ALARM   "alarm neexistuje"
+#define TXT_ERR_DATE_TIME  "chybné datum a čas"
+#define TXT_ERR_MELODY     "chybná melodie"
+#define TXT_ERR_LIGHT      "chybný světelný efekt"
+#define TXT_ERR_REPEATS    "chybný počet opakování"
+#define TXT_ERR_INTERVAL   "chybný interval opakování"
+#define TXT_ERR_WEEKDAYS   "chybné dny"
+#define TXT_ERR_PERIOD     "chybná perioda"
+#define TXT_ERR_TABLE_FULL "tabulka alarmů je plná"
+#define TXT_USAGE_REP      "rep=POČET/SEKUNDY"
+#define TXT_CAL_STARTED    "měření začalo"
+#define TXT_CAL_TOO_SHORT  "měření je příliš krátké"
+#define TXT_CAL_OUT_OF_RANGE "odchylka je mimo rozsah korekce"
+
+#endif /* TEXT_CS_H */
@@ -0,0 +1,147 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: text_en.h
+ * Description: English texts of the user interface, included by text.h when UI_LANG_EN is
+ * defined. Only ASCII characters are used, so a UI_PLAIN build sends plain ASCII.
+ */
+
+#ifndef TEXT_EN_H
+#define TEXT_EN_H
+
+// Main menu
+#define TXT_MENU_TITLE     "Digital Clock with Alarm"
+#define TXT_MENU_CLOCK     "1. Set Time"
+#define TXT_HELP_CLOCK     " - Set the current time of the clock."
+#define TXT_MENU_ALARM     "2. Set Alarm"
+#define TXT_HELP_ALARM     " - Set when the alarm rings."
+#define TXT_MENU_SWITCH    "3. Alarm On/Off"
+#define TXT_HELP_SWITCH    " - Switch the alarm on or off."
+#define TXT_MENU_MELODY    "4. Choose Melody"
+#define TXT_HELP_MELODY    " - Choose the melody of the alarm."
+#define TXT_MENU_LIGHT     "5. Choose Light Effect"
+#define TXT_HELP_LIGHT     " - Choose the light effect of the alarm."
+#define TXT_MENU_REPEAT    "6. Set Alarm Repeats"
+#define TXT_HELP_REPEAT    " - Set the repeats and their interval."
+#define TXT_MENU_STATUS    "7. Show Alarm Status"
+#define TXT_HELP_STATUS    " - Show the current alarm settings."
+#define TXT_MENU_DELETE    "8. Delete Alarm"
+#define TXT_HELP_DELETE    " - Remove an alarm from the alarm table."
+#define TXT_MENU_PROMPT    "Enter a choice: "
+#define TXT_READY          "Initialization complete."
+
+// Status lines of the screen, the labels padded to the same width
+#define TXT_LABEL_CLOCK    "Time:  "
+#define TXT_LABEL_ALARMS   "Alarm: "
+#define TXT_RINGING        "RINGING, "
+#define TXT_ENABLED        "on"
+#define TXT_DISABLED       "off"
+#define TXT_NEXT_RING      ", next "
+#define TXT_IN_TABLE       ", in table "
+
+// Rings and buttons
+#define TXT_RING_ALARM     "Alarm "
+#define TXT_RING_ATTEMPT   " - wake-up attempt "
+#define TXT_RING_NEXT      "Next Alarm: "
+#define TXT_RING_LAST      "last attempt"
+#define TXT_SNOOZED        "Alarm snoozed for 5 minutes."
+#define TXT_SNOOZE_FULL    "Alarm cannot be snoozed, the alarm table is full."
+#define TXT_DISMISSED      "Alarm dismissed."
+#define TXT_CLOCK          "Time: "
+
+// Dialogs
+#define TXT_INVALID_CHOICE "Invalid choice, enter a number between "
+#define TXT_CHOICE_AND     " and "
+#define TXT_ASK_MELODY     "Choose a melody (1-3): "
+#define TXT_MELODY_CHOSEN  "Melody chosen."
+#define TXT_ASK_LIGHT      "Choose a light effect (1-5): "
+#define TXT_LIGHT_CHOSEN   "Light effect chosen."
+#define TXT_SWITCH_ON      "1 - on"
+#define TXT_SWITCH_OFF     "0 - off"
+#define TXT_ALARMS_ON      "Alarm switched on."
+#define TXT_ALARMS_OFF     "Alarm switched off."
+#define TXT_ASK_REPEATS    "Enter the number of alarm repeats (0 for none): "
+#define TXT_BAD_REPEATS    "Invalid number of repeats, must be between 0 and 255."
+#define TXT_ASK_INTERVAL   "Enter the interval between the repeats in seconds: "
+#define TXT_BAD_INTERVAL   "Invalid interval, must be between 1 and 65535."
+#define TXT_ASK_BACKOFF    "Enter how the repeats are spaced (0 - fixed interval, " \
+		"1 - growing linearly, 2 - growing exponentially): "
+#define TXT_ASK_ESCALATE   "Make sound and light stronger with every repeat? (1 - yes, 0 - no): "
+#define TXT_REPEATS_SET    "Alarm repeat settings updated."
+#define TXT_BAD_FORMAT_AT  "Invalid input format at position "
+#define TXT_TRY_AGAIN      ", try again."
+#define TXT_ASK_DATE_TIME  "Enter the date and time (YYYY-MM-DD HH:MM:SS): "
+#define TXT_TIME_SET       "Time set."
+#define TXT_TIME_NOT_SET   "Time not set."
+#define TXT_ASK_RECURRENCE "Repeat the alarm (0 - once, 1 - daily, 2 - selected days, " \
+		"3 - every N minutes): "
+#define TXT_ASK_WEEKDAYS   "Enter the days of the week (1 - Monday to 7 - Sunday, e.g. 12345): "
+#define TXT_BAD_WEEKDAYS   "Invalid choice of days."
+#define TXT_ASK_PERIOD     "Enter the period in minutes: "
+#define TXT_BAD_PERIOD     "Invalid period, must be between 1 and 65535."
+#define TXT_ALARM_SET      " set."
+#define TXT_ALARM_NOT_SET  "Alarm not set."
+#define TXT_TABLE_FULL     "Alarm not set, the alarm table is full."
+#define TXT_ASK_DELETE     "Enter the number of the alarm to delete: "
+#define TXT_DELETED        "Alarm deleted."
+#define TXT_NO_SUCH_ALARM  "There is no alarm with this number."
+
+// Status of the alarm
+#define TXT_STATUS_TITLE   "Alarm Status"
+#define TXT_STATUS_ALARM   " Alarm is "
+#define TXT_STATUS_TIME    " Current time: "
+#define TXT_STATUS_MELODY  " Chosen melody: "
+#define TXT_STATUS_LIGHT   " Chosen light effect: "
+#define TXT_STATUS_REPEATS " Number of alarm repeats: "
+#define TXT_STATUS_INTERVAL " Repeat interval (in seconds): "
+#define TXT_STATUS_BACKOFF " Repeat spacing: "
+#define TXT_ESCALATING     ", escalating"
+#define TXT_STEADY         ", steady"
+#define TXT_STATUS_UART    " UART overruns: "
+#define TXT_STATUS_DROPPED ", dropped bytes: "
+#define TXT_STATUS_LOST    ", lost events: "
+#define TXT_STATUS_CPU     " CPU activity: "
+#define TXT_STATUS_CURRENT " %, estimated current: "
+#define TXT_STATUS_RTC     " RTC compensation: "
+#define TXT_STATUS_START   " Boot: "
+#define TXT_STATUS_TABLE   " Scheduled alarms: "
+#define TXT_LIST_MELODY    "), melody "
+#define TXT_LIST_LIGHT     ", effect "
+#define TXT_LIST_REPEATS   ", repeats "
+#define TXT_LIST_INTERVAL  " every "
+#define TXT_BACKOFF_FIXED  "fixed interval"
+#define TXT_BACKOFF_LINEAR "growing linearly"
+#define TXT_BACKOFF_EXP    "growing exponentially"
+#define TXT_ONCE           "once"
+#define TXT_DAILY          "daily"
+#define TXT_WEEKDAYS       "days "
+#define TXT_EVERY          "every "
+#define TXT_MINUTES        " min"
+
+// Boot
+#define TXT_BOOT           "Boot: "
+#define TXT_WARM_START     "warm start"
+#define TXT_COLD_START     "cold start"
+#define TXT_BOOT_RTC       ", RTC "
+#define TXT_BOOT_TOTAL     " ms, total "
+#define TXT_NO_OSCILLATOR  ", RTC oscillator did not start"
+
+// Replies of the commands after OK or ERR
+#define TXT_EXPECTED       "expected: "
+#define TXT_TOO_MANY_WORDS "too many parameters"
+#define TXT_UNKNOWN_COMMAND "unknown command"
+#define TXT_UNKNOWN_PARAMETER "unknown parameter"
+#define TXT_ERR_NO_ALARM   "no such alarm"
+#define TXT_ERR_DATE_TIME  "invalid date and time"
+#define TXT_ERR_MELODY     "invalid melody"
+#define TXT_ERR_LIGHT      "invalid light effect"
+#define TXT_ERR_REPEATS    "invalid number of repeats"
+#define TXT_ERR_INTERVAL   "invalid repeat interval"
+#define TXT_ERR_WEEKDAYS   "invalid days"
+#define TXT_ERR_PERIOD     "invalid period"
+#define TXT_ERR_TABLE_FULL "alarm table is full"
+#define TXT_USAGE_REP      "rep=COUNT/SECONDS"
+#define TXT_CAL_STARTED    "measurement started"
+#define TXT_CAL_TOO_SHORT  "measurement is too short"
+#define TXT_CAL_OUT_OF_RANGE "drift is out of the compensation range"
+
+#endif /* TEXT_EN_H */
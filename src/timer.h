@@ -0,0 +1,30 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: timer.h
+ * Description: Millisecond time base driven by PIT channel 0 and a sleep/deadline API built on top of it.
+ */
+
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TIMER_TICK_HZ 1000 // Frequency of the PIT0 time base interrupt
+#define TIMER_MAX_TICK_HANDLERS 8 // Number of functions called on every tick
+
+typedef uint32_t deadline_t; // Point in time in milliseconds, see deadlineIn()
+typedef void (*TickHandler)(); // Function called from the time base interrupt
+
+void PITInit();
+uint32_t timerMillis();
+uint32_t timerMicros();
+void sleepMs(uint32_t ms);
+void sleepUs(uint32_t us);
+deadline_t deadlineIn(uint32_t ms);
+bool deadlineExpired(deadline_t deadline);
+bool timerAddTickHandler(TickHandler handler);
+void timerAdvance(uint32_t ms);
+void PIT0_IRQHandler();
+
+#endif /* TIMER_H */
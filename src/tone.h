@@ -0,0 +1,19 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: tone.h
+ * Description: Speaker output of the samples mixed by synth.h. A sample interrupt takes
+ * SYNTH_SAMPLE_RATE_HZ samples per second from synthSample() and turns them into the duty
+ * of the FTM0 PWM on PTA4. It only runs while the synthesizer has something to play.
+ */
+
+#ifndef TONE_H
+#define TONE_H
+
+#include <stdbool.h>
+
+void ToneInit();
+void toneStart();
+bool toneRunning();
+void PIT2_IRQHandler();
+
+#endif /* TONE_H */
@@ -0,0 +1,38 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: uart.h
+ * Description: UART5 console driver, interrupt-driven receiver and DMA-driven transmitter.
+ */
+
+#ifndef UART_H
+#define UART_H
+
+#include "work.h"
+#include "rtc.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#define UART_RX_BUFFER_SIZE 256  // Must be a power of two
+#define UART_TX_BUFFER_SIZE 1024 // Must be a power of two
+#define UART_TX_QUEUE_SIZE  16   // Queued transmit segments, must be a power of two
+#define UART_TX_DMA_CHANNEL 0    // DMA channel used by the transmitter
+
+// Queues a string literal that already contains "\r\n" line endings, without copying it
+#define UARTSendConst(s) UARTSendBuf((s), sizeof(s) - 1)
+
+void UARTInit(WorkHandler received);
+void SendCh(char ch);
+void UARTSendStr(const char* str);
+void UARTSendBuf(const char* data, uint16_t length);
+void UARTSendBytes(const uint8_t *data, uint16_t length);
+bool UARTTxIdle();
+void UARTSetWakeOnRx(bool enable);
+bool UARTReadCh(char* ch);
+void UARTRxTime(struct RtcTime *time);
+bool UARTRxAvailable();
+uint32_t UARTOverrunCount();
+uint32_t UARTDroppedCount();
+void UART5_RX_TX_IRQHandler();
+void DMA0_IRQHandler();
+
+#endif /* UART_H */
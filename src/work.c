@@ -0,0 +1,117 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: work.c
+ * Description: Bounded lock-free queue of deferred work with many producers and one
+ * consumer. A producer reserves a slot by advancing the head with a compare-and-swap and
+ * publishes it through the sequence number of the slot, interrupts of any priority may
+ * post while another post is in progress. The main loop is the only consumer and takes the
+ * slots in order, a slot that is reserved but not yet published ends the run until the
+ * interrupted producer has finished.
+ */
+
+#include "work.h"
+#include "profile.h"
+#include <stdatomic.h>
+#include <stddef.h>
+
+// One queued function call. The slot at position p is free for the producer of p while
+// its sequence is p and holds the call of p once its sequence is p + 1.
+struct WorkItem {
+	atomic_uint sequence;
+	WorkHandler handler;
+	uint32_t arg;
+};
+
+static struct WorkItem items[WORK_QUEUE_SIZE];
+static atomic_uint head;         // Next position to reserve, advanced by the producers
+static unsigned tail;            // Next position to run, only used by the main loop
+static atomic_uint droppedCount; // Posts rejected because the queue was full
+
+/**
+ * Empties the queue.
+ */
+void WorkInit() {
+	for (unsigned i = 0; i < WORK_QUEUE_SIZE; i++) {
+		atomic_init(&items[i].sequence, i);
+	}
+	atomic_init(&head, 0);
+	tail = 0;
+	atomic_init(&droppedCount, 0);
+}
+
+/**
+ * Queues a function call for the main loop. Safe from any interrupt handler and from
+ * the main loop itself.
+ *
+ * @param handler Function to run.
+ * @param arg Argument passed to the function.
+ * @return True if the call was queued, false if the queue is full.
+ */
+bool workPost(WorkHandler handler, uint32_t arg) {
+	unsigned position = atomic_load_explicit(&head, memory_order_relaxed);
+	struct WorkItem *item;
+
+	for (;;) {
+		item = &items[position & (WORK_QUEUE_SIZE - 1)];
+		unsigned sequence = atomic_load_explicit(&item->sequence, memory_order_acquire);
+		int difference = (int) (sequence - position);
+
+		if (difference == 0) {
+			// On failure the current head is loaded into position and the slot is checked again
+			if (atomic_compare_exchange_weak_explicit(&head, &position, position + 1,
+					memory_order_relaxed, memory_order_relaxed)) {
+				break;
+			}
+		} else if (difference < 0) {
+			atomic_fetch_add_explicit(&droppedCount, 1, memory_order_relaxed);
+			return false; // The slot still holds a call from the previous round
+		} else {
+			position = atomic_load_explicit(&head, memory_order_relaxed);
+		}
+	}
+
+	item->handler = handler;
+	item->arg = arg;
+	atomic_store_explicit(&item->sequence, position + 1, memory_order_release);
+	return true;
+}
+
+/**
+ * Checks whether calls are queued, the main loop must not sleep then.
+ *
+ * @return True if workTask() has something to run.
+ */
+bool workPending() {
+	return atomic_load_explicit(&head, memory_order_relaxed) != tail;
+}
+
+/**
+ * Runs the queued calls in the order they were posted. Only the calls queued when it
+ * starts are run, a handler that posts again runs in the next pass of the main loop.
+ */
+void workTask() {
+	unsigned end = atomic_load_explicit(&head, memory_order_acquire);
+
+	while (tail != end) {
+		struct WorkItem *item = &items[tail & (WORK_QUEUE_SIZE - 1)];
+		if (atomic_load_explicit(&item->sequence, memory_order_acquire) != tail + 1) {
+			return; // Reserved by an interrupted producer, not published yet
+		}
+
+		WorkHandler handler = item->handler;
+		uint32_t arg = item->arg;
+		atomic_store_explicit(&item->sequence, tail + WORK_QUEUE_SIZE, memory_order_release);
+		tail++;
+
+		PROFILE_STACK_BEGIN();
+		handler(arg);
+		PROFILE_STACK_END(PROFILE_STACK_WORK);
+	}
+}
+
+/**
+ * Returns the number of calls lost because the queue was full.
+ */
+uint32_t workDroppedCount() {
+	return atomic_load_explicit(&droppedCount, memory_order_relaxed);
+}
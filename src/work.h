@@ -0,0 +1,29 @@
+/*
+ * Author: Vladimir Azarov
+ * Filename: work.h
+ * Description: Deferred work queue. Interrupt handlers post a function and an argument, the
+ * main loop runs them later on the main stack, so an interrupt only does what cannot wait.
+ */
+
+#ifndef WORK_H
+#define WORK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Items waiting for the main loop, power of two. Every producer keeps at most a few items
+// queued (one alarm, one UART notification, one sequencer end, the clock second of the
+// screen and the debounced presses), so the queue only overflows if the main loop stops
+// running.
+#define WORK_QUEUE_SIZE 16
+
+// Deferred function, runs in the main loop
+typedef void (*WorkHandler)(uint32_t arg);
+
+void WorkInit();
+bool workPost(WorkHandler handler, uint32_t arg);
+bool workPending();
+void workTask();
+uint32_t workDroppedCount();
+
+#endif /* WORK_H */
@@ -0,0 +1,38 @@
+#!/bin/sh
+#
+# Author: Vladimir Azarov
+# Filename: size-report.sh
+# Description: Prints the flash and RAM usage of a firmware image, in total and per
+# symbol. Flash holds the code, the constants and the initial values of the data, RAM
+# holds the data, the bss and the stack.
+#
+# Usage: size-report.sh <elf> [symbols], NM and SIZE name the binutils of the target.
+
+NM=${NM:-arm-none-eabi-nm}
+SIZE=${SIZE:-arm-none-eabi-size}
+ELF=$1
+LIMIT=${2:-40}
+
+if [ -z "$ELF" ]; then
+	echo "usage: $0 <elf> [symbols]" >&2
+	exit 1
+fi
+
+$SIZE -A "$ELF" | awk '
+	$1 == ".interrupts" || $1 == ".flash_config" || $1 == ".text" || $1 == ".ARM.exidx" || $1 == ".init_array" { flash += $2 }
+	$1 == ".data" { flash += $2; ram += $2 }
+	$1 == ".bss" || $1 == ".stack" { ram += $2 }
+	END {
+		printf "Flash: %7d B of %d B (%.1f %%)\n", flash, 516096, flash * 100.0 / 516096
+		printf "RAM:   %7d B of %d B (%.1f %%)\n", ram, 131072, ram * 100.0 / 131072
+	}'
+
+echo
+echo "Largest symbols in flash:"
+$NM -S -t d --size-sort -r "$ELF" | awk -v limit="$LIMIT" '
+	$3 ~ /^[TtRrWwDd]$/ && n < limit { printf "%7d  %s  %s\n", $2, $3, $4; n++ }'
+
+echo
+echo "Largest symbols in RAM:"
+$NM -S -t d --size-sort -r "$ELF" | awk -v limit="$LIMIT" '
+	$3 ~ /^[BbDd]$/ && n < limit { printf "%7d  %s  %s\n", $2, $3, $4; n++ }'